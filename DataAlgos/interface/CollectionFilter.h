@@ -14,13 +14,39 @@
 #ifndef COLLECTIONFILTER_EKK6HP4C
 #define COLLECTIONFILTER_EKK6HP4C
 
+#include <map>
 #include <vector>
 #include <string>
 
+#include "FinalStateAnalysis/DataAlgos/interface/PerEventMemo.h"
+
 namespace reco {
   class Candidate;
 }
 
+// Memo of cut results for the objects of the event's collections.  The
+// first request for a (collection, cut) pair evaluates the cut on every
+// object in one pass; later requests (e.g. the same veto cut used by many
+// ntuple columns) only read the stored bits.  A collection is identified
+// by its first object and its size (see PerEventMemo).
+class CollectionFilterCache {
+  public:
+    // Result of [filter] for each object in [collection]
+    const std::vector<bool>& results(
+        const std::vector<const reco::Candidate*>& collection,
+        const std::string& filter);
+
+  private:
+    struct Key {
+      const reco::Candidate* first;
+      size_t size;
+      std::string filter;
+      bool operator<(const Key& other) const;
+    };
+    typedef std::map<Key, std::vector<bool> > Results;
+    PerEventMemo<Results> results_;
+};
+
 // Convert collection to vector of reco::Candidate ptrs
 template<class C>
 std::vector<const reco::Candidate*> ptrizeCollection(const C& collection) {
@@ -33,19 +59,22 @@ std::vector<const reco::Candidate*> ptrizeCollection(const C& collection) {
 }
 
 // Get objects at least [minDeltaR] away from [hardScatter] objects
-// that pass [filter]
+// that pass [filter].  If a [cache] is given, the cut results are taken
+// from (and stored in) it.
 std::vector<const reco::Candidate*> getVetoObjects(
     const std::vector<const reco::Candidate*>& hardScatter,
     const std::vector<const reco::Candidate*>& vetoCollection,
     double minDeltaR,
-    const std::string& filter
+    const std::string& filter,
+    CollectionFilterCache* cache = 0
 );
 
 std::vector<const reco::Candidate*> getVetoOSObjects(
     const std::vector<const reco::Candidate*>& hardScatter,
     const std::vector<const reco::Candidate*>& vetoCollection,
     double minDeltaR,
-    const std::string& filter
+    const std::string& filter,
+    CollectionFilterCache* cache = 0
 );
 
 // Get objects passing [filter] within [minDeltaR] of [candidate]
@@ -54,13 +83,15 @@ std::vector<const reco::Candidate*> getOverlapObjects(
     const reco::Candidate& candidate,
     const std::vector<const reco::Candidate*>& overlapCollection,
     double minDeltaR,
-    const std::string& filter
+    const std::string& filter,
+    CollectionFilterCache* cache = 0
 );
 
 // Get objects passing [filter]
 std::vector<const reco::Candidate*> getObjectsPassingFilter(
     const std::vector<const reco::Candidate*>& overlapCollection,
-    const std::string& filter
+    const std::string& filter,
+    CollectionFilterCache* cache = 0
 );
 
 
@@ -0,0 +1,56 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  DerivedObjectFlags.h
+ *
+ *    Description:  Per-event table of object predicates which depend on the
+ *                  event (e.g. on the PV), shared by the leg accessors.
+ *
+ * =====================================================================================
+ */
+
+#ifndef DERIVEDOBJECTFLAGS_T5LB9XHD
+#define DERIVEDOBJECTFLAGS_T5LB9XHD
+
+#include <vector>
+
+#include "DataFormats/Common/interface/Ptr.h"
+#include "DataFormats/PatCandidates/interface/Muon.h"
+#include "DataFormats/VertexReco/interface/Vertex.h"
+#include "FinalStateAnalysis/DataAlgos/interface/PerEventMemo.h"
+
+// Each table is filled on first use, with one entry per object in the same
+// order as the event collection.
+class DerivedObjectFlags {
+  public:
+    enum MuonFlag {
+      // Tight muon + SIP < 4 (the muons electronClosestMuonDR looks at)
+      kTightSIPMuon = 1 << 0
+    };
+
+    struct Objects {
+      std::vector<double> eta;
+      std::vector<double> phi;
+      std::vector<unsigned> flags;
+    };
+
+    // Flags of the event's [muons] with respect to the [pv]
+    const Objects& muons(const pat::MuonCollection& muons,
+        const reco::Vertex& pv);
+
+    // z of each of the event's [vertices]
+    const std::vector<double>& vertexZ(
+        const std::vector<edm::Ptr<reco::Vertex> >& vertices);
+
+  private:
+    struct Tables {
+      Tables(): hasMuons(false), hasVertices(false) {}
+      bool hasMuons;
+      Objects muons;
+      bool hasVertices;
+      std::vector<double> vertexZ;
+    };
+    PerEventMemo<Tables> tables_;
+};
+
+#endif /* end of include guard: DERIVEDOBJECTFLAGS_T5LB9XHD */
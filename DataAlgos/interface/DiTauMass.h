@@ -0,0 +1,57 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  DiTauMass.h
+ *
+ *    Description:  Fast di-tau mass estimate (FastMTT-style likelihood scan),
+ *                  a cheap replacement for the full SVfit integration.
+ *
+ * =====================================================================================
+ */
+
+#ifndef DITAUMASS_R7TQ0V2M
+#define DITAUMASS_R7TQ0V2M
+
+#include <map>
+#include <string>
+#include <tuple>
+
+#include "DataFormats/Candidate/interface/Candidate.h"
+#include "FinalStateAnalysis/DataAlgos/interface/PerEventMemo.h"
+
+namespace fshelpers {
+
+  /// Estimate the mass of a tau pair from the visible decay products and
+  /// the MET.  In the collinear approximation each tau is its visible part
+  /// divided by the visible momentum fraction x.  The likelihood of each
+  /// (x1, x2) combines the tau decay spectra (flat for hadronic decays,
+  /// the three body spectrum for leptonic ones), the 1/sqrt(x1 x2) Jacobian
+  /// from the tau momenta to the visible fractions, and a Gaussian of the
+  /// MET residual, using the MET covariance [cov00, cov01, cov10, cov11].  It
+  /// is integrated over x1 at fixed mass m = mVis/sqrt(x1 x2), and the
+  /// most likely mass is returned.  Legs with |pdgId| 11 or 13 are taken to
+  /// be leptonic tau decays, all others hadronic.  Returns -999 if the
+  /// covariance can't be inverted.
+  double diTauMass(const reco::Candidate::LorentzVector& vis1, int pdgId1,
+                   const reco::Candidate::LorentzVector& vis2, int pdgId2,
+                   double metPx, double metPy, const double covariance[4]);
+
+}
+
+// Di-tau masses of the event, keyed by the two legs and the MET
+// systematic (see PerEventMemo).
+class DiTauMassCache {
+  public:
+    typedef std::tuple<const reco::Candidate*, const reco::Candidate*,
+            std::string> Key;
+
+    // Stored mass for [key], false if there is none yet
+    bool find(const Key& key, double& mass) const;
+    void insert(const Key& key, double mass);
+
+  private:
+    typedef std::map<Key, double> Masses;
+    PerEventMemo<Masses> masses_;
+};
+
+#endif /* end of include guard: DITAUMASS_R7TQ0V2M */
@@ -0,0 +1,75 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  GenMatchCache.h
+ *
+ *    Description:  Per-event memo of the gen matching of the reco legs.
+ *
+ * =====================================================================================
+ */
+
+#ifndef GENMATCHCACHE_P2DX7RUK
+#define GENMATCHCACHE_P2DX7RUK
+
+#include <map>
+#include <vector>
+
+#include "DataFormats/Candidate/interface/Candidate.h"
+#include "DataFormats/HepMCCandidate/interface/GenParticleFwd.h"
+#include "DataFormats/Provenance/interface/ProductID.h"
+#include "FinalStateAnalysis/DataAlgos/interface/PerEventMemo.h"
+
+// Gen matching results of the event's reco objects, so that a lepton
+// appearing in many final states (and many columns) is matched once.
+// Objects are identified by the ProductID and key of their Ptr.
+class GenMatchCache {
+  public:
+    struct Leg {
+      edm::ProductID id;
+      size_t key;
+      bool operator<(const Leg& other) const;
+    };
+
+    // Per leg classifications (tauGenMatch & co.)
+    enum Quantity { kTauGenMatch, kTauGenMatch2, kTauGenMatch3, kTauGenKin };
+
+    // The fshelpers::getGenParticle match of [leg], false if not stored yet
+    bool findParticle(const Leg& leg, int pdgId, bool checkCharge,
+        bool preFSR, reco::GenParticleRef& particle) const;
+    void insertParticle(const Leg& leg, int pdgId, bool checkCharge,
+        bool preFSR, const reco::GenParticleRef& particle);
+
+    // [quantity] of [leg], false if not stored yet
+    bool findValue(const Leg& leg, Quantity quantity,
+        std::vector<double>& value) const;
+    void insertValue(const Leg& leg, Quantity quantity,
+        const std::vector<double>& value);
+
+    // Visible p4 of the event's hadronic gen taus, false if not stored yet
+    bool findGenTaus(
+        std::vector<reco::Candidate::LorentzVector>& genTaus) const;
+    void insertGenTaus(
+        const std::vector<reco::Candidate::LorentzVector>& genTaus);
+
+  private:
+    struct ParticleKey {
+      Leg leg;
+      int pdgId;
+      bool checkCharge;
+      bool preFSR;
+      bool operator<(const ParticleKey& other) const;
+    };
+
+    typedef std::map<std::pair<Leg, int>, std::vector<double> > Values;
+
+    struct Matches {
+      Matches(): hasGenTaus(false) {}
+      std::map<ParticleKey, reco::GenParticleRef> particles;
+      Values values;
+      bool hasGenTaus;
+      std::vector<reco::Candidate::LorentzVector> genTaus;
+    };
+    PerEventMemo<Matches> matches_;
+};
+
+#endif /* end of include guard: GENMATCHCACHE_P2DX7RUK */
@@ -0,0 +1,71 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  L1TauMatchIndex.h
+ *
+ *    Description:  Compact L1 tau array and per-event memo of the L1 taus
+ *                  matched to each leg, for the L1 tau trigger emulation.
+ *
+ * =====================================================================================
+ */
+
+#ifndef L1TAUMATCHINDEX_Q8WN3JCE
+#define L1TAUMATCHINDEX_Q8WN3JCE
+
+#include <map>
+#include <vector>
+
+#include "DataFormats/Candidate/interface/Candidate.h"
+#include "DataFormats/L1Trigger/interface/BXVector.h"
+#include "DataFormats/L1Trigger/interface/Tau.h"
+#include "FinalStateAnalysis/DataAlgos/interface/PerEventMemo.h"
+
+// What the matching needs of an L1 tau
+struct L1TauRecord {
+  float eta;
+  float phi;
+  float pt;
+  int iso;
+};
+
+// The bunch crossing 0 taus of [taus] with pt >= [minPt]
+std::vector<L1TauRecord> compactL1Taus(const BXVector<l1t::Tau>& taus,
+    double minPt);
+
+// The L1 taus matched (dR < 0.5) to each leg, computed once per leg.  Legs
+// are identified by address.
+class L1TauMatchIndex {
+  public:
+    // L1 pt threshold of the tau triggers (2017)
+    static const double triggerPt;
+
+    struct LegMatch {
+      // Pt of the closest L1 tau (any pt) in the cone, or -1
+      float closestPt;
+      // Positions of the L1 taus above triggerPt in the cone
+      std::vector<unsigned> triggerMatches;
+    };
+
+    // Matches of [leg] among [taus], which must be the same array for every
+    // call on this index.
+    const LegMatch& match(const reco::Candidate& leg,
+        const std::vector<L1TauRecord>& taus);
+    // Same, compacting (with no pt cut) the raw [taus] on the first call
+    const LegMatch& match(const reco::Candidate& leg,
+        const BXVector<l1t::Tau>& taus);
+
+  private:
+    struct State {
+      State(): hasRawTaus(false) {}
+      std::map<const reco::Candidate*, LegMatch> legs;
+      bool hasRawTaus;
+      std::vector<L1TauRecord> rawTaus;
+    };
+
+    static const LegMatch& match(State& state, const reco::Candidate& leg,
+        const std::vector<L1TauRecord>& taus);
+
+    PerEventMemo<State> state_;
+};
+
+#endif /* end of include guard: L1TAUMATCHINDEX_Q8WN3JCE */
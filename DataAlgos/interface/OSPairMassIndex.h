@@ -0,0 +1,129 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  OSPairMassIndex.h
+ *
+ *    Description:  Per-event memo of opposite sign pair masses, used by the
+ *                  Z veto (closestZ, smallestMll, closestZMass) columns.
+ *
+ * =====================================================================================
+ */
+
+#ifndef OSPAIRMASSINDEX_H4KQ2ZXA
+#define OSPAIRMASSINDEX_H4KQ2ZXA
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "DataFormats/Candidate/interface/Candidate.h"
+#include "FinalStateAnalysis/DataAlgos/interface/CollectionFilter.h"
+#include "FinalStateAnalysis/DataAlgos/interface/PerEventMemo.h"
+
+// For each (collection, cut) the objects passing the cut are split once by
+// charge, and the results for each leg are stored, so that the many final
+// states (and columns) of an event asking for the same leg only look them
+// up.  Collections are identified like in CollectionFilterCache.
+class OSPairMassIndex {
+  public:
+    typedef reco::Candidate::LorentzVector LorentzVector;
+
+    struct LegMasses {
+      // Smallest |m(leg, x) - mZ| over the opposite sign objects x, or -999
+      double closestZ;
+      // Smallest m(leg, x), or 1000
+      double smallestMll;
+    };
+
+    // Pair masses of [leg] with the objects of [collection] passing
+    // [filter] + "charge()<0" (or "charge()>0" for legs with charge <= 0)
+    template<class C>
+    LegMasses legMasses(const reco::Candidate& leg, const C& collection,
+        const std::string& filter, CollectionFilterCache& cache);
+
+    // Mass of the pair of objects passing [filter] closest to mZ (opposite
+    // or zero charge, different pt, dR > 0.3), or 999
+    template<class C>
+    float closestZMass(const C& collection, const std::string& filter,
+        CollectionFilterCache& cache);
+
+  private:
+    struct Key {
+      const reco::Candidate* first;
+      size_t size;
+      std::string filter;
+      bool operator<(const Key& other) const;
+    };
+
+    struct Entry {
+      Entry(): hasPartners(false), hasClosestZMass(false), closestZMass(999) {}
+      // Partners of positive legs (negative objects) and of the others
+      bool hasPartners;
+      std::vector<LorentzVector> partnersOfPositive;
+      std::vector<LorentzVector> partnersOfOthers;
+      std::map<const reco::Candidate*, LegMasses> legs;
+
+      bool hasClosestZMass;
+      float closestZMass;
+    };
+
+    static const reco::Candidate* first(
+        const std::vector<const reco::Candidate*>& collection) {
+      return collection.empty() ? 0 : collection[0];
+    }
+    template<class C>
+    static const reco::Candidate* first(const C& collection) {
+      return collection.empty() ? 0 : &collection[0];
+    }
+
+    static std::vector<const reco::Candidate*> ptrize(
+        const std::vector<const reco::Candidate*>& collection) {
+      return collection;
+    }
+    template<class C>
+    static std::vector<const reco::Candidate*> ptrize(const C& collection) {
+      return ptrizeCollection(collection);
+    }
+
+    typedef std::map<Key, Entry> Entries;
+    static Entry& entry(Entries& entries, const reco::Candidate* first,
+        size_t size, const std::string& filter);
+    static void fillPartners(Entry& entry,
+        const std::vector<const reco::Candidate*>& collection,
+        const std::string& filter, CollectionFilterCache& cache);
+    static void fillClosestZMass(Entry& entry,
+        const std::vector<const reco::Candidate*>& collection,
+        const std::string& filter, CollectionFilterCache& cache);
+    static LegMasses computeLeg(const Entry& entry,
+        const reco::Candidate& leg);
+
+    PerEventMemo<Entries> entries_;
+};
+
+template<class C> OSPairMassIndex::LegMasses
+OSPairMassIndex::legMasses(const reco::Candidate& leg, const C& collection,
+    const std::string& filter, CollectionFilterCache& cache) {
+  PerEventMemo<Entries>::Lock entries(entries_);
+  Entry& found = entry(*entries, first(collection), collection.size(), filter);
+  if (!found.hasPartners)
+    fillPartners(found, ptrize(collection), filter, cache);
+  std::map<const reco::Candidate*, LegMasses>::const_iterator memo =
+    found.legs.find(&leg);
+  if (memo != found.legs.end())
+    return memo->second;
+  LegMasses result = computeLeg(found, leg);
+  found.legs[&leg] = result;
+  return result;
+}
+
+template<class C> float
+OSPairMassIndex::closestZMass(const C& collection, const std::string& filter,
+    CollectionFilterCache& cache) {
+  PerEventMemo<Entries>::Lock entries(entries_);
+  Entry& found = entry(*entries, first(collection), collection.size(), filter);
+  if (!found.hasClosestZMass)
+    fillClosestZMass(found, ptrize(collection), filter, cache);
+  return found.closestZMass;
+}
+
+#endif /* end of include guard: OSPAIRMASSINDEX_H4KQ2ZXA */
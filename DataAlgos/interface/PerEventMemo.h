@@ -0,0 +1,57 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  PerEventMemo.h
+ *
+ *    Description:  State of the per-event caches held by PATFinalStateEvent.
+ *
+ * =====================================================================================
+ */
+
+#ifndef PEREVENTMEMO_J3VQ8WFE
+#define PEREVENTMEMO_J3VQ8WFE
+
+#include <mutex>
+
+// The per-event caches (CollectionFilterCache, OSPairMassIndex, ...) are
+// transient members of the PATFinalStateEvent, filled on first use.  Their
+// entries are keyed by things which are only valid while the event is
+// processed (object addresses, a collection's first object and size), so a
+// cache must not outlive the event it was filled in.
+//
+// PerEventMemo<State> holds the state of such a cache:
+//  o access goes through a Lock, so the cache can be shared by modules
+//    running concurrently on the same event;
+//  o copies (of the event) start with a default constructed State.
+//
+//   PerEventMemo<std::map<Key, Value> > memo_;
+//   PerEventMemo<std::map<Key, Value> >::Lock values(memo_);
+//   values->find(key) ...
+//
+// References into the State stay valid while the memo lives, as long as
+// the State doesn't move them (e.g. std::map nodes).
+template<class State>
+class PerEventMemo {
+  public:
+    PerEventMemo(): state_() {}
+    PerEventMemo(const PerEventMemo&): state_() {}
+    PerEventMemo& operator=(const PerEventMemo&) { return *this; }
+
+    // Exclusive access to the State for the lifetime of the Lock
+    class Lock {
+      public:
+        explicit Lock(const PerEventMemo& memo):
+          lock_(memo.mutex_), state_(memo.state_) {}
+        State& operator*() const { return state_; }
+        State* operator->() const { return &state_; }
+      private:
+        std::lock_guard<std::mutex> lock_;
+        State& state_;
+    };
+
+  private:
+    mutable State state_;
+    mutable std::mutex mutex_;
+};
+
+#endif /* end of include guard: PEREVENTMEMO_J3VQ8WFE */
@@ -1,18 +1,67 @@
 /*
  * Implementation of the various Track selections used in the H2Tau analysis
  *
- * Authors: truggles 
+ * Authors: truggles
  *
  */
 
 #ifndef TRACKSELECTIONS_9N7EKFZ2
 #define TRACKSELECTIONS_9N7EKFZ2
 
+#include <map>
+#include <string>
 #include <vector>
 #include "DataFormats/Candidate/interface/Candidate.h"
+#include "DataFormats/HepMCCandidate/interface/GenParticleFwd.h"
 #include "DataFormats/PatCandidates/interface/PackedCandidate.h"
+#include "FinalStateAnalysis/DataAlgos/interface/PerEventMemo.h"
 
-std::vector<double> computeTrackInfo(
-    const std::vector<const reco::Candidate*>& tracks, const std::vector<pat::PackedCandidate> pfs, const reco::GenParticleRefProd genCollectionRef, bool has_gen);
+class CollectionFilterCache;
+
+// The charged pions (from the PV) of a track selection with everything
+// trackVariables reports about them, one array per quantity, sorted by
+// decreasing pt.  None of it depends on the final state.
+struct PreselectedTracks {
+  std::vector<double> pt;
+  std::vector<double> eta;
+  std::vector<double> phi;
+  std::vector<double> charge;
+  std::vector<double> dxy;
+  std::vector<double> dz;
+  std::vector<double> pv;
+  std::vector<double> flag;
+  std::vector<double> iso;
+  std::vector<double> gen;
+
+  size_t size() const { return pt.size(); }
+};
+
+// Isolation, impact parameters and gen match of the [tracks], which are
+// taken from [pfs]
+PreselectedTracks preselectTracks(
+    const std::vector<const reco::Candidate*>& tracks,
+    const std::vector<pat::PackedCandidate>& pfs,
+    const reco::GenParticleRefProd genCollectionRef, bool has_gen);
+
+// The 3 leading [tracks] at least [minDeltaR] away from all [legs]
+// (10 values each), padded to 31 values with -9999
+std::vector<double> computeTrackInfo(const PreselectedTracks& tracks,
+    const std::vector<const reco::Candidate*>& legs, double minDeltaR);
+
+// preselectTracks of the event's packed candidates, for each track cut
+// (see PerEventMemo)
+class TrackPreselectionCache {
+  public:
+    // The preselected [pfs] passing [filter]
+    const PreselectedTracks& tracks(
+        const std::vector<pat::PackedCandidate>& pfs,
+        const std::string& filter,
+        const reco::GenParticleRefProd genCollectionRef, bool has_gen,
+        CollectionFilterCache& cache);
+
+  private:
+    typedef std::map<std::string, PreselectedTracks> Tracks;
+    PerEventMemo<Tracks> tracks_;
+};
 
 #endif /* end of include guard: TRACKSELECTIONS_9N7EKFZ2 */
@@ -2,37 +2,73 @@
 #include "DataFormats/Candidate/interface/Candidate.h"
 #include "DataFormats/Math/interface/deltaR.h"
 #include "CommonTools/Utils/interface/StringCutObjectSelector.h"
+#include "FinalStateAnalysis/Utilities/interface/ExpressionRegistry.h"
 
 // Function cache
 namespace {
 
 typedef StringCutObjectSelector<reco::Candidate, true> CandFunc;
-typedef std::map<std::string, CandFunc> CandFuncCache;
-static CandFuncCache functions_;
 
 const CandFunc& getFunction(const std::string& function) {
-  CandFuncCache::iterator findFunc = functions_.find(function);
-  // Build it if we haven't made it
-  if (findFunc == functions_.end()) {
-    functions_.insert(std::make_pair(function, CandFunc(function)));
-    findFunc = functions_.find(function);
-  }
-  return findFunc->second;
+  return ek::cachedExpression<CandFunc>(function, true);
+}
+
+// Cut results for [collection] from the cache, or null if there is no cache
+const std::vector<bool>* getResults(
+    const std::vector<const reco::Candidate*>& collection,
+    const std::string& filter,
+    CollectionFilterCache* cache) {
+  if (!cache)
+    return 0;
+  return &cache->results(collection, filter);
 }
 
 }
 
+bool CollectionFilterCache::Key::operator<(const Key& other) const {
+  if (first != other.first)
+    return first < other.first;
+  if (size != other.size)
+    return size < other.size;
+  return filter < other.filter;
+}
+
+const std::vector<bool>& CollectionFilterCache::results(
+    const std::vector<const reco::Candidate*>& collection,
+    const std::string& filter) {
+  Key key;
+  key.first = collection.empty() ? 0 : collection[0];
+  key.size = collection.size();
+  key.filter = filter;
+
+  PerEventMemo<Results>::Lock results(results_);
+  Results::iterator found = results->find(key);
+  if (found != results->end())
+    return found->second;
+
+  const CandFunc& filterFunc = getFunction(filter);
+  std::vector<bool> passes(collection.size());
+  for (size_t i = 0; i < collection.size(); ++i) {
+    passes[i] = filterFunc(*collection[i]);
+  }
+  return results->insert(std::make_pair(key, passes)).first->second;
+}
+
 // Get objects at least [minDeltaR] away from hardScatter objects
 std::vector<const reco::Candidate*> getVetoObjects(
     const std::vector<const reco::Candidate*>& hardScatter,
     const std::vector<const reco::Candidate*>& vetoCollection,
     double minDeltaR,
-    const std::string& filter) {
+    const std::string& filter,
+    CollectionFilterCache* cache) {
   std::vector<const reco::Candidate*> output;
 
-  const CandFunc& filterFunc = getFunction(filter);
+  const std::vector<bool>* passes = getResults(vetoCollection, filter, cache);
+  const CandFunc* filterFunc = passes ? 0 : &getFunction(filter);
 
   for (size_t i = 0; i < vetoCollection.size(); ++i) {
+    if (passes && !(*passes)[i])
+      continue;
     const reco::Candidate* ptr = vetoCollection[i];
     bool awayFromEverything = true;
     for (size_t j = 0; j < hardScatter.size(); ++j) {
@@ -42,7 +78,7 @@ std::vector<const reco::Candidate*> getVetoObjects(
         break;
       }
     }
-    if (awayFromEverything && (filterFunc)(*ptr)) {
+    if (awayFromEverything && (passes || (*filterFunc)(*ptr))) {
       output.push_back(ptr);
     }
   }
@@ -53,12 +89,16 @@ std::vector<const reco::Candidate*> getVetoOSObjects(
     const std::vector<const reco::Candidate*>& hardScatter,
     const std::vector<const reco::Candidate*>& vetoCollection,
     double minDeltaR,
-    const std::string& filter) {
+    const std::string& filter,
+    CollectionFilterCache* cache) {
   std::vector<const reco::Candidate*> output;
 
-  const CandFunc& filterFunc = getFunction(filter);
+  const std::vector<bool>* passes = getResults(vetoCollection, filter, cache);
+  const CandFunc* filterFunc = passes ? 0 : &getFunction(filter);
 
   for (size_t i = 0; i < vetoCollection.size(); ++i) {
+    if (passes && !(*passes)[i])
+      continue;
     const reco::Candidate* ptr = vetoCollection[i];
     bool awayFromEverything = true;
     for (size_t j = 0; j < 1; ++j) {
@@ -68,7 +108,7 @@ std::vector<const reco::Candidate*> getVetoOSObjects(
         break;
       }
     }
-    if (awayFromEverything && (filterFunc)(*ptr) && ptr->charge()*hardScatter[0]->charge()<0) {
+    if (awayFromEverything && (passes || (*filterFunc)(*ptr)) && ptr->charge()*hardScatter[0]->charge()<0) {
       output.push_back(ptr);
     }
   }
@@ -81,16 +121,20 @@ std::vector<const reco::Candidate*> getOverlapObjects(
     const reco::Candidate& candidate,
     const std::vector<const reco::Candidate*>& overlapCollection,
     double minDeltaR,
-    const std::string& filter) {
+    const std::string& filter,
+    CollectionFilterCache* cache) {
   std::vector<const reco::Candidate*> output;
 
-  const CandFunc& filterFunc = getFunction(filter);
+  const std::vector<bool>* passes = getResults(overlapCollection, filter, cache);
+  const CandFunc* filterFunc = passes ? 0 : &getFunction(filter);
 
   for (size_t i = 0; i < overlapCollection.size(); ++i) {
+    if (passes && !(*passes)[i])
+      continue;
     const reco::Candidate* ptr = overlapCollection[i];
     double deltaR = reco::deltaR(ptr->p4(), candidate.p4());
     if (deltaR < minDeltaR) {
-      if ((filterFunc)(*ptr)) {
+      if (passes || (*filterFunc)(*ptr)) {
         output.push_back(ptr);
       }
     }
@@ -102,18 +146,18 @@ std::vector<const reco::Candidate*> getOverlapObjects(
 // Get objects passing filter
 std::vector<const reco::Candidate*> getObjectsPassingFilter(
     const std::vector<const reco::Candidate*>& collection,
-    const std::string& filter) {
+    const std::string& filter,
+    CollectionFilterCache* cache) {
   std::vector<const reco::Candidate*> output;
 
-  const CandFunc& filterFunc = getFunction(filter);
+  const std::vector<bool>* passes = getResults(collection, filter, cache);
+  const CandFunc* filterFunc = passes ? 0 : &getFunction(filter);
 
   for (size_t i = 0; i < collection.size(); ++i) {
     const reco::Candidate* ptr = collection[i];
-    if ((filterFunc)(*ptr)) {
+    if (passes ? (*passes)[i] : (*filterFunc)(*ptr)) {
       output.push_back(ptr);
     }
   }
   return output;
 }
-
-
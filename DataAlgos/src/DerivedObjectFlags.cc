@@ -0,0 +1,55 @@
+#include "FinalStateAnalysis/DataAlgos/interface/DerivedObjectFlags.h"
+
+#include <cmath>
+
+namespace {
+
+bool isTightSIPMuon(const pat::Muon& muon, const reco::Vertex& pv) {
+  return (muon.isGlobalMuon() ||
+      (muon.isTrackerMuon() && muon.numberOfMatchedStations() > 0))
+    && muon.isPFMuon()
+    && muon.pt() > 5
+    && std::abs(muon.eta()) < 2.4
+    && muon.muonBestTrack()->dxy(pv.position()) < 0.5
+    && muon.muonBestTrack()->dz(pv.position()) < 1.
+    && muon.muonBestTrackType() != 2
+    && std::abs(muon.dB(pat::Muon::PV3D) / muon.edB(pat::Muon::PV3D)) < 4;
+}
+
+}
+
+const DerivedObjectFlags::Objects& DerivedObjectFlags::muons(
+    const pat::MuonCollection& muons, const reco::Vertex& pv) {
+  PerEventMemo<Tables>::Lock tables(tables_);
+  Objects& output = tables->muons;
+  if (tables->hasMuons)
+    return output;
+  output.eta.reserve(muons.size());
+  output.phi.reserve(muons.size());
+  output.flags.reserve(muons.size());
+  for (size_t i = 0; i < muons.size(); ++i) {
+    const pat::Muon& muon = muons[i];
+    output.eta.push_back(muon.eta());
+    output.phi.push_back(muon.phi());
+    unsigned flags = 0;
+    if (isTightSIPMuon(muon, pv))
+      flags |= kTightSIPMuon;
+    output.flags.push_back(flags);
+  }
+  tables->hasMuons = true;
+  return output;
+}
+
+const std::vector<double>& DerivedObjectFlags::vertexZ(
+    const std::vector<edm::Ptr<reco::Vertex> >& vertices) {
+  PerEventMemo<Tables>::Lock tables(tables_);
+  std::vector<double>& output = tables->vertexZ;
+  if (tables->hasVertices)
+    return output;
+  output.reserve(vertices.size());
+  for (size_t i = 0; i < vertices.size(); ++i) {
+    output.push_back(vertices[i]->z());
+  }
+  tables->hasVertices = true;
+  return output;
+}
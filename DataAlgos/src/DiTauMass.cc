@@ -0,0 +1,137 @@
+#include "FinalStateAnalysis/DataAlgos/interface/DiTauMass.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+const double tauMass = 1.77686;
+
+// Scan of the mass, log spaced between mVis and maxMassRatio*mVis
+const size_t nMassSteps = 200;
+const double maxMassRatio = 20.;
+// Integration over x1 at each mass, log spaced
+const size_t nFractionSteps = 50;
+
+struct TauLeg {
+  TauLeg(const reco::Candidate::LorentzVector& vis, int pdgId):
+    px(vis.px()), py(vis.py()) {
+    const int absId = std::abs(pdgId);
+    leptonic = (absId == 11 || absId == 13);
+    // A hadronic decay can't give a visible fraction below mVis^2/mTau^2
+    xMin = leptonic ? 1e-4 :
+      std::min(std::max(vis.M2(), 0.)/(tauMass*tauMass), 0.9);
+  }
+
+  // Density of the visible momentum fraction x
+  double density(double x) const {
+    if (x < xMin || x > 1)
+      return 0;
+    if (leptonic)
+      return 5./3. - 3.*x*x + 4./3.*x*x*x;
+    return 1./(1. - xMin);
+  }
+
+  double px;
+  double py;
+  bool leptonic;
+  double xMin;
+};
+
+}
+
+namespace fshelpers {
+
+double diTauMass(const reco::Candidate::LorentzVector& vis1, int pdgId1,
+                 const reco::Candidate::LorentzVector& vis2, int pdgId2,
+                 double metPx, double metPy, const double covariance[4]) {
+  const double det = covariance[0]*covariance[3] -
+    covariance[1]*covariance[2];
+  const double mVis = (vis1 + vis2).M();
+  if (!(det > 0) || !(mVis > 0))
+    return -999;
+
+  const TauLeg leg1(vis1, pdgId1);
+  const TauLeg leg2(vis2, pdgId2);
+
+  // Log likelihood of each (mass, x1) point
+  const double logMassStep = std::log(maxMassRatio)/nMassSteps;
+  std::vector<double> logL(nMassSteps*nFractionSteps, -HUGE_VAL);
+  double maxLogL = -HUGE_VAL;
+  for (size_t im = 0; im < nMassSteps; ++im) {
+    const double mass = mVis*std::exp((im + 0.5)*logMassStep);
+    // x1*x2 at this mass
+    const double product = (mVis*mVis)/(mass*mass);
+    // x2 <= 1 and x2 >= xMin2
+    const double x1Low = std::max(leg1.xMin, product);
+    const double x1High = std::min(1., product/leg2.xMin);
+    if (!(x1High > x1Low))
+      continue;
+    const double logX1Step = std::log(x1High/x1Low)/nFractionSteps;
+    for (size_t ix = 0; ix < nFractionSteps; ++ix) {
+      const double x1 = x1Low*std::exp((ix + 0.5)*logX1Step);
+      const double x2 = product/x1;
+      // Decay spectra, and m/mVis = 1/sqrt(x1 x2) from going from the tau
+      // momenta to the visible fractions at fixed mass
+      const double weight = leg1.density(x1)*leg2.density(x2)/
+        std::sqrt(x1*x2);
+      if (!(weight > 0))
+        continue;
+      // MET residual after removing the neutrinos
+      const double nuPx = leg1.px*(1./x1 - 1.) + leg2.px*(1./x2 - 1.);
+      const double nuPy = leg1.py*(1./x1 - 1.) + leg2.py*(1./x2 - 1.);
+      const double rx = metPx - nuPx;
+      const double ry = metPy - nuPy;
+      const double chi2 = (rx*(covariance[3]*rx - covariance[1]*ry) +
+          ry*(covariance[0]*ry - covariance[2]*rx))/det;
+      // dx1 = x1 dlog(x1), |dx2/dm| = 2 x2/m
+      const double value = -0.5*chi2 +
+        std::log(weight*x1*logX1Step*2.*x2/mass);
+      logL[im*nFractionSteps + ix] = value;
+      maxLogL = std::max(maxLogL, value);
+    }
+  }
+  if (maxLogL == -HUGE_VAL)
+    return -999;
+
+  // Likelihood of each mass, integrated over x1
+  std::vector<double> massL(nMassSteps, 0.);
+  size_t best = 0;
+  for (size_t im = 0; im < nMassSteps; ++im) {
+    for (size_t ix = 0; ix < nFractionSteps; ++ix) {
+      massL[im] += std::exp(logL[im*nFractionSteps + ix] - maxLogL);
+    }
+    if (massL[im] > massL[best])
+      best = im;
+  }
+
+  // Parabolic interpolation of the peak in log(mass)
+  double offset = 0;
+  if (best > 0 && best + 1 < nMassSteps) {
+    const double down = massL[best - 1];
+    const double peak = massL[best];
+    const double up = massL[best + 1];
+    const double curvature = down - 2*peak + up;
+    if (curvature < 0)
+      offset = 0.5*(down - up)/curvature;
+  }
+  return mVis*std::exp((best + 0.5 + offset)*logMassStep);
+}
+
+}
+
+bool DiTauMassCache::find(const Key& key, double& mass) const {
+  PerEventMemo<Masses>::Lock masses(masses_);
+  Masses::const_iterator found = masses->find(key);
+  if (found == masses->end())
+    return false;
+  mass = found->second;
+  return true;
+}
+
+void DiTauMassCache::insert(const Key& key, double mass) {
+  PerEventMemo<Masses>::Lock masses(masses_);
+  (*masses)[key] = mass;
+}
@@ -0,0 +1,72 @@
+#include "FinalStateAnalysis/DataAlgos/interface/GenMatchCache.h"
+#include "DataFormats/HepMCCandidate/interface/GenParticle.h"
+
+bool GenMatchCache::Leg::operator<(const Leg& other) const {
+  if (id != other.id)
+    return id < other.id;
+  return key < other.key;
+}
+
+bool GenMatchCache::ParticleKey::operator<(const ParticleKey& other) const {
+  if (leg < other.leg)
+    return true;
+  if (other.leg < leg)
+    return false;
+  if (pdgId != other.pdgId)
+    return pdgId < other.pdgId;
+  if (checkCharge != other.checkCharge)
+    return checkCharge < other.checkCharge;
+  return preFSR < other.preFSR;
+}
+
+bool GenMatchCache::findParticle(const Leg& leg, int pdgId,
+    bool checkCharge, bool preFSR, reco::GenParticleRef& particle) const {
+  ParticleKey key = {leg, pdgId, checkCharge, preFSR};
+  PerEventMemo<Matches>::Lock matches(matches_);
+  std::map<ParticleKey, reco::GenParticleRef>::const_iterator found =
+    matches->particles.find(key);
+  if (found == matches->particles.end())
+    return false;
+  particle = found->second;
+  return true;
+}
+
+void GenMatchCache::insertParticle(const Leg& leg, int pdgId,
+    bool checkCharge, bool preFSR, const reco::GenParticleRef& particle) {
+  ParticleKey key = {leg, pdgId, checkCharge, preFSR};
+  PerEventMemo<Matches>::Lock matches(matches_);
+  matches->particles[key] = particle;
+}
+
+bool GenMatchCache::findValue(const Leg& leg, Quantity quantity,
+    std::vector<double>& value) const {
+  PerEventMemo<Matches>::Lock matches(matches_);
+  Values::const_iterator found =
+    matches->values.find(std::make_pair(leg, int(quantity)));
+  if (found == matches->values.end())
+    return false;
+  value = found->second;
+  return true;
+}
+
+void GenMatchCache::insertValue(const Leg& leg, Quantity quantity,
+    const std::vector<double>& value) {
+  PerEventMemo<Matches>::Lock matches(matches_);
+  matches->values[std::make_pair(leg, int(quantity))] = value;
+}
+
+bool GenMatchCache::findGenTaus(
+    std::vector<reco::Candidate::LorentzVector>& genTaus) const {
+  PerEventMemo<Matches>::Lock matches(matches_);
+  if (!matches->hasGenTaus)
+    return false;
+  genTaus = matches->genTaus;
+  return true;
+}
+
+void GenMatchCache::insertGenTaus(
+    const std::vector<reco::Candidate::LorentzVector>& genTaus) {
+  PerEventMemo<Matches>::Lock matches(matches_);
+  matches->genTaus = genTaus;
+  matches->hasGenTaus = true;
+}
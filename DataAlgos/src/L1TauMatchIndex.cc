@@ -0,0 +1,69 @@
+#include "FinalStateAnalysis/DataAlgos/interface/L1TauMatchIndex.h"
+#include "DataFormats/Math/interface/deltaR.h"
+
+namespace {
+  const double matchDeltaR2 = 0.5*0.5;
+}
+
+const double L1TauMatchIndex::triggerPt = 32;
+
+std::vector<L1TauRecord> compactL1Taus(const BXVector<l1t::Tau>& taus,
+    double minPt) {
+  std::vector<L1TauRecord> output;
+  // Check the range first, isEmpty() does not
+  if (taus.getFirstBX() > 0 || taus.getLastBX() < 0 || taus.isEmpty(0))
+    return output;
+  for (BXVector<l1t::Tau>::const_iterator tau = taus.begin(0);
+      tau != taus.end(0); ++tau) {
+    if (tau->pt() < minPt)
+      continue;
+    L1TauRecord record;
+    record.eta = tau->eta();
+    record.phi = tau->phi();
+    record.pt = tau->pt();
+    record.iso = tau->hwIso();
+    output.push_back(record);
+  }
+  return output;
+}
+
+const L1TauMatchIndex::LegMatch& L1TauMatchIndex::match(
+    const reco::Candidate& leg, const std::vector<L1TauRecord>& taus) {
+  PerEventMemo<State>::Lock state(state_);
+  return match(*state, leg, taus);
+}
+
+const L1TauMatchIndex::LegMatch& L1TauMatchIndex::match(
+    const reco::Candidate& leg, const BXVector<l1t::Tau>& taus) {
+  PerEventMemo<State>::Lock state(state_);
+  if (!state->hasRawTaus) {
+    state->rawTaus = compactL1Taus(taus, 0);
+    state->hasRawTaus = true;
+  }
+  return match(*state, leg, state->rawTaus);
+}
+
+const L1TauMatchIndex::LegMatch& L1TauMatchIndex::match(State& state,
+    const reco::Candidate& leg, const std::vector<L1TauRecord>& taus) {
+  std::map<const reco::Candidate*, LegMatch>::iterator found =
+    state.legs.find(&leg);
+  if (found != state.legs.end())
+    return found->second;
+  LegMatch& output = state.legs[&leg];
+  output.closestPt = -1;
+  const double eta = leg.eta();
+  const double phi = leg.phi();
+  double closestDR2 = matchDeltaR2;
+  for (size_t i = 0; i < taus.size(); ++i) {
+    const double dR2 = reco::deltaR2(eta, phi, taus[i].eta, taus[i].phi);
+    if (dR2 >= matchDeltaR2)
+      continue;
+    if (dR2 < closestDR2) {
+      closestDR2 = dR2;
+      output.closestPt = taus[i].pt;
+    }
+    if (taus[i].pt >= triggerPt)
+      output.triggerMatches.push_back(i);
+  }
+  return output;
+}
@@ -0,0 +1,85 @@
+#include "FinalStateAnalysis/DataAlgos/interface/OSPairMassIndex.h"
+#include "DataFormats/Math/interface/deltaR.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+  const double nominalZMass = 91.1876;
+}
+
+bool OSPairMassIndex::Key::operator<(const Key& other) const {
+  if (first != other.first)
+    return first < other.first;
+  if (size != other.size)
+    return size < other.size;
+  return filter < other.filter;
+}
+
+OSPairMassIndex::Entry& OSPairMassIndex::entry(Entries& entries,
+    const reco::Candidate* first, size_t size, const std::string& filter) {
+  Key key;
+  key.first = first;
+  key.size = size;
+  key.filter = filter;
+  return entries[key];
+}
+
+void OSPairMassIndex::fillPartners(Entry& entry,
+    const std::vector<const reco::Candidate*>& collection,
+    const std::string& filter, CollectionFilterCache& cache) {
+  // Same cut strings as the per-leg veto objects used to be selected with
+  const std::vector<bool>& negative = cache.results(
+      collection, filter + "charge()<0");
+  const std::vector<bool>& positive = cache.results(
+      collection, filter + "charge()>0");
+  for (size_t i = 0; i < collection.size(); ++i) {
+    if (negative[i])
+      entry.partnersOfPositive.push_back(collection[i]->p4());
+    if (positive[i])
+      entry.partnersOfOthers.push_back(collection[i]->p4());
+  }
+  entry.hasPartners = true;
+}
+
+OSPairMassIndex::LegMasses OSPairMassIndex::computeLeg(const Entry& entry,
+    const reco::Candidate& leg) {
+  const std::vector<LorentzVector>& partners = leg.charge() > 0 ?
+    entry.partnersOfPositive : entry.partnersOfOthers;
+  LegMasses output;
+  output.closestZ = partners.empty() ? -999 : 1000;
+  output.smallestMll = 1000;
+  for (size_t j = 0; j < partners.size(); ++j) {
+    double mass = (leg.p4() + partners[j]).mass();
+    output.closestZ = std::min(output.closestZ,
+        std::abs(mass - nominalZMass));
+    output.smallestMll = std::min(output.smallestMll, mass);
+  }
+  return output;
+}
+
+void OSPairMassIndex::fillClosestZMass(Entry& entry,
+    const std::vector<const reco::Candidate*>& collection,
+    const std::string& filter, CollectionFilterCache& cache) {
+  std::vector<const reco::Candidate*> candidates = getObjectsPassingFilter(
+      collection, filter, &cache);
+  float bestZmass = 999;
+  float absBestZmass = 999;
+  for (size_t i = 0; i < candidates.size(); ++i) {
+    const reco::Candidate* cand1 = candidates[i];
+    for (size_t j = i + 1; j < candidates.size(); ++j) {
+      const reco::Candidate* cand2 = candidates[j];
+      if (cand1->pt() == cand2->pt()) continue;
+      if (cand1->charge()*cand2->charge() > 0) continue;
+      if (reco::deltaR(cand1->p4(), cand2->p4()) < 0.3) continue;
+      float currentZmass = (cand1->p4() + cand2->p4()).M();
+      float absCurrentZmass = std::fabs(currentZmass - nominalZMass);
+      if (absCurrentZmass < absBestZmass) {
+        absBestZmass = absCurrentZmass;
+        bestZmass = currentZmass;
+      }
+    }
+  }
+  entry.closestZMass = bestZmass;
+  entry.hasClosestZMass = true;
+}
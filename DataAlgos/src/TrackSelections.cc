@@ -1,12 +1,23 @@
-//#include "FinalStateAnalysis/DataAlgos/interface/TrackSelections.h"
-#include "FinalStateAnalysis/DataFormats/interface/PATFinalState.h"
+#include "FinalStateAnalysis/DataAlgos/interface/TrackSelections.h"
+#include "FinalStateAnalysis/DataAlgos/interface/CollectionFilter.h"
 
 #include "DataFormats/Candidate/interface/Candidate.h"
+#include "DataFormats/HepMCCandidate/interface/GenParticle.h"
 #include "DataFormats/RecoCandidate/interface/RecoCandidate.h"
 //#include "DataFormats/RecoCandidate/interface/TrackCandidate.h"
 #include "DataFormats/Math/interface/deltaPhi.h"
-#include "FWCore/ParameterSet/interface/FileInPath.h"
-#include "DataFormats/PatCandidates/interface/Jet.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Distance in eta-phi, as used for the track isolation
+double trackDR(double eta1, double phi1, double eta2, double phi2) {
+  const double dEta = eta1 - eta2;
+  const double dPhi = deltaPhi(phi1, phi2);
+  return std::sqrt(dEta*dEta + dPhi*dPhi);
+}
 
 struct mypion{
   double p_pt;
@@ -21,103 +32,141 @@ struct mypion{
   double p_flag;
 };
 
-std::vector<double> computeTrackInfo(
-    const std::vector<const reco::Candidate*>& tracks, const std::vector<pat::PackedCandidate> pfs, const reco::GenParticleRefProd genCollectionRef, bool has_gen) {
-  std::vector<mypion> pion_list;
+}
 
-  std::vector<double> output;
+PreselectedTracks preselectTracks(
+    const std::vector<const reco::Candidate*>& tracks,
+    const std::vector<pat::PackedCandidate>& pfs,
+    const reco::GenParticleRefProd genCollectionRef, bool has_gen) {
+  // Everything the isolation needs of the packed candidates, read once
+  const size_t nPF = pfs.size();
+  std::vector<double> pfEta(nPF), pfPhi(nPF), pfPt(nPF);
+  std::vector<int> pfCharge(nPF), pfFromPV(nPF);
+  for (size_t i = 0; i < nPF; ++i) {
+    pfEta[i] = pfs[i].eta();
+    pfPhi[i] = pfs[i].phi();
+    pfPt[i] = pfs[i].pt();
+    pfCharge[i] = pfs[i].charge();
+    pfFromPV[i] = pfs[i].fromPV();
+  }
 
-  int numTracks = tracks.size();
+  // Only charged pions can be gen matched
+  std::vector<double> genEta, genPhi;
+  if (has_gen) {
+    const reco::GenParticleCollection& genParticles = *genCollectionRef;
+    for (size_t m = 0; m != genParticles.size(); ++m) {
+      if (std::abs(genParticles[m].pdgId()) != 211)
+        continue;
+      genEta.push_back(genParticles[m].eta());
+      genPhi.push_back(genParticles[m].phi());
+    }
+  }
 
+  std::vector<mypion> pion_list;
   for (const reco::Candidate *mytrack : tracks) {
-     if (fabs(mytrack->pdgId())==211){
-	mypion mp1;
-        double charged = 0, neutral = 0, pileup  = 0;
-        for (unsigned int i = 0, n = pfs.size(); i < n; ++i) {
-            const pat::PackedCandidate pf = pfs[i];
-	    if (sqrt((pf.eta()-mytrack->eta())*(pf.eta()-mytrack->eta())+deltaPhi(pf.phi(),mytrack->phi())*deltaPhi(pf.phi(),mytrack->phi()))<0.3 && sqrt((pf.eta()-mytrack->eta())*(pf.eta()-mytrack->eta())+deltaPhi(pf.phi(),mytrack->phi())*deltaPhi(pf.phi(),mytrack->phi()))>0.001){
-                if (pf.charge() == 0) {
-                    if (pf.pt() > 0.5) neutral += pf.pt();
-                } else if (pf.fromPV() >= 2) {
-                    charged += pf.pt();
-                } else {
-                    if (pf.pt() > 0.5) pileup += pf.pt();
-                }
-            }
-            if (sqrt((pf.eta()-mytrack->eta())*(pf.eta()-mytrack->eta())+deltaPhi(pf.phi(),mytrack->phi())*deltaPhi(pf.phi(),mytrack->phi()))<0.001){
-		mp1.p_dxy=pf.dxy();
-                mp1.p_dz=pf.dz();
-                mp1.p_pv=pf.fromPV();
-                mp1.p_flag=pf.trackHighPurity();
-	    }
-        }
-        double iso = charged + std::max(0.0, neutral-0.5*pileup);
-	mp1.p_iso=iso;
-
-	double genID=-1;
-        if (has_gen){
-            reco::GenParticleCollection genParticles = *genCollectionRef;
-            if ( genParticles.size() > 0 ) {
-                reco::GenParticle& closest = genParticles[0];
-                double closestDR = 999;
-                for(size_t m = 0; m != genParticles.size(); ++m) {
-                    reco::GenParticle& genp = genParticles[m];
-	            double tmpDR = sqrt((genp.eta()-mytrack->eta())*(genp.eta()-mytrack->eta())+deltaPhi(genp.phi(),mytrack->phi())*deltaPhi(genp.phi(),mytrack->phi()));
-                    if ( fabs(genp.pdgId())==211 && tmpDR < closestDR ) { closest = genp; closestDR = tmpDR; }
-                }
-                genID = abs(closest.pdgId());
-                if (closestDR>0.2) genID = -1;
-	    }
+    if (std::abs(mytrack->pdgId()) != 211)
+      continue;
+    mypion mp1;
+    mp1.p_dxy = mp1.p_dz = mp1.p_pv = mp1.p_flag = 0;
+    const double eta = mytrack->eta();
+    const double phi = mytrack->phi();
+    double charged = 0, neutral = 0, pileup  = 0;
+    for (size_t i = 0; i < nPF; ++i) {
+      const double dR = trackDR(pfEta[i], pfPhi[i], eta, phi);
+      if (dR < 0.3 && dR > 0.001) {
+        if (pfCharge[i] == 0) {
+          if (pfPt[i] > 0.5) neutral += pfPt[i];
+        } else if (pfFromPV[i] >= 2) {
+          charged += pfPt[i];
+        } else {
+          if (pfPt[i] > 0.5) pileup += pfPt[i];
         }
-	mp1.p_gen=genID;
-	mp1.p_pt=mytrack->pt();
-        mp1.p_eta=mytrack->eta();
-        mp1.p_phi=mytrack->phi();
-        mp1.p_charge=mytrack->charge();
-        if (mp1.p_pv>1) pion_list.push_back(mp1);
+      }
+      // The track itself
+      if (dR < 0.001) {
+        mp1.p_dxy = pfs[i].dxy();
+        mp1.p_dz = pfs[i].dz();
+        mp1.p_pv = pfFromPV[i];
+        mp1.p_flag = pfs[i].trackHighPurity();
+      }
     }
-  }
+    if (!(mp1.p_pv > 1))
+      continue;
+    mp1.p_iso = charged + std::max(0.0, neutral-0.5*pileup);
 
-  std::sort(begin(pion_list), end(pion_list), [](mypion a, mypion b){return a.p_pt > b.p_pt;});
-
-  if (pion_list.size()>0){
-    output.push_back(pion_list[0].p_pt);
-    output.push_back(pion_list[0].p_eta);
-    output.push_back(pion_list[0].p_phi);
-    output.push_back(pion_list[0].p_charge);
-    output.push_back(pion_list[0].p_dxy);
-    output.push_back(pion_list[0].p_dz);
-    output.push_back(pion_list[0].p_pv);
-    output.push_back(pion_list[0].p_flag);
-    output.push_back(pion_list[0].p_iso);
-    output.push_back(pion_list[0].p_gen);
-  }
-  if (pion_list.size()>1){
-    output.push_back(pion_list[1].p_pt);
-    output.push_back(pion_list[1].p_eta);
-    output.push_back(pion_list[1].p_phi);
-    output.push_back(pion_list[1].p_charge);
-    output.push_back(pion_list[1].p_dxy);
-    output.push_back(pion_list[1].p_dz);
-    output.push_back(pion_list[1].p_pv);
-    output.push_back(pion_list[1].p_flag);
-    output.push_back(pion_list[1].p_iso);
-    output.push_back(pion_list[1].p_gen);
+    double genID = -1;
+    if (has_gen) {
+      double closestDR = 999;
+      for (size_t m = 0; m < genEta.size(); ++m) {
+        closestDR = std::min(closestDR,
+            trackDR(genEta[m], genPhi[m], eta, phi));
+      }
+      if (closestDR <= 0.2) genID = 211;
+    }
+    mp1.p_gen = genID;
+    mp1.p_pt = mytrack->pt();
+    mp1.p_eta = eta;
+    mp1.p_phi = phi;
+    mp1.p_charge = mytrack->charge();
+    pion_list.push_back(mp1);
   }
-  if (pion_list.size()>2){
-    output.push_back(pion_list[2].p_pt);
-    output.push_back(pion_list[2].p_eta);
-    output.push_back(pion_list[2].p_phi);
-    output.push_back(pion_list[2].p_charge);
-    output.push_back(pion_list[2].p_dxy);
-    output.push_back(pion_list[2].p_dz);
-    output.push_back(pion_list[2].p_pv);
-    output.push_back(pion_list[2].p_flag);
-    output.push_back(pion_list[2].p_iso);
-    output.push_back(pion_list[2].p_gen);
+
+  std::stable_sort(begin(pion_list), end(pion_list),
+      [](const mypion& a, const mypion& b){return a.p_pt > b.p_pt;});
+
+  PreselectedTracks output;
+  for (const mypion& pion : pion_list) {
+    output.pt.push_back(pion.p_pt);
+    output.eta.push_back(pion.p_eta);
+    output.phi.push_back(pion.p_phi);
+    output.charge.push_back(pion.p_charge);
+    output.dxy.push_back(pion.p_dxy);
+    output.dz.push_back(pion.p_dz);
+    output.pv.push_back(pion.p_pv);
+    output.flag.push_back(pion.p_flag);
+    output.iso.push_back(pion.p_iso);
+    output.gen.push_back(pion.p_gen);
   }
+  return output;
+}
 
+std::vector<double> computeTrackInfo(const PreselectedTracks& tracks,
+    const std::vector<const reco::Candidate*>& legs, double minDeltaR) {
+  const size_t n = tracks.size();
+  const double minDeltaR2 = minDeltaR*minDeltaR;
+  // Tracks away from all legs, one branch free pass per leg
+  std::vector<char> away(n, 1);
+  for (const reco::Candidate* leg : legs) {
+    const double legEta = leg->eta();
+    const double legPhi = leg->phi();
+    const double* eta = tracks.eta.data();
+    const double* phi = tracks.phi.data();
+    char* keep = away.data();
+    for (size_t t = 0; t < n; ++t) {
+      const double dEta = eta[t] - legEta;
+      double dPhi = phi[t] - legPhi;
+      dPhi = dPhi > M_PI ? dPhi - 2*M_PI : (dPhi <= -M_PI ? dPhi + 2*M_PI : dPhi);
+      keep[t] &= (dEta*dEta + dPhi*dPhi >= minDeltaR2);
+    }
+  }
 
+  std::vector<double> output;
+  output.reserve(31);
+  for (size_t t = 0, found = 0; t < n && found < 3; ++t) {
+    if (!away[t])
+      continue;
+    output.push_back(tracks.pt[t]);
+    output.push_back(tracks.eta[t]);
+    output.push_back(tracks.phi[t]);
+    output.push_back(tracks.charge[t]);
+    output.push_back(tracks.dxy[t]);
+    output.push_back(tracks.dz[t]);
+    output.push_back(tracks.pv[t]);
+    output.push_back(tracks.flag[t]);
+    output.push_back(tracks.iso[t]);
+    output.push_back(tracks.gen[t]);
+    ++found;
+  }
 
   for (int j=output.size(); j<31; ++ j){
     output.push_back( -9999 );
@@ -126,3 +175,17 @@ std::vector<double> computeTrackInfo(
   return output;
 }
 
+const PreselectedTracks& TrackPreselectionCache::tracks(
+    const std::vector<pat::PackedCandidate>& pfs,
+    const std::string& filter,
+    const reco::GenParticleRefProd genCollectionRef, bool has_gen,
+    CollectionFilterCache& cache) {
+  PerEventMemo<Tracks>::Lock tracks(tracks_);
+  Tracks::iterator found = tracks->find(filter);
+  if (found != tracks->end())
+    return found->second;
+  std::vector<const reco::Candidate*> passing = getObjectsPassingFilter(
+      ptrizeCollection(pfs), filter, &cache);
+  return (*tracks)[filter] = preselectTracks(passing, pfs, genCollectionRef,
+      has_gen);
+}
@@ -0,0 +1,543 @@
+/*
+ * Test the DataAlgos helpers
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <Utilities/Testing/interface/CppUnit_testdriver.icpp>
+#include <vector>
+
+#include "FinalStateAnalysis/DataAlgos/interface/CollectionFilter.h"
+#include "FinalStateAnalysis/DataAlgos/interface/DerivedObjectFlags.h"
+#include "FinalStateAnalysis/DataAlgos/interface/DiTauMass.h"
+#include "FinalStateAnalysis/DataAlgos/interface/GenMatchCache.h"
+#include "FinalStateAnalysis/DataAlgos/interface/TrackSelections.h"
+#include "FinalStateAnalysis/DataAlgos/interface/helpers.h"
+
+#include "DataFormats/Candidate/interface/LeafCandidate.h"
+#include "DataFormats/Common/interface/TestHandle.h"
+#include "DataFormats/HepMCCandidate/interface/GenParticle.h"
+#include "DataFormats/Math/interface/LorentzVector.h"
+#include "DataFormats/Math/interface/Vector3D.h"
+#include "DataFormats/Math/interface/deltaPhi.h"
+#include "DataFormats/Math/interface/deltaR.h"
+#include "DataFormats/PatCandidates/interface/Muon.h"
+#include "DataFormats/TrackReco/interface/Track.h"
+#include "DataFormats/VertexReco/interface/Vertex.h"
+
+#include "TRandom3.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// computeTrackInfo as it was before the tracks were preselected per event
+// (without the gen match), applied to the tracks away from the legs.
+std::vector<double> referenceTrackInfo(
+    const std::vector<const reco::Candidate*>& tracks,
+    const std::vector<pat::PackedCandidate>& pfs) {
+  std::vector<std::vector<double> > pions;
+  for (const reco::Candidate* track : tracks) {
+    if (std::abs(track->pdgId()) != 211)
+      continue;
+    double charged = 0, neutral = 0, pileup = 0;
+    double dxy = 0, dz = 0, pv = 0, flag = 0;
+    for (const pat::PackedCandidate& pf : pfs) {
+      const double dR = std::sqrt(std::pow(pf.eta() - track->eta(), 2) +
+          std::pow(deltaPhi(pf.phi(), track->phi()), 2));
+      if (dR < 0.3 && dR > 0.001) {
+        if (pf.charge() == 0) {
+          if (pf.pt() > 0.5) neutral += pf.pt();
+        } else if (pf.fromPV() >= 2) {
+          charged += pf.pt();
+        } else {
+          if (pf.pt() > 0.5) pileup += pf.pt();
+        }
+      }
+      if (dR < 0.001) {
+        dxy = pf.dxy();
+        dz = pf.dz();
+        pv = pf.fromPV();
+        flag = pf.trackHighPurity();
+      }
+    }
+    if (!(pv > 1))
+      continue;
+    const double iso = charged + std::max(0.0, neutral - 0.5*pileup);
+    pions.push_back({track->pt(), track->eta(), track->phi(),
+        double(track->charge()), dxy, dz, pv, flag, iso, -1.});
+  }
+  std::sort(pions.begin(), pions.end(),
+      [](const std::vector<double>& a, const std::vector<double>& b) {
+        return a[0] > b[0]; });
+  std::vector<double> output;
+  for (size_t i = 0; i < pions.size() && i < 3; ++i) {
+    output.insert(output.end(), pions[i].begin(), pions[i].end());
+  }
+  output.resize(31, -9999);
+  return output;
+}
+
+const double tauMass = 1.77686;
+
+// Z -> tau tau with the taus along [tau1] and [tau2] (GeV), m = 91.32
+const math::XYZVector tau1(42, 12, 8);
+const math::XYZVector tau2(-28, -42, 37);
+
+reco::Candidate::LorentzVector visible(const math::XYZVector& tau, double x,
+    double mass) {
+  const math::XYZVector p = x*tau;
+  return reco::Candidate::LorentzVector(p.x(), p.y(), p.z(),
+      std::sqrt(p.mag2() + mass*mass));
+}
+
+double trueMass() {
+  return (visible(tau1, 1, tauMass) + visible(tau2, 1, tauMass)).M();
+}
+
+// Visible fraction of a tau decaying to [pdgId], from the spectra
+// fshelpers::diTauMass assumes
+double randomFraction(TRandom3& randy, int pdgId, double visMass) {
+  if (std::abs(pdgId) == 15) {
+    const double xMin = visMass*visMass/(tauMass*tauMass);
+    return randy.Uniform(xMin, 1);
+  }
+  while (true) {
+    const double x = randy.Rndm();
+    if (randy.Uniform(0, 5./3.) < 5./3. - 3.*x*x + 4./3.*x*x*x)
+      return x;
+  }
+}
+
+// Di-tau mass of the Z with visible fractions [x1], [x2] and the MET of the
+// neutrinos, smeared by [sigma]
+double diTauMass(int pdgId1, double x1, double visMass1,
+    int pdgId2, double x2, double visMass2, double sigma, TRandom3& randy) {
+  const reco::Candidate::LorentzVector vis1 = visible(tau1, x1, visMass1);
+  const reco::Candidate::LorentzVector vis2 = visible(tau2, x2, visMass2);
+  const double metPx = tau1.x() + tau2.x() - vis1.px() - vis2.px() +
+    randy.Gaus(0, sigma);
+  const double metPy = tau1.y() + tau2.y() - vis1.py() - vis2.py() +
+    randy.Gaus(0, sigma);
+  const double covariance[4] = {sigma*sigma, 0, 0, sigma*sigma};
+  return fshelpers::diTauMass(vis1, pdgId1, vis2, pdgId2, metPx, metPy,
+      covariance);
+}
+
+// electronClosestMuonDR as it was before the muon flags were cached
+float referenceClosestMuonDR(const reco::Candidate& electron,
+    const pat::MuonCollection& muons, const reco::Vertex& pv) {
+  float closestDR = 999;
+  for(pat::MuonCollection::const_iterator iMu = muons.begin();
+      iMu != muons.end(); ++iMu)
+    {
+      if(!( // have to pass tight muon cuts + SIP
+           (iMu->isGlobalMuon() || (iMu->isTrackerMuon() && iMu->numberOfMatchedStations() > 0))
+           && iMu->isPFMuon()
+           && iMu->pt() > 5
+           && fabs(iMu->eta()) < 2.4
+           && iMu->muonBestTrack()->dxy(pv.position()) < 0.5
+           && iMu->muonBestTrack()->dz(pv.position()) < 1.
+           && iMu->muonBestTrackType() != 2
+           && fabs(iMu->dB(pat::Muon::PV3D) / iMu->edB(pat::Muon::PV3D)) < 4
+           ))
+        continue;
+      float thisDR = reco::deltaR(electron.p4(), iMu->p4());
+      if(thisDR < closestDR)
+        closestDR = thisDR;
+    }
+  return closestDR;
+}
+
+// genVtxPVMatch as it was before the vertex z were cached, once the gen
+// particle is found
+bool referenceGenVtxPVMatch(float genVZ, const reco::Vertex& pv,
+    const std::vector<edm::Ptr<reco::Vertex> >& vertices) {
+  float genVtxPVDZ = fabs(pv.z() - genVZ);
+  for(std::vector<edm::Ptr<reco::Vertex>>::const_iterator iVtx = vertices.begin();
+      iVtx != vertices.end(); ++iVtx)
+    {
+      if(fabs((*iVtx)->z() - genVZ) < genVtxPVDZ)
+        return false;
+    }
+  return true;
+}
+
+// PATFinalState::getDaughterGenParticle: the cached match of [daughter],
+// counting the calls to fshelpers::getGenParticle in [nComputed]
+reco::GenParticleRef cachedGenParticle(GenMatchCache& cache,
+    const reco::CandidatePtr& daughter,
+    const reco::GenParticleRefProd& genParticles, int pdgId,
+    bool checkCharge, bool preFSR, size_t& nComputed) {
+  const GenMatchCache::Leg leg = {daughter.id(), daughter.key()};
+  reco::GenParticleRef output;
+  if (cache.findParticle(leg, pdgId, checkCharge, preFSR, output))
+    return output;
+  ++nComputed;
+  output = fshelpers::getGenParticle(daughter.get(), genParticles, pdgId,
+      checkCharge, preFSR);
+  cache.insertParticle(leg, pdgId, checkCharge, preFSR, output);
+  return output;
+}
+
+reco::Candidate::LorentzVector ptEtaPhiM(double pt, double eta, double phi,
+    double mass) {
+  return reco::Candidate::LorentzVector(
+      math::PtEtaPhiMLorentzVector(pt, eta, phi, mass));
+}
+
+}
+
+class testDataAlgos: public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(testDataAlgos);
+  CPPUNIT_TEST(testTrackInfo);
+  CPPUNIT_TEST(testDiTauMass);
+  CPPUNIT_TEST(testDerivedObjectFlags);
+  CPPUNIT_TEST(testGenMatchCache);
+  CPPUNIT_TEST_SUITE_END();
+  public:
+    void setUp() {}
+    void tearDown() {}
+    void testTrackInfo();
+    void testDiTauMass();
+    void testDerivedObjectFlags();
+    void testGenMatchCache();
+};
+
+void testDataAlgos::testTrackInfo() {
+  TRandom3 randy(1234);
+  const int pdgIds[] = {211, -211, 211, 22, 130};
+  std::vector<pat::PackedCandidate> pfs;
+  for (int i = 0; i < 60; ++i) {
+    const int pdgId = pdgIds[i % 5];
+    math::PtEtaPhiMLorentzVector p4(0.3 + 20*randy.Rndm(),
+        randy.Uniform(-1.5, 1.5), randy.Uniform(-M_PI, M_PI), 0.1396);
+    // Key 0 is the PV, the others are pileup
+    pfs.push_back(pat::PackedCandidate(reco::Candidate::LorentzVector(p4),
+          reco::Candidate::Point(0, 0, 0), p4.pt(), p4.eta(), p4.phi(),
+          pdgId, reco::VertexRefProd(), i % 3 ? 0 : 1));
+  }
+  std::vector<const reco::Candidate*> tracks = ptrizeCollection(pfs);
+
+  reco::LeafCandidate leg1(1, reco::Candidate::LorentzVector(
+        math::PtEtaPhiMLorentzVector(30, 0.2, 0.5, 0)));
+  reco::LeafCandidate leg2(-1, reco::Candidate::LorentzVector(
+        math::PtEtaPhiMLorentzVector(25, -0.7, -2.5, 0)));
+  std::vector<const reco::Candidate*> legs = {&leg1, &leg2};
+
+  const PreselectedTracks preselected = preselectTracks(tracks, pfs,
+      reco::GenParticleRefProd(), false);
+  const double dRs[] = {0., 0.5, 1.5};
+  for (double dR : dRs) {
+    std::vector<const reco::Candidate*> away;
+    for (const reco::Candidate* track : tracks) {
+      if (reco::deltaR(track->p4(), leg1.p4()) >= dR &&
+          reco::deltaR(track->p4(), leg2.p4()) >= dR)
+        away.push_back(track);
+    }
+    const std::vector<double> expected = referenceTrackInfo(away, pfs);
+    const std::vector<double> output =
+      computeTrackInfo(preselected, legs, dR);
+    CPPUNIT_ASSERT_EQUAL(expected.size(), output.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+      CPPUNIT_ASSERT_DOUBLES_EQUAL(expected[i], output[i], 1e-9);
+    }
+  }
+}
+
+void testDataAlgos::testDiTauMass() {
+  TRandom3 randy(4321);
+  const double mass = trueMass();
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(91.3, mass, 0.1);
+
+  // tau_h tau_h, mu tau_h and e mu
+  const int pdgIds[3][2] = {{15, -15}, {13, -15}, {11, -13}};
+  const double visMasses[3][2] = {{0.77, 0.14}, {0.106, 0.77},
+    {0.0005, 0.106}};
+
+  // Well measured MET: the collinear solution
+  const double fractions[3][2] = {{0.6, 0.45}, {0.5, 0.7}, {0.35, 0.55}};
+  for (size_t i = 0; i < 3; ++i) {
+    const double estimate = diTauMass(
+        pdgIds[i][0], fractions[i][0], visMasses[i][0],
+        pdgIds[i][1], fractions[i][1], visMasses[i][1], 0.1, randy);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(mass, estimate, 0.03*mass);
+  }
+
+  // 10 GeV MET resolution, fractions from the decay spectra, visible legs
+  // above 15 GeV: the median is the Z mass
+  for (size_t i = 0; i < 3; ++i) {
+    std::vector<double> estimates;
+    while (estimates.size() < 1001) {
+      const double x1 = randomFraction(randy, pdgIds[i][0], visMasses[i][0]);
+      const double x2 = randomFraction(randy, pdgIds[i][1], visMasses[i][1]);
+      if (x1*tau1.rho() < 15 || x2*tau2.rho() < 15)
+        continue;
+      estimates.push_back(diTauMass(pdgIds[i][0], x1, visMasses[i][0],
+            pdgIds[i][1], x2, visMasses[i][1], 10, randy));
+    }
+    std::nth_element(estimates.begin(), estimates.begin() + 500,
+        estimates.end());
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(mass, estimates[500], 0.07*mass);
+  }
+
+  // The MET covariance can't be inverted
+  const double singular[4] = {1, 1, 1, 1};
+  CPPUNIT_ASSERT_EQUAL(-999., fshelpers::diTauMass(visible(tau1, 0.5, 0.77),
+        15, visible(tau2, 0.5, 0.77), -15, 10, 10, singular));
+}
+
+void testDataAlgos::testDerivedObjectFlags() {
+  TRandom3 randy(2468);
+  const reco::Vertex pv(reco::Vertex::Point(0.01, -0.02, 1.5),
+      reco::Vertex::Error(), 1, 1, 10);
+
+  // Muons spread across every cut: the ID bits, the acceptance, the best
+  // track type, its impact parameters with respect to the PV and the SIP
+  const size_t nMuons = 60;
+  reco::TrackCollection tracks;
+  for (size_t i = 0; i < nMuons; ++i) {
+    const reco::Track::Point vertex(pv.x() + randy.Gaus(0, 0.4),
+        pv.y() + randy.Gaus(0, 0.4), pv.z() + randy.Gaus(0, 1.));
+    math::PtEtaPhiMLorentzVector p4(randy.Uniform(2, 40),
+        randy.Uniform(-3, 3), randy.Uniform(-M_PI, M_PI), 0.1057);
+    tracks.push_back(reco::Track(1, 1, vertex,
+          reco::Track::Vector(p4.px(), p4.py(), p4.pz()), i % 2 ? 1 : -1,
+          reco::Track::CovarianceMatrix()));
+  }
+  edm::TestHandle<reco::TrackCollection> trackHandle(&tracks,
+      edm::ProductID(1, 1));
+
+  const unsigned types[] = {
+    reco::Muon::GlobalMuon | reco::Muon::PFMuon,
+    reco::Muon::TrackerMuon | reco::Muon::PFMuon,
+    reco::Muon::GlobalMuon | reco::Muon::TrackerMuon | reco::Muon::PFMuon,
+    reco::Muon::GlobalMuon};
+  const reco::Muon::MuonTrackType bestTracks[] = {
+    reco::Muon::InnerTrack, reco::Muon::CombinedTrack, reco::Muon::OuterTrack};
+  pat::MuonCollection muons;
+  for (size_t i = 0; i < nMuons; ++i) {
+    const reco::Track& track = tracks[i];
+    reco::Muon muon(track.charge(), reco::Candidate::LorentzVector(
+          math::PtEtaPhiMLorentzVector(track.pt(), track.eta(), track.phi(),
+            0.1057)), track.vertex());
+    const reco::TrackRef trackRef(trackHandle, i);
+    muon.setInnerTrack(trackRef);
+    muon.setOuterTrack(trackRef);
+    muon.setGlobalTrack(trackRef);
+    muon.setType(types[randy.Integer(4)]);
+    muon.setBestTrack(bestTracks[randy.Integer(3)]);
+    pat::Muon patMuon(muon);
+    patMuon.setDB(randy.Gaus(0, 0.01), 0.003, pat::Muon::PV3D);
+    muons.push_back(patMuon);
+  }
+
+  DerivedObjectFlags flags;
+  const DerivedObjectFlags::Objects& table = flags.muons(muons, pv);
+  CPPUNIT_ASSERT_EQUAL(nMuons, table.flags.size());
+  CPPUNIT_ASSERT_EQUAL(nMuons, table.eta.size());
+  CPPUNIT_ASSERT_EQUAL(nMuons, table.phi.size());
+
+  // Each flag matches the old cut on the same muon, and both outcomes occur
+  size_t nTight = 0;
+  for (size_t m = 0; m < nMuons; ++m) {
+    const reco::LeafCandidate onTop(0, muons[m].p4());
+    const bool expected = referenceClosestMuonDR(onTop,
+        pat::MuonCollection(1, muons[m]), pv) < 999;
+    const bool tight = table.flags[m] & DerivedObjectFlags::kTightSIPMuon;
+    CPPUNIT_ASSERT_EQUAL(expected, tight);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(muons[m].eta(), table.eta[m], 1e-12);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(muons[m].phi(), table.phi[m], 1e-12);
+    if (tight)
+      ++nTight;
+  }
+  CPPUNIT_ASSERT(nTight > 0);
+  CPPUNIT_ASSERT(nTight < nMuons);
+
+  // The masked loop of electronClosestMuonDR against the old one
+  for (size_t i = 0; i < 20; ++i) {
+    const reco::LeafCandidate electron(-1, reco::Candidate::LorentzVector(
+          math::PtEtaPhiMLorentzVector(randy.Uniform(10, 50),
+            randy.Uniform(-2.5, 2.5), randy.Uniform(-M_PI, M_PI), 0)));
+    float closestDR = 999;
+    for (size_t m = 0; m < table.flags.size(); ++m) {
+      if (!(table.flags[m] & DerivedObjectFlags::kTightSIPMuon))
+        continue;
+      float thisDR = reco::deltaR(electron.eta(), electron.phi(),
+          table.eta[m], table.phi[m]);
+      if (thisDR < closestDR)
+        closestDR = thisDR;
+    }
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(
+        referenceClosestMuonDR(electron, muons, pv), closestDR, 1e-5);
+  }
+
+  // The vertex z used by genVtxPVMatch
+  std::vector<reco::Vertex> vertices;
+  for (size_t i = 0; i < 8; ++i) {
+    vertices.push_back(reco::Vertex(reco::Vertex::Point(0, 0,
+            randy.Gaus(0, 5)), reco::Vertex::Error(), 1, 1, 10));
+  }
+  edm::TestHandle<std::vector<reco::Vertex> > vertexHandle(&vertices,
+      edm::ProductID(1, 2));
+  std::vector<edm::Ptr<reco::Vertex> > vertexPtrs;
+  for (size_t i = 0; i < vertices.size(); ++i) {
+    vertexPtrs.push_back(edm::Ptr<reco::Vertex>(vertexHandle, i));
+  }
+  const std::vector<double>& vertexZ = flags.vertexZ(vertexPtrs);
+  CPPUNIT_ASSERT_EQUAL(vertices.size(), vertexZ.size());
+  for (size_t i = 0; i < 40; ++i) {
+    const float genVZ = randy.Gaus(0, 6);
+    float genVtxPVDZ = fabs(pv.z() - genVZ);
+    bool match = true;
+    for (size_t v = 0; v < vertexZ.size(); ++v) {
+      if (fabs(vertexZ[v] - genVZ) < genVtxPVDZ)
+        match = false;
+    }
+    CPPUNIT_ASSERT_EQUAL(referenceGenVtxPVMatch(genVZ, pv, vertexPtrs),
+        match);
+  }
+
+  // Filled once per event: later calls return the first tables, and copies
+  // (the next event) start empty
+  CPPUNIT_ASSERT_EQUAL(nMuons,
+      flags.muons(pat::MuonCollection(), pv).flags.size());
+  CPPUNIT_ASSERT_EQUAL(vertices.size(),
+      flags.vertexZ(std::vector<edm::Ptr<reco::Vertex> >()).size());
+  DerivedObjectFlags copy(flags);
+  CPPUNIT_ASSERT(copy.muons(pat::MuonCollection(), pv).flags.empty());
+  CPPUNIT_ASSERT(copy.vertexZ(std::vector<edm::Ptr<reco::Vertex> >()).empty());
+}
+
+void testDataAlgos::testGenMatchCache() {
+  const reco::Candidate::Point origin(0, 0, 0);
+  std::vector<reco::GenParticle> gen;
+  // 0, 1: a muon before and after FSR
+  gen.push_back(reco::GenParticle(-1, ptEtaPhiM(31, 0.5, 1., 0.1057),
+        origin, 13, 23, true));
+  gen.back().statusFlags().setIsLastCopyBeforeFSR(true);
+  gen.push_back(reco::GenParticle(-1, ptEtaPhiM(30, 0.5, 1., 0.1057),
+        origin, 13, 1, true));
+  // 2, 3: two electrons around the first reco electron, 2 is closer
+  gen.push_back(reco::GenParticle(-1, ptEtaPhiM(40, -1., -2., 0.0005),
+        origin, 11, 1, true));
+  gen.push_back(reco::GenParticle(-1, ptEtaPhiM(42, -1.2, -2., 0.0005),
+        origin, 11, 1, true));
+  // 4: a positron under the second (negative) reco electron
+  gen.push_back(reco::GenParticle(1, ptEtaPhiM(25, 1.8, -0.5, 0.0005),
+        origin, -11, 1, true));
+  // 5: a tau, not status 1
+  gen.push_back(reco::GenParticle(-1, ptEtaPhiM(40, -1., -2., 1.777),
+        origin, 15, 2, true));
+  // 6: the boson everything comes from, so that the preFSR walk always
+  // finds a mother
+  gen.push_back(reco::GenParticle(0, ptEtaPhiM(5, 0., 0., 91.2),
+        origin, 23, 62, true));
+  for (size_t i = 2; i < 5; ++i) {
+    gen[i].statusFlags().setIsLastCopyBeforeFSR(true);
+  }
+  edm::TestHandle<std::vector<reco::GenParticle> > genHandle(&gen,
+      edm::ProductID(1, 3));
+  const reco::GenParticleRefProd genParticles(genHandle);
+  gen[1].addMother(reco::GenParticleRef(genParticles, 0));
+  for (size_t i = 0; i < 6; ++i) {
+    if (i != 1)
+      gen[i].addMother(reco::GenParticleRef(genParticles, 6));
+  }
+
+  // An electron, a muon, an electron with the wrong charge and an
+  // unmatched object; the first one again in another collection
+  std::vector<reco::LeafCandidate> objects;
+  objects.push_back(reco::LeafCandidate(-1, ptEtaPhiM(41, -1.02, -2.01, 0)));
+  objects.push_back(reco::LeafCandidate(-1, ptEtaPhiM(29, 0.51, 1.01, 0)));
+  objects.push_back(reco::LeafCandidate(-1, ptEtaPhiM(24, 1.79, -0.52, 0)));
+  objects.push_back(reco::LeafCandidate(0, ptEtaPhiM(60, 0., 2.5, 0)));
+  edm::TestHandle<std::vector<reco::LeafCandidate> > recoHandle(&objects,
+      edm::ProductID(1, 4));
+  std::vector<reco::LeafCandidate> others(1, objects[0]);
+  edm::TestHandle<std::vector<reco::LeafCandidate> > otherHandle(&others,
+      edm::ProductID(1, 5));
+  std::vector<reco::CandidatePtr> legs;
+  for (size_t i = 0; i < objects.size(); ++i) {
+    legs.push_back(reco::CandidatePtr(recoHandle, i));
+  }
+  const reco::CandidatePtr other(otherHandle, 0);
+
+  // The matches themselves
+  CPPUNIT_ASSERT_EQUAL(size_t(2), fshelpers::getGenParticle(legs[0].get(),
+        genParticles, 11, true, false).key());
+  CPPUNIT_ASSERT_EQUAL(size_t(1), fshelpers::getGenParticle(legs[1].get(),
+        genParticles, 13, true, false).key());
+  CPPUNIT_ASSERT_EQUAL(size_t(0), fshelpers::getGenParticle(legs[1].get(),
+        genParticles, 13, true, true).key());
+  CPPUNIT_ASSERT(fshelpers::getGenParticle(legs[2].get(),
+        genParticles, 11, true, false).isNull());
+  CPPUNIT_ASSERT_EQUAL(size_t(4), fshelpers::getGenParticle(legs[2].get(),
+        genParticles, 11, false, false).key());
+
+  // Final states sharing legs, read over several rows: every cached match
+  // is the one getGenParticle gives for that leg, pdgId, charge check and
+  // FSR choice, and each of them is computed once
+  std::vector<std::vector<reco::CandidatePtr> > finalStates = {
+    {legs[0], legs[1]}, {legs[0], legs[2]}, {legs[1], legs[2]},
+    {legs[2], legs[0], legs[1]}, {legs[3], legs[0]}, {other, legs[1]}};
+  const int pdgIds[] = {11, 13};
+  GenMatchCache cache;
+  size_t nComputed = 0;
+  for (size_t row = 0; row < 2; ++row) {
+    for (const std::vector<reco::CandidatePtr>& finalState : finalStates) {
+      for (const reco::CandidatePtr& leg : finalState) {
+        for (int pdgId : pdgIds) {
+          for (int checkCharge = 0; checkCharge < 2; ++checkCharge) {
+            for (int preFSR = 0; preFSR < 2; ++preFSR) {
+              const reco::GenParticleRef expected = fshelpers::getGenParticle(
+                  leg.get(), genParticles, pdgId, checkCharge, preFSR);
+              const reco::GenParticleRef output = cachedGenParticle(cache,
+                  leg, genParticles, pdgId, checkCharge, preFSR, nComputed);
+              CPPUNIT_ASSERT_EQUAL(expected.isNull(), output.isNull());
+              if (expected.isNonnull())
+                CPPUNIT_ASSERT_EQUAL(expected.key(), output.key());
+            }
+          }
+        }
+      }
+    }
+  }
+  // 5 distinct legs (the copy of the first is keyed apart), 8 matches each
+  CPPUNIT_ASSERT_EQUAL(size_t(5*8), nComputed);
+
+  // Per leg values are keyed by leg and quantity
+  const GenMatchCache::Leg leg0 = {legs[0].id(), legs[0].key()};
+  const GenMatchCache::Leg otherLeg = {other.id(), other.key()};
+  std::vector<double> value;
+  CPPUNIT_ASSERT(!cache.findValue(leg0, GenMatchCache::kTauGenMatch, value));
+  cache.insertValue(leg0, GenMatchCache::kTauGenMatch,
+      std::vector<double>(1, 3.));
+  cache.insertValue(leg0, GenMatchCache::kTauGenKin, {40., -1., -2.});
+  CPPUNIT_ASSERT(cache.findValue(leg0, GenMatchCache::kTauGenMatch, value));
+  CPPUNIT_ASSERT_EQUAL(size_t(1), value.size());
+  CPPUNIT_ASSERT_EQUAL(3., value[0]);
+  CPPUNIT_ASSERT(cache.findValue(leg0, GenMatchCache::kTauGenKin, value));
+  CPPUNIT_ASSERT_EQUAL(size_t(3), value.size());
+  CPPUNIT_ASSERT_EQUAL(-2., value[2]);
+  CPPUNIT_ASSERT(!cache.findValue(leg0, GenMatchCache::kTauGenMatch2, value));
+  CPPUNIT_ASSERT(!cache.findValue(otherLeg, GenMatchCache::kTauGenMatch,
+        value));
+
+  std::vector<reco::Candidate::LorentzVector> genTaus;
+  CPPUNIT_ASSERT(!cache.findGenTaus(genTaus));
+  cache.insertGenTaus(std::vector<reco::Candidate::LorentzVector>(1,
+        gen[5].p4()));
+  CPPUNIT_ASSERT(cache.findGenTaus(genTaus));
+  CPPUNIT_ASSERT_EQUAL(size_t(1), genTaus.size());
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(gen[5].pt(), genTaus[0].pt(), 1e-9);
+
+  // Copies (the next event) start empty
+  GenMatchCache copy(cache);
+  reco::GenParticleRef particle;
+  CPPUNIT_ASSERT(!copy.findParticle(leg0, 11, true, false, particle));
+  CPPUNIT_ASSERT(!copy.findValue(leg0, GenMatchCache::kTauGenMatch, value));
+  CPPUNIT_ASSERT(!copy.findGenTaus(genTaus));
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(testDataAlgos);
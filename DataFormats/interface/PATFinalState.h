@@ -7,9 +7,12 @@
 #include "DataFormats/Candidate/interface/CandidateFwd.h"
 
 #include "FinalStateAnalysis/DataFormats/interface/PATFinalStateProxy.h"
+#include "FinalStateAnalysis/DataFormats/interface/PATFinalStateAccessors.h"
+#include "FinalStateAnalysis/DataFormats/interface/PATFinalStateLegSnapshot.h"
 
 #include "FinalStateAnalysis/DataFormats/interface/PATFinalStateEventFwd.h"
 
+#include "FinalStateAnalysis/DataAlgos/interface/GenMatchCache.h"
 #include "FinalStateAnalysis/DataAlgos/interface/VBFVariables.h"
 #include "FinalStateAnalysis/DataAlgos/interface/VBFSelections.h"
 //#include "FinalStateAnalysis/DataAlgos/interface/JetVariables.h"
@@ -54,6 +57,26 @@ class PATFinalState : public pat::PATObject<reco::LeafCandidate> {
 
     virtual PATFinalState* clone() const = 0;
 
+    /// A final state layered on [base]: it has the legs and p4 of [base]
+    /// but holds only the user data added to it.  The user data lookups
+    /// below fall through to [base] for the keys the layer doesn't have.
+    /// The embedders use this instead of clone(), so a chain of embedders
+    /// doesn't copy all the user data at every step.  [base] has to be
+    /// kept in the event, and in the output if the layer is written.
+    static PATFinalState* addLayer(const edm::Ptr<PATFinalState>& base);
+    /// The final state this one is layered on, null if none
+    const edm::Ptr<PATFinalState>& base() const { return base_; }
+
+    /// The PATObject user data accessors, searching the base() too
+    float userFloat(const std::string& key) const;
+    bool hasUserFloat(const std::string& key) const;
+    int32_t userInt(const std::string& key) const;
+    bool hasUserInt(const std::string& key) const;
+    reco::CandidatePtr userCand(const std::string& key) const;
+    bool hasUserCand(const std::string& key) const;
+    const reco::CandidatePtrVector& overlaps(const std::string& label) const;
+    bool hasOverlaps(const std::string& label) const;
+
     /// Get the ith daughter.  Throws an exception if d.n.e.
     const reco::Candidate* daughter(size_t i) const;
 
@@ -81,6 +104,13 @@ class PATFinalState : public pat::PATObject<reco::LeafCandidate> {
     const LorentzVector& daughterUserCandP4(size_t i,
         const std::string& tag) const;
 
+    /// Copy the leg kinematics (and the p4s of the given userCands) into
+    /// the final state.  Done by the builders.
+    void snapshotLegs(const std::vector<std::string>& userCandTags =
+        std::vector<std::string>());
+    /// The leg snapshot, empty if it was not taken
+    const PATFinalStateLegSnapshot& legs() const { return legs_; }
+
     /// Return the indices of the daughters, ordered by descending pt
     std::vector<size_t> indicesByPt(const std::string& tags="") const;
     /// Get the daughters, ordered by pt
@@ -112,9 +142,11 @@ class PATFinalState : public pat::PATObject<reco::LeafCandidate> {
     int matchToHLTPath(size_t i, const std::string& path,
         double maxDeltaR = 0.3) const;
 
-    // Evaluate a string function on this object (might be slow)
+    // Evaluate a string function on this object.  Each expression is
+    // compiled once per job and looked up without a lock (see
+    // ek::cachedExpression).
     double eval(const std::string& function) const;
-    // Evaluate a string filter on this object (might be slow)
+    // Evaluate a string filter on this object, compiled as above
     bool filter(const std::string& cut) const;
 
     /// Get the total visible P4 (not including MET)
@@ -157,12 +189,19 @@ class PATFinalState : public pat::PATObject<reco::LeafCandidate> {
     // return the SVfit computed  mass
     std::vector<double> SVfit(int i, int j) const;
 
+    /// Fast di-tau mass of legs i and j (see fshelpers::diTauMass), using
+    /// the MET of defaultMET4vector(metTag) and the PF MET covariance, or the
+    /// pair-wise MVA MET significance if that is singular.  Memoized per
+    /// event.  Returns -999 if there is no usable covariance.
+    double diTauMass(int i, int j, const std::string& metTag="") const;
+
     // return the associated pairwise Mva Met info including pt, phi, covMatrix 
     // chanNum is a code for which channel 0 = tau tau, 1 = EMu
     // No other channels added yet
     std::vector<double> getMVAMET( size_t i, size_t j ) const;
 
     // return the Higgs to TauTau decided upon gen matching flags
+    // (the gen matching functions are memoized per event and leg)
     double tauGenMatch( size_t i ) const;
     double tauGenMatch2( size_t i ) const;
     double tauGenMatch3( size_t i ) const;
@@ -248,13 +287,15 @@ class PATFinalState : public pat::PATObject<reco::LeafCandidate> {
                                        const std::string& candLabel) const;
 
     // closest Z value
-    double closestZ(int i, const std::string& filter, std::vector<const reco::Candidate*> legs) const;
+    double closestZ(int i, const std::string& filter,
+        const std::vector<const reco::Candidate*>& legs) const;
     double closestZElectron(int i, const std::string& filter) const;
     double closestZMuon(int i, const std::string& filter) const;
     double closestZTau(int i, const std::string& filter) const;
 
     // smallest invariant mass
-    double smallestMll(int i, const std::string& filter, std::vector<const reco::Candidate*> legs) const;
+    double smallestMll(int i, const std::string& filter,
+        const std::vector<const reco::Candidate*>& legs) const;
     double smallestMee(int i, const std::string& filter) const;
     double smallestMmm(int i, const std::string& filter) const;
     double smallestMtt(int i, const std::string& filter) const;
@@ -426,8 +467,24 @@ class PATFinalState : public pat::PATObject<reco::LeafCandidate> {
     const float l1extraIsoTauPt(const size_t i) const;
     const float doubleL1extraIsoTauMatching(const size_t i, const size_t j) const;
 
+  protected:
+    /// A new final state of the same type with the same legs and nothing
+    /// else, see addLayer
+    virtual PATFinalState* cloneLegs() const = 0;
+
   private:
+    // Uncached versions of the gen matching classifications, see tauGenMatch
+    double computeTauGenMatch(size_t i) const;
+    double computeTauGenMatch2(size_t i) const;
+    double computeTauGenMatch3(size_t i) const;
+    std::vector<double> computeTauGenKin(size_t i) const;
+    // Identifies leg [i] in the event's GenMatchCache
+    GenMatchCache::Leg genMatchLeg(size_t i) const;
+
     edm::Ptr<PATFinalStateEvent> event_;
+    edm::Ptr<PATFinalState> base_;
+    // Transient
+    PATFinalStateLegSnapshot legs_;
 };
 
 #endif /* end of include guard: FinalStateAnalysis_DataFormats_PATFinalState_h */
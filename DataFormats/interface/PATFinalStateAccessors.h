@@ -0,0 +1,60 @@
+#ifndef FinalStateAnalysis_DataFormats_PATFinalStateAccessors_h
+#define FinalStateAnalysis_DataFormats_PATFinalStateAccessors_h
+
+/*
+ * Compiled versions of the most common PATFinalState string expressions.
+ *
+ * StringObjectFunction evaluates every step of an expression through ROOT
+ * reflection.  The registry maps the common forms directly to C++ calls:
+ *
+ *   name(args)                          likeSigned(0, 1), dR(0, 1), ...
+ *   daughter(i).member                  daughter(0).pt, daughter(1).userFloat("x")
+ *   daughterUserCand(i, "tag").member   daughterUserCand(0, "jesUp").eta
+ *   evt.member                          evt.rho, evt.metShift("pfmet", "pt", "jes+")
+ *
+ * Anything else, including arithmetic, is not handled: find() returns an
+ * empty function and the caller should fall back to StringObjectFunction
+ * (ek::FastObjectFunction does this automatically).
+ *
+ */
+
+#include <functional>
+#include <string>
+#include <vector>
+
+class PATFinalState;
+
+class PATFinalStateAccessors {
+  public:
+    typedef std::function<double(const PATFinalState&)> Function;
+
+    // An argument as written in the expression.  Quoted arguments are
+    // strings, everything else is a number.
+    struct Arg {
+      std::string value;
+      bool quoted;
+    };
+    typedef std::vector<Arg> Args;
+
+    // Build the accessor for a set of arguments, or return an empty
+    // function if they don't fit.
+    typedef std::function<Function(const Args&)> Factory;
+
+    // Compiled accessor for [expression], or an empty function
+    static Function find(const std::string& expression);
+
+    // True if [expression] only depends on the event (evt.*), so it has the
+    // same value for all the final states of an event.
+    static bool eventLevel(const std::string& expression);
+
+    // Register another final state level function.  Must be called before
+    // the expressions using it are built.
+    static void add(const std::string& name, const Factory& factory);
+};
+
+// Found by argument dependent lookup from ek::FastObjectFunction
+PATFinalStateAccessors::Function nativeFunction(
+    const std::string& expression, const PATFinalState*);
+bool nativeInvariant(const std::string& expression, const PATFinalState*);
+
+#endif
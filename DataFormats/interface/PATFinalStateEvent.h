@@ -10,6 +10,14 @@
  */
 
 #include "FinalStateAnalysis/DataFormats/interface/PATFinalStateEventFwd.h"
+#include "FinalStateAnalysis/DataFormats/interface/PATFinalStateProxy.h"
+#include "FinalStateAnalysis/DataAlgos/interface/CollectionFilter.h"
+#include "FinalStateAnalysis/DataAlgos/interface/OSPairMassIndex.h"
+#include "FinalStateAnalysis/DataAlgos/interface/DiTauMass.h"
+#include "FinalStateAnalysis/DataAlgos/interface/L1TauMatchIndex.h"
+#include "FinalStateAnalysis/DataAlgos/interface/DerivedObjectFlags.h"
+#include "FinalStateAnalysis/DataAlgos/interface/GenMatchCache.h"
+#include "FinalStateAnalysis/DataAlgos/interface/TrackSelections.h"
 
 #include "DataFormats/Common/interface/Ptr.h"
 #include "DataFormats/Common/interface/PtrVector.h"
@@ -47,6 +55,8 @@
 #include "TMatrixD.h"
 #include <map>
 #include <string>
+#include <unordered_map>
+#include <utility>
 
 
 class PATFinalStateEvent {
@@ -107,6 +117,32 @@ class PATFinalStateEvent {
         const std::map<std::string, bool> filterFlagsMap
     );
 
+    /// Cut results on the event's object collections, shared by every
+    /// final state built on this event (vetos, overlaps, ...)
+    CollectionFilterCache& filterCache() const { return filterCache_; }
+
+    /// Opposite sign pair masses of the event's objects, for the Z vetos
+    OSPairMassIndex& osPairMasses() const { return osPairMasses_; }
+
+    /// Event dependent flags (and eta, phi) of the event's muons, in the
+    /// order of muons()
+    const DerivedObjectFlags::Objects& muonFlags() const;
+    /// z of each of recoVertices()
+    const std::vector<double>& vertexZ() const;
+
+    /// Track selections applied to the packed candidates, see
+    /// PATFinalState::trackVariables
+    TrackPreselectionCache& trackPreselection() const { return trackPreselection_; }
+
+    /// Gen matching results of the event's objects, see PATFinalState::tauGenMatch
+    GenMatchCache& genMatches() const { return genMatches_; }
+
+    /// Di-tau masses already computed for this event, see PATFinalState::diTauMass
+    DiTauMassCache& diTauMasses() const { return diTauMasses_; }
+
+    /// Sub-candidates built from this event's objects, see PATFinalState::subcand
+    PATFinalStateProxyCache& subcands() const { return subcands_; }
+
     /// Get PV
     const edm::Ptr<reco::Vertex>& pv() const;
     /// Get all reconstructed vertices
@@ -134,12 +170,23 @@ class PATFinalStateEvent {
     const pat::PackedTriggerPrescales& trigPrescale() const;
     const edm::TriggerResults& trigResults() const;
     const BXVector<l1t::Tau>& l1extraIsoTaus() const;
+    /// The compact L1 tau array, see buildL1Taus()
+    const std::vector<L1TauRecord>& l1Taus() const { return l1Taus_; }
+    /// The L1 taus matched to [leg], memoized per event
+    const L1TauMatchIndex::LegMatch& l1TauMatch(
+        const reco::Candidate& leg) const;
 
     /*  These methods will be deprecated! */
     /// Get PFMET
     const edm::Ptr<pat::MET>& met() const;
     /// Get new MVAMET
-    const std::vector<pat::MET> MVAMETs() const;
+    const std::vector<pat::MET>& MVAMETs() const;
+    /// The pair-wise MVA MET of two legs: pt, phi and the significance
+    /// matrix [00, 10, 01, 11], or empty if there is none.  The legs are
+    /// matched to the MET's lepton0/lepton1 userCands by pt, eta, phi and
+    /// pdgId, in either order.
+    std::vector<double> pairMVAMET(const reco::Candidate& leg1,
+        const reco::Candidate& leg2) const;
     // Get PF Met Significance
     const double metSig() const;
     // Get PF Met Covariance
@@ -153,9 +200,40 @@ class PATFinalStateEvent {
     const edm::Ptr<pat::MET> met(const std::string& type) const;
     // Get 4-vector of the MET
     const reco::Candidate::LorentzVector met4vector(const std::string& type, const std::string& tag="", const int applyPhiCorr=0) const;
+    /// 4-vector of the default MET (met()) with the given shift tag.  Type
+    /// "" in met4vector/metShift is not the default MET, it is an unknown
+    /// type like any other.
+    const reco::Candidate::LorentzVector defaultMET4vector(const std::string& tag="") const;
     // get met shift
     double metShift(const std::string& type,const std::string& var, const std::string& tag="") const;
 
+    /// Register the (type, tag) MET variant and return its id, fixed for the
+    /// job.  Call it at configuration time (e.g. when an ntuple column is
+    /// compiled) and use metShift(id, ..) per event.  Only registered
+    /// variants are precomputed; the string accessors never register.
+    static size_t metVariantId(const std::string& type,
+        const std::string& tag="");
+    enum METComponent { METPt, METPhi, METSumEt };
+    /// metShift of the MET variant [id]
+    double metShift(size_t id, METComponent component) const;
+
+    /// Precompute every registered MET variant (see metVariantId) of the
+    /// named MET types, in an array indexed by id, so met4vector/metShift
+    /// become table lookups.  The table is transient: if the variant is not
+    /// in it (e.g. the event was read back from a file, or the variant was
+    /// registered later) it is resolved on the fly as before.
+    void buildMETVariants();
+
+    /// Index the pair-wise MVA METs by their two leptons, so pairMVAMET is
+    /// a hash lookup.  Transient like the MET variants: without it the
+    /// MVA METs are scanned on every call.
+    void buildMVAMETIndex();
+
+    /// Keep the bunch crossing 0 L1 taus with pt >= minPt in a compact
+    /// array for the L1 matching.  Transient: without it the full BXVector
+    /// is compacted (with no pt cut) on the first match of each event.
+    void buildL1Taus(double minPt);
+
     /// Get the event ID
     const edm::EventID& evtId() const;
     unsigned long long event() const { return evtId().event(); }
@@ -230,9 +308,9 @@ class PATFinalStateEvent {
     const reco::GenParticleRefProd genParticleRefProd() const {return genParticles_;} 
     const reco::GenJetRefProd dressedParticleRefProd() const {return dressedParticles_;}
     const edm::RefProd<reco::METCollection> rivetmetParticleRefProd() const {return rivetmetParticles_;}
-    const std::vector<reco::GenJet> genHadronicTaus() const {return genHadronicTaus_;}
-    const std::vector<reco::GenJet> genElectronicTaus() const {return genElectronicTaus_;}
-    const std::vector<reco::GenJet> genMuonicTaus() const {return genMuonicTaus_;}
+    const std::vector<reco::GenJet>& genHadronicTaus() const {return genHadronicTaus_;}
+    const std::vector<reco::GenJet>& genElectronicTaus() const {return genElectronicTaus_;}
+    const std::vector<reco::GenJet>& genMuonicTaus() const {return genMuonicTaus_;}
 
     // Access to HTXS Rivet info
     const HTXS::HiggsClassification getRivetInfo() const {return htxsRivetInfo_;}
@@ -252,6 +330,42 @@ class PATFinalStateEvent {
     const int getFilterFlags( std::string ) const;
 
   private:
+    // Resolve a MET variant from the MET object itself
+    reco::Candidate::LorentzVector computeMET4vector(
+        const std::string& type, const edm::Ptr<pat::MET>& met,
+        const std::string& tag) const;
+    double computeMETSumEt(const edm::Ptr<pat::MET>& met,
+        const std::string& tag) const;
+
+    struct METVariant {
+      METVariant(): sumEt(0), valid(false) {}
+      reco::Candidate::LorentzVector p4;
+      double sumEt;
+      bool valid;
+    };
+    const METVariant* findMETVariant(size_t id) const;
+    const METVariant* findMETVariant(const std::string& type,
+        const std::string& tag) const;
+
+    // Kinematics identifying a lepton of an MVA MET pair.  The MVA MET
+    // producer's lepton0/lepton1 point into its own input collections,
+    // while the final state legs are copies made by the embedders, so the
+    // Ptr ids and keys never agree; the legs are matched by exact equality
+    // of the kinematics, as the scan of the METs always did.
+    struct MVAMETLeg {
+      double pt, eta, phi, pdgId;
+      bool operator==(const MVAMETLeg& other) const;
+      bool operator<(const MVAMETLeg& other) const;
+    };
+    // The two legs, in a fixed order
+    typedef std::pair<MVAMETLeg, MVAMETLeg> MVAMETKey;
+    struct MVAMETKeyHash {
+      size_t operator()(const MVAMETKey& key) const;
+    };
+    static MVAMETKey mvaMETKey(const reco::Candidate& leg1,
+        const reco::Candidate& leg2);
+    static std::vector<double> mvaMETRecord(const pat::MET& met);
+
     std::map<std::string, float> weights_;
     std::map<std::string, int> flags_;
     double rho_;
@@ -301,6 +415,31 @@ class PATFinalStateEvent {
     int npNLO_;
     std::map<std::string, bool> filterFlagsMap_;
 
+    // Transient table of MET variants by metVariantId, see buildMETVariants()
+    std::vector<METVariant> metVariants_;
+    // Transient pair-wise MVA METs, see buildMVAMETIndex()
+    std::vector<std::vector<double> > mvaMETRecords_;
+    std::unordered_map<MVAMETKey, size_t, MVAMETKeyHash> mvaMETIndex_;
+    // Transient compact L1 taus, see buildL1Taus()
+    bool hasL1Taus_;
+    std::vector<L1TauRecord> l1Taus_;
+
+    // Transient per-event cut results, see filterCache()
+    mutable CollectionFilterCache filterCache_;
+    // Transient per-event pair masses, see osPairMasses()
+    mutable OSPairMassIndex osPairMasses_;
+    // Transient per-event di-tau masses, see diTauMasses()
+    mutable DiTauMassCache diTauMasses_;
+    // Transient per-event object flags, see muonFlags()
+    mutable DerivedObjectFlags objectFlags_;
+    // Transient per-event track selections, see trackPreselection()
+    mutable TrackPreselectionCache trackPreselection_;
+    // Transient per-event gen matching, see genMatches()
+    mutable GenMatchCache genMatches_;
+    // Transient per-event L1 tau matches, see l1TauMatch()
+    mutable L1TauMatchIndex l1TauMatches_;
+    // Transient per-event sub-candidates, see subcands()
+    mutable PATFinalStateProxyCache subcands_;
 };
 
 #endif /* end of include guard: PATFINALSTATEEVENT_MB433KP6 */
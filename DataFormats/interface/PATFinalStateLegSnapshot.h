@@ -0,0 +1,76 @@
+#ifndef FinalStateAnalysis_DataFormats_PATFinalStateLegSnapshot_h
+#define FinalStateAnalysis_DataFormats_PATFinalStateLegSnapshot_h
+
+/*
+ * Copy of the kinematics of the legs of a final state.
+ *
+ * The legs live in separate collections and every access goes through an
+ * edm::Ptr.  The builders take this snapshot once, so the common accessors
+ * (daughter(i).pt, dR(i, j), ...) read arrays stored in the final state
+ * itself instead.  The p4s of up to maxUserCands userCand systematic
+ * variants of each leg are stored as well.
+ *
+ * The arrays have a fixed size, so the snapshot needs no allocation and
+ * is copied along with the final state.  Final states with more than
+ * maxLegs legs are not recorded.
+ *
+ * The snapshot is transient.  Final states read back from a file have an
+ * empty snapshot and use the legs directly.
+ *
+ */
+
+#include "DataFormats/Candidate/interface/Candidate.h"
+
+#include <array>
+#include <string>
+#include <vector>
+
+class PATFinalState;
+
+class PATFinalStateLegSnapshot {
+  public:
+    typedef reco::Candidate::LorentzVector LorentzVector;
+    static const size_t maxLegs = 5;
+    static const size_t maxUserCands = 2;
+
+    PATFinalStateLegSnapshot(): size_(0), pt_(), eta_(), phi_(), mass_(),
+      charge_(), pdgId_(), nTags_(0), hasUserCand_() {}
+
+    // Record the legs of [fs], and the p4 of their [userCandTags] userCands.
+    // Throws if more than maxUserCands tags are given.
+    void fill(const PATFinalState& fs,
+        const std::vector<std::string>& userCandTags);
+
+    bool empty() const { return size_ == 0; }
+    size_t size() const { return size_; }
+
+    double pt(size_t i) const { return pt_[i]; }
+    double eta(size_t i) const { return eta_[i]; }
+    double phi(size_t i) const { return phi_[i]; }
+    double mass(size_t i) const { return mass_[i]; }
+    int charge(size_t i) const { return charge_[i]; }
+    int pdgId(size_t i) const { return pdgId_[i]; }
+    const LorentzVector& p4(size_t i) const { return p4_[i]; }
+
+    // P4 of the [tag] userCand of leg [i] (the leg itself for an empty tag),
+    // or null if it was not recorded.
+    const LorentzVector* userCandP4(size_t i, const std::string& tag) const;
+
+  private:
+    size_t size_;
+    std::array<double, maxLegs> pt_;
+    std::array<double, maxLegs> eta_;
+    std::array<double, maxLegs> phi_;
+    std::array<double, maxLegs> mass_;
+    std::array<int, maxLegs> charge_;
+    std::array<int, maxLegs> pdgId_;
+    std::array<LorentzVector, maxLegs> p4_;
+
+    // userCand p4s, [leg*maxUserCands + tag]
+    size_t nTags_;
+    std::array<std::string, maxUserCands> tags_;
+    std::array<LorentzVector, maxLegs*maxUserCands> userCandP4_;
+    std::array<bool, maxLegs*maxUserCands> hasUserCand_;
+};
+
+#endif
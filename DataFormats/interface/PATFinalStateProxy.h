@@ -9,11 +9,18 @@
  */
 
 #include <boost/shared_ptr.hpp>
+#include "DataFormats/Candidate/interface/CandidateFwd.h"
+#include "FinalStateAnalysis/DataFormats/interface/PATFinalStateEventFwd.h"
+#include "FinalStateAnalysis/DataAlgos/interface/PerEventMemo.h"
+#include <map>
+#include <vector>
+
 class PATFinalState;
 
 class PATFinalStateProxy {
   public:
     PATFinalStateProxy(PATFinalState* finalState);
+    PATFinalStateProxy(const boost::shared_ptr<PATFinalState>& finalState);
     PATFinalStateProxy();
     const PATFinalState* get() const;
     const PATFinalState* operator->() const;
@@ -21,4 +28,23 @@ class PATFinalStateProxy {
     boost::shared_ptr<PATFinalState> finalState_;
 };
 
+/*
+ *  Sub-candidates built in an event, keyed by the candidates they are made
+ *  of.  Asking twice for the same legs (e.g. subcand(1,2) from many ntuple
+ *  columns, or from several final states sharing the legs) returns the same
+ *  object instead of allocating and summing the p4 again.  Owned by the
+ *  PATFinalStateEvent, so everything is released with the event.
+ */
+class PATFinalStateProxyCache {
+  public:
+    /// Get the sub-candidate made of [cands], building it if needed
+    PATFinalStateProxy get(const std::vector<reco::CandidatePtr>& cands,
+        const edm::Ptr<PATFinalStateEvent>& evt);
+
+  private:
+    typedef std::map<std::vector<reco::CandidatePtr>, PATFinalStateProxy>
+      Proxies;
+    PerEventMemo<Proxies> proxies_;
+};
+
 #endif /* end of include guard: PATFINALSTATEPROXY_7FWRI39L */
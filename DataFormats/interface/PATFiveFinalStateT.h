@@ -126,6 +126,18 @@ class PATFiveFinalStateT : public PATFinalState {
 
     
 
+  protected:
+    virtual PATFiveFinalStateT<T1, T2, T3, T4, T5>* cloneLegs() const {
+      PATFiveFinalStateT<T1, T2, T3, T4, T5>* output =
+        new PATFiveFinalStateT<T1, T2, T3, T4, T5>();
+      output->p1_ = p1_;
+      output->p2_ = p2_;
+      output->p3_ = p3_;
+      output->p4_ = p4_;
+      output->p5_ = p5_;
+      return output;
+    }
+
   private:
     edm::Ptr<T1> p1_;
     edm::Ptr<T2> p2_;
@@ -36,6 +36,9 @@ class PATMultiCandFinalState : public PATFinalState {
     virtual const double daughterCosThetaStar(
         size_t i) const;
 
+  protected:
+    virtual PATMultiCandFinalState* cloneLegs() const;
+
   private:
     //reco::CandidateBaseRefVector cands_; // try new way later
     std::vector<reco::CandidatePtr> cands_; // old way
@@ -73,6 +73,14 @@ class PATPairFinalStateT : public PATFinalState {
         << ") is null!" << std::endl;
     }
 
+  protected:
+    virtual PATPairFinalStateT<T1, T2>* cloneLegs() const {
+      PATPairFinalStateT<T1, T2>* output = new PATPairFinalStateT<T1, T2>();
+      output->p1_ = p1_;
+      output->p2_ = p2_;
+      return output;
+    }
+
   private:
     edm::Ptr<T1> p1_;
     edm::Ptr<T2> p2_;
@@ -113,6 +113,17 @@ class PATQuadFinalStateT : public PATFinalState {
 
     
 
+  protected:
+    virtual PATQuadFinalStateT<T1, T2, T3, T4>* cloneLegs() const {
+      PATQuadFinalStateT<T1, T2, T3, T4>* output =
+        new PATQuadFinalStateT<T1, T2, T3, T4>();
+      output->p1_ = p1_;
+      output->p2_ = p2_;
+      output->p3_ = p3_;
+      output->p4_ = p4_;
+      return output;
+    }
+
   private:
     edm::Ptr<T1> p1_;
     edm::Ptr<T2> p2_;
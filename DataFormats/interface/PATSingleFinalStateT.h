@@ -60,6 +60,13 @@ class PATSingleFinalStateT : public PATFinalState {
         << ") is null!" << std::endl;
     }
 
+  protected:
+    virtual PATSingleFinalStateT<T1>* cloneLegs() const {
+      PATSingleFinalStateT<T1>* output = new PATSingleFinalStateT<T1>();
+      output->p1_ = p1_;
+      return output;
+    }
+
   private:
     edm::Ptr<T1> p1_;
 };
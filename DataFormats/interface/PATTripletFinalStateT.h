@@ -87,6 +87,16 @@ class PATTripletFinalStateT : public PATFinalState {
         << ") is null!" << std::endl;
     }
 
+  protected:
+    virtual PATTripletFinalStateT<T1, T2, T3>* cloneLegs() const {
+      PATTripletFinalStateT<T1, T2, T3>* output =
+        new PATTripletFinalStateT<T1, T2, T3>();
+      output->p1_ = p1_;
+      output->p2_ = p2_;
+      output->p3_ = p3_;
+      return output;
+    }
+
   private:
     edm::Ptr<T1> p1_;
     edm::Ptr<T2> p2_;
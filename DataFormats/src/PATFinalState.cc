@@ -1,9 +1,11 @@
 #include "FinalStateAnalysis/DataFormats/interface/PATFinalState.h"
+#include "FinalStateAnalysis/DataFormats/interface/PATFinalStateAccessors.h"
 #include "FinalStateAnalysis/DataFormats/interface/PATFinalStateEvent.h"
 #include "FinalStateAnalysis/DataFormats/interface/PATMultiCandFinalState.h"
 
 #include "FinalStateAnalysis/DataAlgos/interface/helpers.h"
 #include "FinalStateAnalysis/DataAlgos/interface/CollectionFilter.h"
+#include "FinalStateAnalysis/DataAlgos/interface/DiTauMass.h"
 
 #include "DataFormats/PatCandidates/interface/PATObject.h"
 #include "DataFormats/PatCandidates/interface/Electron.h"
@@ -14,6 +16,7 @@
 
 #include "CommonTools/Utils/interface/StringCutObjectSelector.h"
 #include "CommonTools/Utils/interface/StringObjectFunction.h"
+#include "FinalStateAnalysis/Utilities/interface/FastObjectFunction.h"
 
 #include "DataFormats/TrackReco/interface/HitPattern.h"
 
@@ -25,6 +28,7 @@
 #include <boost/algorithm/string/erase.hpp>
 #include <algorithm>
 #include <iostream>
+#include <iterator>
 #include <sstream>
 #include "TMath.h"
 
@@ -54,6 +58,14 @@ namespace {
         return c1->pt() > c2->pt();
       }
   };
+
+  // Sub-candidates are shared through the event when there is one
+  PATFinalStateProxy makeSubcand(const std::vector<reco::CandidatePtr>& cands,
+      const edm::Ptr<PATFinalStateEvent>& evt) {
+    if (evt.isNull())
+      return PATFinalStateProxy(new PATMultiCandFinalState(cands, evt));
+    return evt->subcands().get(cands, evt);
+  }
 }
 
 // empty constructor
@@ -66,6 +78,64 @@ PATFinalState::PATFinalState(
   event_ = event;
 }
 
+PATFinalState* PATFinalState::addLayer(const edm::Ptr<PATFinalState>& base) {
+  PATFinalState* output = base->cloneLegs();
+  output->setCharge(base->charge());
+  output->setP4(base->p4());
+  output->setVertex(base->vertex());
+  output->setPdgId(base->pdgId());
+  output->setStatus(base->status());
+  output->event_ = base->event_;
+  output->base_ = base;
+  output->legs_ = base->legs_;
+  return output;
+}
+
+float PATFinalState::userFloat(const std::string& key) const {
+  if (base_.isNull() || PATLeafCandidate::hasUserFloat(key))
+    return PATLeafCandidate::userFloat(key);
+  return base_->userFloat(key);
+}
+
+bool PATFinalState::hasUserFloat(const std::string& key) const {
+  return PATLeafCandidate::hasUserFloat(key) ||
+    (base_.isNonnull() && base_->hasUserFloat(key));
+}
+
+int32_t PATFinalState::userInt(const std::string& key) const {
+  if (base_.isNull() || PATLeafCandidate::hasUserInt(key))
+    return PATLeafCandidate::userInt(key);
+  return base_->userInt(key);
+}
+
+bool PATFinalState::hasUserInt(const std::string& key) const {
+  return PATLeafCandidate::hasUserInt(key) ||
+    (base_.isNonnull() && base_->hasUserInt(key));
+}
+
+reco::CandidatePtr PATFinalState::userCand(const std::string& key) const {
+  if (base_.isNull() || PATLeafCandidate::hasUserCand(key))
+    return PATLeafCandidate::userCand(key);
+  return base_->userCand(key);
+}
+
+bool PATFinalState::hasUserCand(const std::string& key) const {
+  return PATLeafCandidate::hasUserCand(key) ||
+    (base_.isNonnull() && base_->hasUserCand(key));
+}
+
+const reco::CandidatePtrVector& PATFinalState::overlaps(
+    const std::string& label) const {
+  if (base_.isNull() || PATLeafCandidate::hasOverlaps(label))
+    return PATLeafCandidate::overlaps(label);
+  return base_->overlaps(label);
+}
+
+bool PATFinalState::hasOverlaps(const std::string& label) const {
+  return PATLeafCandidate::hasOverlaps(label) ||
+    (base_.isNonnull() && base_->hasOverlaps(label));
+}
+
 const edm::Ptr<pat::MET>& PATFinalState::met() const {
     return event_->met();
 }
@@ -103,6 +173,8 @@ PATFinalState::daughterUserCand(size_t i, const std::string& tag) const {
 
 const PATFinalState::LorentzVector&
 PATFinalState::daughterUserCandP4(size_t i, const std::string& tag) const {
+  if (const LorentzVector* p4 = legs_.userCandP4(i, tag))
+    return *p4;
   if (tag == "")
     return daughter(i)->p4();
   reco::CandidatePtr userCand = daughterUserCand(i, tag);
@@ -110,6 +182,11 @@ PATFinalState::daughterUserCandP4(size_t i, const std::string& tag) const {
   return userCand->p4();
 }
 
+void PATFinalState::snapshotLegs(
+    const std::vector<std::string>& userCandTags) {
+  legs_.fill(*this, userCandTags);
+}
+
 std::vector<const reco::Candidate*> PATFinalState::daughters() const {
   std::vector<const reco::Candidate*> output;
   for (size_t i = 0; i < numberOfDaughters(); ++i) {
@@ -249,13 +326,13 @@ PATFinalState::matchToHLTPath(size_t i, const std::string& path,
 }
 
 double PATFinalState::eval(const std::string& function) const {
-  StringObjectFunction<PATFinalState> functor(function, true);
-  return functor(*this);
+  return ek::cachedExpression<ek::FastObjectFunction<PATFinalState> >(
+      function, true)(*this);
 }
 
 bool PATFinalState::filter(const std::string& cut) const {
-  StringCutObjectSelector<PATFinalState> cutter(cut, true);
-  return cutter(*this);
+  return ek::cachedExpression<ek::FastCutObjectSelector<PATFinalState> >(
+      cut, true)(*this);
 }
 
 PATFinalState::LorentzVector
@@ -339,106 +416,125 @@ std::vector<double> dummy;
 return dummy;
 }
 
+double
+PATFinalState::diTauMass(int i, int j, const std::string& metTag) const {
+  const reco::Candidate* leg1 = daughter(i);
+  const reco::Candidate* leg2 = daughter(j);
+  const DiTauMassCache::Key key(leg1, leg2, metTag);
+  double mass = -999;
+  if (evt()->diTauMasses().find(key, mass))
+    return mass;
+
+  double covariance[4];
+  for (size_t k = 0; k < 4; ++k) {
+    covariance[k] = evt()->metCov(k);
+  }
+  if (!(covariance[0]*covariance[3] - covariance[1]*covariance[2] > 0)) {
+    // pt, phi, then the significance matrix
+    std::vector<double> mvaMET = evt()->pairMVAMET(*leg1, *leg2);
+    if (mvaMET.size() < 6) {
+      evt()->diTauMasses().insert(key, mass);
+      return mass;
+    }
+    std::copy(mvaMET.begin() + 2, mvaMET.begin() + 6, covariance);
+  }
+  const reco::Candidate::LorentzVector met = evt()->defaultMET4vector(metTag);
+  mass = fshelpers::diTauMass(leg1->p4(), leg1->pdgId(),
+      leg2->p4(), leg2->pdgId(), met.px(), met.py(),
+      covariance);
+  evt()->diTauMasses().insert(key, mass);
+  return mass;
+}
+
 
 std::vector<double>
 PATFinalState::getMVAMET(size_t i, size_t j ) const {
-  //std::cout << "new mva mets" << std::endl;
-  std::vector<double> returns;
-  std::vector<double> failedV(6, -1.0);
-  std::vector<pat::MET> Mets;
-  Mets = evt()->MVAMETs();
-  if (Mets.size() == 0) return failedV;
-  else {
-    double pt1 = daughter(i)->pt();
-    double pt2 = daughter(j)->pt();
-    double eta1 = daughter(i)->eta();
-    double eta2 = daughter(j)->eta();
-    double phi1 = daughter(i)->phi();
-    double phi2 = daughter(j)->phi();
-    double pdgId1 = daughter(i)->pdgId();
-    double pdgId2 = daughter(j)->pdgId();
-    //std::cout << "daughter1 pt: " << pt1 << std::endl;
-    //std::cout << "daughter2 pt: " << pt2 << std::endl;
-    //std::cout << daughter(i) << std::endl;
-    //std::cout << daughter(j) << std::endl;
-    //std::cout << "mets:" << std::endl;
-    //int cnt = 0;
-    for ( auto met : Mets ) {
-      //std::cout << "met: "<<cnt<<std::endl;
-      double ptm1 = met.userCand("lepton0")->pt();
-      double ptm2 = met.userCand("lepton1")->pt();
-      double etam1 = met.userCand("lepton0")->eta();
-      double etam2 = met.userCand("lepton1")->eta();
-      double phim1 = met.userCand("lepton0")->phi();
-      double phim2 = met.userCand("lepton1")->phi();
-      double pdgIdm1 = met.userCand("lepton0")->pdgId();
-      double pdgIdm2 = met.userCand("lepton1")->pdgId();
-
-      bool ptMatch = false;
-      bool etaMatch = false;
-      bool phiMatch = false;
-      bool pdgIdMatch = false;
-
-      if ((pt1==ptm1 && pt2==ptm2) || (pt1==ptm2&&pt2==ptm1)) ptMatch = true;
-      else continue;
-      if ((eta1==etam1 && eta2==etam2) || (eta1==etam2&&eta2==etam1)) etaMatch = true;
-      else continue;
-      if ((phi1==phim1 && phi2==phim2) || (phi1==phim2&&phi2==phim1)) phiMatch = true;
-      else continue;
-      if ((pdgId1==pdgIdm1 && pdgId2==pdgIdm2) || (pdgId1==pdgIdm2&&pdgId2==pdgIdm1)) pdgIdMatch = true;
-      else continue;
-      if (ptMatch && etaMatch && phiMatch && pdgIdMatch) {
-        //std::cout << "\nEQUAL\n" << std::endl;
-        //std::cout << " - MEt: " << met.pt() << std::endl;
-        //std::cout << " - MEtPhi: " << met.phi() << std::endl;
-        //std::cout << " - Cov00: " << met.getSignificanceMatrix()[0][0] << std::endl;
-        //std::cout << " - Cov10: " << met.getSignificanceMatrix()[1][0] << std::endl;
-        //std::cout << " - Cov01: " << met.getSignificanceMatrix()[0][1] << std::endl;
-        //std::cout << " - Cov11: " << met.getSignificanceMatrix()[1][1] << std::endl;
-        returns.push_back( met.pt() );
-        returns.push_back( met.phi() );
-        returns.push_back( met.getSignificanceMatrix()[0][0] );
-        returns.push_back( met.getSignificanceMatrix()[1][0] );
-        returns.push_back( met.getSignificanceMatrix()[0][1] );
-        returns.push_back( met.getSignificanceMatrix()[1][1] );
-        return returns;
-      }
-  
-  
-    }
-  return failedV;
-  }
+  std::vector<double> returns = evt()->pairMVAMET(*daughter(i), *daughter(j));
+  if (returns.empty())
+    return std::vector<double>(6, -1.0);
+  return returns;
 }
 
 
 
+GenMatchCache::Leg
+PATFinalState::genMatchLeg(size_t i) const {
+  const reco::CandidatePtr ptr = daughterPtr(i);
+  GenMatchCache::Leg leg = {ptr.id(), ptr.key()};
+  return leg;
+}
+
 double
 PATFinalState::tauGenMatch( size_t i ) const {
+  const GenMatchCache::Leg leg = genMatchLeg(i);
+  std::vector<double> value;
+  if (!evt()->genMatches().findValue(leg, GenMatchCache::kTauGenMatch, value)) {
+    value.assign(1, computeTauGenMatch(i));
+    evt()->genMatches().insertValue(leg, GenMatchCache::kTauGenMatch, value);
+  }
+  return value[0];
+}
+
+double
+PATFinalState::tauGenMatch2( size_t i ) const {
+  const GenMatchCache::Leg leg = genMatchLeg(i);
+  std::vector<double> value;
+  if (!evt()->genMatches().findValue(leg, GenMatchCache::kTauGenMatch2, value)) {
+    value.assign(1, computeTauGenMatch2(i));
+    evt()->genMatches().insertValue(leg, GenMatchCache::kTauGenMatch2, value);
+  }
+  return value[0];
+}
+
+double
+PATFinalState::tauGenMatch3( size_t i ) const {
+  const GenMatchCache::Leg leg = genMatchLeg(i);
+  std::vector<double> value;
+  if (!evt()->genMatches().findValue(leg, GenMatchCache::kTauGenMatch3, value)) {
+    value.assign(1, computeTauGenMatch3(i));
+    evt()->genMatches().insertValue(leg, GenMatchCache::kTauGenMatch3, value);
+  }
+  return value[0];
+}
+
+std::vector<double>
+PATFinalState::tauGenKin( size_t i ) const {
+  const GenMatchCache::Leg leg = genMatchLeg(i);
+  std::vector<double> value;
+  if (!evt()->genMatches().findValue(leg, GenMatchCache::kTauGenKin, value)) {
+    value = computeTauGenKin(i);
+    evt()->genMatches().insertValue(leg, GenMatchCache::kTauGenKin, value);
+  }
+  return value;
+}
+
+double
+PATFinalState::computeTauGenMatch( size_t i ) const {
     // Check that there are gen particles (MC)
     if (!event_->genParticleRefProd()) return -1;
     // Get all gen particles in the event
     const reco::GenParticleRefProd genCollectionRef = event_->genParticleRefProd();
-    reco::GenParticleCollection genParticles = *genCollectionRef;
+    const reco::GenParticleCollection& genParticles = *genCollectionRef;
 
     // Find the closest gen particle to our candidate
     if ( genParticles.size() > 0 ) {
-        reco::GenParticle& closest = genParticles[0];
+        const reco::GenParticle* closest = &genParticles[0];
         double closestDR = 999;
         for(size_t m = 0; m != genParticles.size(); ++m) {
-          reco::GenParticle& genp = genParticles[m];
+          const reco::GenParticle& genp = genParticles[m];
           //std::cout << " -- " << reco::deltaR( daughter(i)->p4(), genp.p4() ) << std::endl;
           double tmpDR = reco::deltaR( daughter(i)->p4(), genp.p4() );
-          if ( tmpDR < closestDR ) { closest = genp; closestDR = tmpDR; }
+          if ( tmpDR < closestDR ) { closest = &genp; closestDR = tmpDR; }
         }
         //if (closestDR > 0.2) return 6.0;
         //std::cout << "Closest DR: " << closestDR << std::endl;
         //double dID = abs(daughter(i)->pdgId());
-        double genID = abs(closest.pdgId());
+        double genID = abs(closest->pdgId());
         //std::cout << "Cand pdgID: " << dID << " Gen pdgID: " << genID << std::endl;
-        if (genID == 11 && closest.pt() > 8 && closest.statusFlags().isPrompt() ) return 1.0;
-        else if (genID == 13 && closest.pt() > 8 && closest.statusFlags().isPrompt() ) return 2.0;
-        else if (genID == 11 && closest.pt() > 8 && closest.statusFlags().isDirectPromptTauDecayProduct() ) return 3.0;
-        else if (genID == 13 && closest.pt() > 8 && closest.statusFlags().isDirectPromptTauDecayProduct() ) return 4.0;
+        if (genID == 11 && closest->pt() > 8 && closest->statusFlags().isPrompt() ) return 1.0;
+        else if (genID == 13 && closest->pt() > 8 && closest->statusFlags().isPrompt() ) return 2.0;
+        else if (genID == 11 && closest->pt() > 8 && closest->statusFlags().isDirectPromptTauDecayProduct() ) return 3.0;
+        else if (genID == 13 && closest->pt() > 8 && closest->statusFlags().isDirectPromptTauDecayProduct() ) return 4.0;
         // If closest wasn't E / Mu, we need to rebuild taus and check them
         else {
 
@@ -464,31 +560,31 @@ PATFinalState::tauGenMatch( size_t i ) const {
 
 
 double
-PATFinalState::tauGenMatch2( size_t i ) const {
+PATFinalState::computeTauGenMatch2( size_t i ) const {
     // Check that there are gen particles (MC)
     if (!event_->genParticleRefProd()) return -1;
     // Get all gen particles in the event
     const reco::GenParticleRefProd genCollectionRef = event_->genParticleRefProd();
-    reco::GenParticleCollection genParticles = *genCollectionRef;
+    const reco::GenParticleCollection& genParticles = *genCollectionRef;
 
 
     // Find the closest gen particle to our candidate
     if ( genParticles.size() > 0 ) {
-        reco::GenParticle& closest = genParticles[0];
+        const reco::GenParticle* closest = &genParticles[0];
         double closestDR = 999;
         // The first two codes are based off of matching to true electrons/muons
         // Find the closest gen particle...
         for(size_t m = 0; m != genParticles.size(); ++m) {
-            reco::GenParticle& genp = genParticles[m];
+            const reco::GenParticle& genp = genParticles[m];
             double tmpDR = reco::deltaR( daughter(i)->p4(), genp.p4() );
-            if ( tmpDR < closestDR ) { closest = genp; closestDR = tmpDR; }
+            if ( tmpDR < closestDR ) { closest = &genp; closestDR = tmpDR; }
         }
-        double genID = abs(closest.pdgId());
+        double genID = abs(closest->pdgId());
 
         // The remaining codes are based off of matching to reconstructed tau decay products
-        const std::vector<reco::GenJet> genHTaus = event_->genHadronicTaus();
-        const std::vector<reco::GenJet> genETaus = event_->genElectronicTaus();
-        const std::vector<reco::GenJet> genMTaus = event_->genMuonicTaus();
+        const std::vector<reco::GenJet>& genHTaus = event_->genHadronicTaus();
+        const std::vector<reco::GenJet>& genETaus = event_->genElectronicTaus();
+        const std::vector<reco::GenJet>& genMTaus = event_->genMuonicTaus();
 
         // Loop over all versions of gen taus and find closest one
         double closestDR_HTau = 999;
@@ -519,8 +615,8 @@ PATFinalState::tauGenMatch2( size_t i ) const {
         double closestGetTau = TMath::Min(closestDR_ETau, closestDR_MTau);
         if (closestDR_HTau < closestGetTau) closestGetTau = closestDR_HTau;
         if (closestDR < closestGetTau) {
-            if (genID == 11 && closest.pt() > 8 && closest.statusFlags().isPrompt() && closestDR < 0.2 ) return 1.0;
-            if (genID == 13 && closest.pt() > 8 && closest.statusFlags().isPrompt() && closestDR < 0.2 ) return 2.0;
+            if (genID == 11 && closest->pt() > 8 && closest->statusFlags().isPrompt() && closestDR < 0.2 ) return 1.0;
+            if (genID == 13 && closest->pt() > 8 && closest->statusFlags().isPrompt() && closestDR < 0.2 ) return 2.0;
         }
         // Other codes based off of not matching previous 2 options
         // as closest gen particle, retruns based on closest rebuilt gen tau
@@ -534,20 +630,20 @@ PATFinalState::tauGenMatch2( size_t i ) const {
 
 
 double
-PATFinalState::tauGenMatch3( size_t i ) const {
+PATFinalState::computeTauGenMatch3( size_t i ) const {
     if (!event_->genParticleRefProd()) return -1;
     const reco::GenParticleRefProd genCollectionRef = event_->genParticleRefProd();
-    reco::GenParticleCollection genParticles = *genCollectionRef;
+    const reco::GenParticleCollection& genParticles = *genCollectionRef;
 
     if ( genParticles.size() > 0 ) {
-        reco::GenParticle& closest = genParticles[0];
+        const reco::GenParticle* closest = &genParticles[0];
         double closestDR = 999;
         for(size_t m = 0; m != genParticles.size(); ++m) {
-            reco::GenParticle& genp = genParticles[m];
+            const reco::GenParticle& genp = genParticles[m];
             double tmpDR = reco::deltaR( daughter(i)->p4(), genp.p4() );
-            if ( tmpDR < closestDR ) { closest = genp; closestDR = tmpDR; }
+            if ( tmpDR < closestDR ) { closest = &genp; closestDR = tmpDR; }
         }
-        double genID = abs(closest.pdgId());
+        double genID = abs(closest->pdgId());
 
             if (genID == 11 && closestDR < 0.1 ) return 1.0;
             else if (genID == 13 && closestDR < 0.1 ) return 2.0;
@@ -559,7 +655,7 @@ PATFinalState::tauGenMatch3( size_t i ) const {
 }
 
 std::vector<double>
-PATFinalState::tauGenKin( size_t i ) const {
+PATFinalState::computeTauGenKin( size_t i ) const {
     std::vector<double> output;
     // Check that there are gen particles (MC)
     if (!event_->genParticleRefProd()) {
@@ -602,13 +698,15 @@ PATFinalState::buildGenTaus() const {
     std::vector< reco::Candidate::LorentzVector > genTauJets;
     // Check that there are gen particles (MC)
     if (!event_->genParticleRefProd()) return genTauJets;
+    // Same for every final state of the event
+    if (evt()->genMatches().findGenTaus(genTauJets)) return genTauJets;
     // Get all gen particles in the event
     const reco::GenParticleRefProd genCollectionRef = event_->genParticleRefProd();
-    reco::GenParticleCollection genParticles = *genCollectionRef;
+    const reco::GenParticleCollection& genParticles = *genCollectionRef;
 
     if ( genParticles.size() > 0 ) {
         for(size_t m = 0; m != genParticles.size(); ++m) {
-          reco::GenParticle& genp = genParticles[m];
+          const reco::GenParticle& genp = genParticles[m];
           size_t id = abs(genp.pdgId());
           if (id == 15) {
             //std::cout << " - pdgId: " << id << std::endl;
@@ -647,6 +745,7 @@ PATFinalState::buildGenTaus() const {
         } // gen Loop
         //std::cout << "Total # of Gen Taus Jets: " << genTauJets.size() << std::endl;
     }
+    evt()->genMatches().insertGenTaus(genTauJets);
     return genTauJets;
 } 
 
@@ -879,53 +978,9 @@ reco::Candidate::LorentzVector PATFinalState::METP4(const std::string& metName,
 }
 
 reco::Candidate::LorentzVector PATFinalState::METP4(const std::string& metName, const std::string& metTag) const {
-   
-  reco::Candidate::LorentzVector metP4;
-
-  if(metName=="mvamet"){  
-     metP4=evt()->met("mvamet")->p4();
-  } 
-  else if ( met()->hasUserCand(metTag) ){ 
-       metP4=met()->userCand(metTag)->p4();
-  }
-  else{
-      if(metTag == "jres+")
-        metP4 = met()->shiftedP4(pat::MET::JetResUp);
-      else if(metTag == "jres-")
-        metP4 = met()->shiftedP4(pat::MET::JetResDown);
-      else if(metTag == "jes+")
-        metP4 = met()->shiftedP4(pat::MET::JetEnUp);
-      else if(metTag == "jes-")
-        metP4 = met()->shiftedP4(pat::MET::JetEnDown);
-      else if(metTag == "mes+")
-        metP4 = met()->shiftedP4(pat::MET::MuonEnUp);
-      else if(metTag == "mes-")
-        metP4 = met()->shiftedP4(pat::MET::MuonEnDown);
-      else if(metTag == "ees+")
-        metP4 = met()->shiftedP4(pat::MET::ElectronEnUp);
-      else if(metTag == "ees-")
-        metP4 = met()->shiftedP4(pat::MET::ElectronEnDown);
-      else if(metTag == "tes+")
-        metP4 = met()->shiftedP4(pat::MET::TauEnUp);
-      else if(metTag == "tes-")
-        metP4 = met()->shiftedP4(pat::MET::TauEnDown);
-      else if(metTag == "ues+")
-        metP4 = met()->shiftedP4(pat::MET::UnclusteredEnUp);
-      else if(metTag == "ues-")
-        metP4 = met()->shiftedP4(pat::MET::UnclusteredEnDown);
-      else if(metTag == "pes+")
-        metP4 = met()->shiftedP4(pat::MET::PhotonEnUp);
-      else if(metTag == "pes-")
-        metP4 = met()->shiftedP4(pat::MET::PhotonEnDown);
-      else if(metTag == "raw")
-        metP4 = met()->uncorP4();
-      else
-        metP4 = met()->p4();
-  } 
-
-  //std::cout<<evt()->met4vector(metName,metTag).pt()<<"   "<<metP4.pt()<<std::endl;
-
-  return metP4;
+  if (metName == "mvamet")
+    return evt()->met4vector(metName, metTag);
+  return evt()->defaultMET4vector(metTag);
 }
 
 double PATFinalState::mtMET(int i, const std::string& tag,
@@ -1028,8 +1083,9 @@ double PATFinalState::MtTotal(int i, int j) const {
 
 std::vector<reco::CandidatePtr> PATFinalState::extras(
     const std::string& label, const std::string& filter) const {
-  // maybe this needs to be optimized
-  StringCutObjectSelector<reco::Candidate> cut(filter, true);
+  const StringCutObjectSelector<reco::Candidate>& cut =
+    ek::cachedExpression<StringCutObjectSelector<reco::Candidate> >(
+        filter, true);
   const reco::CandidatePtrVector& unfiltered = overlaps(label);
   std::vector<reco::CandidatePtr> output;
   for (size_t i = 0; i < unfiltered.size(); ++i) {
@@ -1042,8 +1098,9 @@ std::vector<reco::CandidatePtr> PATFinalState::extras(
 
 std::vector<reco::CandidatePtr> PATFinalState::filteredOverlaps(
     int i, const std::string& label, const std::string& filter) const {
-  // maybe this needs to be optimized
-  StringCutObjectSelector<reco::Candidate> cut(filter, true);
+  const StringCutObjectSelector<reco::Candidate>& cut =
+    ek::cachedExpression<StringCutObjectSelector<reco::Candidate> >(
+        filter, true);
   const reco::CandidatePtrVector& unfiltered = daughterOverlaps(i, label);
   std::vector<reco::CandidatePtr> output;
   for (size_t i = 0; i < unfiltered.size(); ++i) {
@@ -1059,7 +1116,7 @@ std::vector<const reco::Candidate*> PATFinalState::vetoMuons(
   return getVetoObjects(
       daughters(),
       ptrizeCollection(evt()->muons()),
-      dR, filter);
+      dR, filter, &evt()->filterCache());
 }
 
 std::vector<const reco::Candidate*> PATFinalState::vetoSecondMuon(
@@ -1067,7 +1124,7 @@ std::vector<const reco::Candidate*> PATFinalState::vetoSecondMuon(
   return getVetoOSObjects(
       daughters(),
       ptrizeCollection(evt()->muons()),
-      dR, filter);
+      dR, filter, &evt()->filterCache());
 }
 
 std::vector<const reco::Candidate*> PATFinalState::vetoSecondElectron(
@@ -1075,7 +1132,7 @@ std::vector<const reco::Candidate*> PATFinalState::vetoSecondElectron(
   return getVetoOSObjects(
       daughters(),
       ptrizeCollection(evt()->electrons()),
-      dR, filter);
+      dR, filter, &evt()->filterCache());
 }
 
 std::vector<const reco::Candidate*> PATFinalState::vetoElectrons(
@@ -1083,7 +1140,7 @@ std::vector<const reco::Candidate*> PATFinalState::vetoElectrons(
   return getVetoObjects(
       daughters(),
       ptrizeCollection(evt()->electrons()),
-      dR, filter);
+      dR, filter, &evt()->filterCache());
 }
 
 std::vector<const reco::Candidate*> PATFinalState::vetoTaus(
@@ -1091,7 +1148,7 @@ std::vector<const reco::Candidate*> PATFinalState::vetoTaus(
   return getVetoObjects(
       daughters(),
       ptrizeCollection(evt()->taus()),
-      dR, filter);
+      dR, filter, &evt()->filterCache());
 }
 
 std::vector<const reco::Candidate*> PATFinalState::vetoJets(
@@ -1099,7 +1156,7 @@ std::vector<const reco::Candidate*> PATFinalState::vetoJets(
   return getVetoObjects(
       daughters(),
       ptrizeCollection(evt()->jets()),
-      dR, filter);
+      dR, filter, &evt()->filterCache());
 }
 
 std::vector<const reco::Candidate*> PATFinalState::vetoTracks(
@@ -1107,7 +1164,7 @@ std::vector<const reco::Candidate*> PATFinalState::vetoTracks(
   return getVetoObjects(
       daughters(),
       ptrizeCollection(evt()->packedPflow()),
-      dR, filter);
+      dR, filter, &evt()->filterCache());
 }
 
 std::vector<const reco::Candidate*> PATFinalState::overlapMuons(
@@ -1115,7 +1172,7 @@ std::vector<const reco::Candidate*> PATFinalState::overlapMuons(
   return getOverlapObjects(
       *daughter(i),
       ptrizeCollection(evt()->muons()),
-      dR, filter);
+      dR, filter, &evt()->filterCache());
 }
 
 std::vector<const reco::Candidate*> PATFinalState::overlapElectrons(
@@ -1123,7 +1180,7 @@ std::vector<const reco::Candidate*> PATFinalState::overlapElectrons(
   return getOverlapObjects(
       *daughter(i),
       ptrizeCollection(evt()->electrons()),
-      dR, filter);
+      dR, filter, &evt()->filterCache());
 }
 
 std::vector<const reco::Candidate*> PATFinalState::overlapTaus(
@@ -1131,7 +1188,7 @@ std::vector<const reco::Candidate*> PATFinalState::overlapTaus(
   return getOverlapObjects(
       *daughter(i),
       ptrizeCollection(evt()->taus()),
-      dR, filter);
+      dR, filter, &evt()->filterCache());
 }
 
 std::vector<const reco::Candidate*> PATFinalState::overlapJets(
@@ -1139,7 +1196,7 @@ std::vector<const reco::Candidate*> PATFinalState::overlapJets(
   return getOverlapObjects(
       *daughter(i),
       ptrizeCollection(evt()->jets()),
-      dR, filter);
+      dR, filter, &evt()->filterCache());
 }
 
 PATFinalStateProxy
@@ -1154,8 +1211,7 @@ PATFinalState::subcand(int i, int j, int x, int y, int z) const {
   if (z > -1)
     output.push_back(daughterPtr(z));
 
-  return PATFinalStateProxy(
-      new PATMultiCandFinalState(output, evt()));
+  return makeSubcand(output, evt());
 }
 
 
@@ -1177,8 +1233,7 @@ PATFinalState::subcand(int i, const std::string&  tagi,int j, const std::string&
   if (z > -1)
     output.push_back(daughterPtr(z));
 
-  return PATFinalStateProxy(
-      new PATMultiCandFinalState(output, evt()));
+  return makeSubcand(output, evt());
 }
 
 
@@ -1188,8 +1243,7 @@ PATFinalState::subcand(int i, const std::string&  tagi,int j, const std::string&
 PATFinalStateProxy
 PATFinalState::subcand(const std::string& tags) const {
   const std::vector<reco::CandidatePtr> daus = daughterPtrs(tags);
-  return PATFinalStateProxy(
-      new PATMultiCandFinalState(daus, evt()));
+  return makeSubcand(daus, evt());
 }
 
 PATFinalStateProxy
@@ -1205,15 +1259,18 @@ PATFinalState::subcand(const std::string& tags,
   for (size_t i = 0; i < daus.size(); ++i) {
     toAdd.push_back(daus[i]);
   }
-  return PATFinalStateProxy(
-      new PATMultiCandFinalState(toAdd, evt()));
+  return makeSubcand(toAdd, evt());
 }
 
 bool PATFinalState::likeSigned(int i, int j) const {
+  if (size_t(i) < legs_.size() && size_t(j) < legs_.size())
+    return legs_.charge(i)*legs_.charge(j) > 0;
   return daughter(i)->charge()*daughter(j)->charge() > 0;
 }
 
 bool PATFinalState::likeFlavor(int i, int j) const {
+  if (size_t(i) < legs_.size() && size_t(j) < legs_.size())
+    return std::abs(legs_.pdgId(i)) == std::abs(legs_.pdgId(j));
   return std::abs(daughter(i)->pdgId()) == std::abs(daughter(j)->pdgId());
 }
 
@@ -1268,81 +1325,54 @@ double PATFinalState::zCompatibilityWithUserCands(const size_t i,
   return zCompatibility(p4WithCands);
 }
 
-double PATFinalState::closestZ(int i, const std::string& filter, std::vector<const reco::Candidate*> legs) const
+double PATFinalState::closestZ(int i, const std::string& filter,
+    const std::vector<const reco::Candidate*>& legs) const
 {
-  std::vector<const reco::Candidate*> zFirstLeg;
-  zFirstLeg.push_back(daughter(i));
-  int charge = daughter(i)->charge();
-  std::string newfilter = filter;
-  if (charge>0) {
-    newfilter += "charge()<0";
-  }
-  else {
-    newfilter += "charge()>0";
-  }
-  std::vector<const reco::Candidate*> zSecondLegs = getVetoObjects(
-      zFirstLeg, legs, 0.0, newfilter);
-  double result = 1000;
-  for (size_t j=0; j<zSecondLegs.size(); j++) {
-    LorentzVector totalP4 = daughter(i)->p4() + zSecondLegs.at(j)->p4();
-    double temp = std::abs(totalP4.mass() - 91.1876);
-    if (temp < result) result = temp;
-  }
-  if (zSecondLegs.size() == 0) return -999;
-  return result;
+  return evt()->osPairMasses().legMasses(
+      *daughter(i), legs, filter, evt()->filterCache()).closestZ;
 }
 
 double PATFinalState::closestZElectron(int i, const std::string& filter="") const
 {
-  return closestZ(i,filter,ptrizeCollection(evt()->electrons()));
+  return evt()->osPairMasses().legMasses(
+      *daughter(i), evt()->electrons(), filter, evt()->filterCache()).closestZ;
 }
 
 double PATFinalState::closestZMuon(int i, const std::string& filter="") const
 {
-  return closestZ(i,filter,ptrizeCollection(evt()->muons()));
+  return evt()->osPairMasses().legMasses(
+      *daughter(i), evt()->muons(), filter, evt()->filterCache()).closestZ;
 }
 
 double PATFinalState::closestZTau(int i, const std::string& filter="") const
 {
-  return closestZ(i,filter,ptrizeCollection(evt()->taus()));
+  return evt()->osPairMasses().legMasses(
+      *daughter(i), evt()->taus(), filter, evt()->filterCache()).closestZ;
 }
 
-double PATFinalState::smallestMll(int i, const std::string& filter, std::vector<const reco::Candidate*> legs) const
+double PATFinalState::smallestMll(int i, const std::string& filter,
+    const std::vector<const reco::Candidate*>& legs) const
 {
-  std::vector<const reco::Candidate*> zFirstLeg;
-  zFirstLeg.push_back(daughter(i));
-  int charge = daughter(i)->charge();
-  std::string newfilter = filter;
-  if (charge>0) {
-    newfilter += "charge()<0";
-  }
-  else {
-    newfilter += "charge()>0";
-  }
-  std::vector<const reco::Candidate*> zSecondLegs = getVetoObjects(
-      zFirstLeg, legs, 0.0, newfilter);
-  double result = 1000;
-  for (size_t j=0; j<zSecondLegs.size(); j++) {
-    LorentzVector totalP4 = daughter(i)->p4() + zSecondLegs.at(j)->p4();
-    double temp = totalP4.mass();
-    if (temp < result) result = temp;
-  }
-  return result;
+  return evt()->osPairMasses().legMasses(
+      *daughter(i), legs, filter, evt()->filterCache()).smallestMll;
 }
 
 double PATFinalState::smallestMee(int i, const std::string& filter="") const
 {
-  return smallestMll(i,filter,ptrizeCollection(evt()->electrons()));
+  return evt()->osPairMasses().legMasses(*daughter(i), evt()->electrons(),
+      filter, evt()->filterCache()).smallestMll;
 }
 
 double PATFinalState::smallestMmm(int i, const std::string& filter="") const
 {
-  return smallestMll(i,filter,ptrizeCollection(evt()->muons()));
+  return evt()->osPairMasses().legMasses(*daughter(i), evt()->muons(),
+      filter, evt()->filterCache()).smallestMll;
 }
 
 double PATFinalState::smallestMtt(int i, const std::string& filter="") const
 {
-  return smallestMll(i,filter,ptrizeCollection(evt()->taus()));
+  return evt()->osPairMasses().legMasses(*daughter(i), evt()->taus(),
+      filter, evt()->filterCache()).smallestMll;
 }
 
 
@@ -1757,15 +1787,19 @@ std::vector<double> PATFinalState::bVariables(const std::string& jetCuts, double
 }
 
 std::vector<double> PATFinalState::trackVariables(const std::string& trackCuts, double dr ) const {
-  std::vector<const reco::Candidate*> hardScatter = this->daughters();
-  std::vector<const reco::Candidate*> tracks = this->vetoTracks(dr, trackCuts);
   bool has_gen=true;
   if (!event_->genParticleRefProd()) has_gen=false;
-  // todo cache this
-  return computeTrackInfo(tracks,evt()->packedPflow(),event_->genParticleRefProd(),has_gen);
+  // The selected tracks are the same for every final state of the event,
+  // only the overlap with the legs is done here
+  const PreselectedTracks& tracks = evt()->trackPreselection().tracks(
+      evt()->packedPflow(), trackCuts, event_->genParticleRefProd(), has_gen,
+      evt()->filterCache());
+  return computeTrackInfo(tracks, daughters(), dr);
 }
 
 bool PATFinalState::orderedInPt(int i, int j) const {
+  if (size_t(i) < legs_.size() && size_t(j) < legs_.size())
+    return legs_.pt(i) > legs_.pt(j);
   return daughter(i)->pt() > daughter(j)->pt();
 }
 
@@ -1789,7 +1823,13 @@ edm::Ptr<pat::Photon> PATFinalState::daughterAsPhoton(size_t i) const {
 const reco::GenParticleRef PATFinalState::getDaughterGenParticle(size_t i, int pdgIdToMatch, int checkCharge, int preFSR) const {
   bool charge = (bool) checkCharge;
   bool pFSR = (bool) preFSR;
-  return fshelpers::getGenParticle( daughter(i), event_->genParticleRefProd(), pdgIdToMatch, charge, pFSR);
+  const GenMatchCache::Leg leg = genMatchLeg(i);
+  reco::GenParticleRef output;
+  if (event_->genMatches().findParticle(leg, pdgIdToMatch, charge, pFSR, output))
+    return output;
+  output = fshelpers::getGenParticle( daughter(i), event_->genParticleRefProd(), pdgIdToMatch, charge, pFSR);
+  event_->genMatches().insertParticle(leg, pdgIdToMatch, charge, pFSR, output);
+  return output;
 }
 
 const reco::GenParticleRef PATFinalState::getDaughterGenParticleMotherSmart(size_t i, int pdgIdToMatch, int checkCharge) const {
@@ -2030,25 +2070,18 @@ const int PATFinalState::getElectronMissingHits(const size_t i) const
 
 const float PATFinalState::electronClosestMuonDR(const size_t i) const
 {
+  // have to pass tight muon cuts + SIP
+  const DerivedObjectFlags::Objects& muons = evt()->muonFlags();
+  const double eta = daughter(i)->eta();
+  const double phi = daughter(i)->phi();
   float closestDR = 999;
-  for(pat::MuonCollection::const_iterator iMu = evt()->muons().begin();
-      iMu != evt()->muons().end(); ++iMu)
-    {
-      if(!( // have to pass tight muon cuts + SIP
-           (iMu->isGlobalMuon() || (iMu->isTrackerMuon() && iMu->numberOfMatchedStations() > 0))
-           && iMu->isPFMuon()
-           && iMu->pt() > 5 
-           && fabs(iMu->eta()) < 2.4
-           && iMu->muonBestTrack()->dxy(evt()->pv()->position()) < 0.5
-           && iMu->muonBestTrack()->dz(evt()->pv()->position()) < 1.
-           && iMu->muonBestTrackType() != 2
-           && fabs(iMu->dB(pat::Muon::PV3D) / iMu->edB(pat::Muon::PV3D)) < 4
-           ))
-        continue;
-      float thisDR = reco::deltaR(daughter(i)->p4(), iMu->p4());
-      if(thisDR < closestDR)
-        closestDR = thisDR;
-    }
+  for (size_t m = 0; m < muons.flags.size(); ++m) {
+    if (!(muons.flags[m] & DerivedObjectFlags::kTightSIPMuon))
+      continue;
+    float thisDR = reco::deltaR(eta, phi, muons.eta[m], muons.phi[m]);
+    if (thisDR < closestDR)
+      closestDR = thisDR;
+  }
 
   return closestDR;
 }
@@ -2064,19 +2097,19 @@ const int PATFinalState::getMuonHits(const size_t i) const
 const bool PATFinalState::genVtxPVMatch(const size_t i) const
 {
   unsigned int pdgId = abs(daughter(i)->pdgId());
-  if(!(getDaughterGenParticle(i, pdgId, 0).isAvailable() && getDaughterGenParticle(i, pdgId, 0).isNonnull()))
+  const reco::GenParticleRef genp = getDaughterGenParticle(i, pdgId, 0);
+  if(!(genp.isAvailable() && genp.isNonnull()))
     return false;
 
-  float genVZ = getDaughterGenParticle(i, pdgId, 0)->vz();
+  float genVZ = genp->vz();
   float genVtxPVDZ = fabs(event_->pv()->z() - genVZ);
 
   // Loop over all vertices, and if there's one that's better, say so
-  for(std::vector<edm::Ptr<reco::Vertex>>::const_iterator iVtx = event_->recoVertices().begin();
-      iVtx != event_->recoVertices().end(); ++iVtx)
-    {
-      if(fabs((*iVtx)->z() - genVZ) < genVtxPVDZ)
-        return false;
-    }
+  const std::vector<double>& vertexZ = event_->vertexZ();
+  for (size_t v = 0; v < vertexZ.size(); ++v) {
+    if (fabs(vertexZ[v] - genVZ) < genVtxPVDZ)
+      return false;
+  }
   // Didn't find a better one, PV must be the best
   return true;
 }
@@ -2093,6 +2126,10 @@ const float PATFinalState::dijetMass(const size_t i, const size_t j) const
 
 PATFinalState::LorentzVector PATFinalState::daughterP4WithUserCand(const size_t i, const std::string& label) const
 {
+  const LorentzVector* p4 = label.empty() ? 0 : legs_.userCandP4(i, label);
+  if (p4)
+    return legs_.p4(i) + *p4;
+
   LorentzVector out = daughter(i)->p4();
 
   if(daughterHasUserCand(i, label))
@@ -2156,60 +2193,29 @@ const float PATFinalState::daughterUserCandIsoContribution(const size_t i, const
 
 const float PATFinalState::l1extraIsoTauMatching(const size_t i) const
 {
-    BXVector<l1t::Tau> isoTaus = evt()->l1extraIsoTaus();
-    //for (int i = 0; i < isoTaus.size(); ++i) {
-    for ( auto isoTau : isoTaus ) {
-        //std::cout << " - l1 p4: " << isoTau.p4() << std::endl;
-        if (isoTau.pt() < 32) { // 32 GeV is correct value for 2017 data
-            //std::cout << " --- Pt small" << std::endl;
-            continue;}
-        float dR = reco::deltaR(daughter(i)->p4(), isoTau.p4() );
-        //std::cout << " --- dR: " << dR << std::endl;
-        if (dR < 0.5) return 1;
-    }
-
-    return 0.0;
+    return evt()->l1TauMatch(*daughter(i)).triggerMatches.empty() ? 0.0 : 1;
 }
 
 const float PATFinalState::l1extraIsoTauPt(const size_t i) const
 {
-    BXVector<l1t::Tau> isoTaus = evt()->l1extraIsoTaus();
-    //for (int i = 0; i < isoTaus.size(); ++i) {
-    for ( auto isoTau : isoTaus ) {
-        float dR = reco::deltaR(daughter(i)->p4(), isoTau.p4() );
-        //std::cout << " --- dR: " << dR << std::endl;
-        if (dR < 0.5) return isoTau.pt();
-    }
-
-    return -1.0;
+    return evt()->l1TauMatch(*daughter(i)).closestPt;
 }
 
 
 const float PATFinalState::doubleL1extraIsoTauMatching(const size_t i, const size_t j) const
 {
-    BXVector<l1t::Tau> isoTaus = evt()->l1extraIsoTaus();
-    //for (int i = 0; i < isoTaus.size(); ++i) {
-    int p1MatchCnt = 0;
-    int p2MatchCnt = 0;
-    int bothMatchCnt = 0;
-    
-    // check for matching to each tau, pay attention to objects that match
-    // both taus
-    for ( auto isoTau : isoTaus ) {
-        //std::cout << " - l1 p4: " << isoTau.p4() << std::endl;
-        if (isoTau.pt() < 32) { // 32 GeV is correct value for 2017 data
-            //std::cout << " --- Pt small" << std::endl;
-            continue;}
-        float dR1 = reco::deltaR(daughter(i)->p4(), isoTau.p4() );
-        float dR2 = reco::deltaR(daughter(j)->p4(), isoTau.p4() );
-        //std::cout << " --- dR1: " << dR1 << std::endl;
-        //std::cout << " --- dR2: " << dR2 << std::endl;
-        if (dR1 < 0.5) p1MatchCnt += 1;
-        if (dR2 < 0.5) p2MatchCnt += 1;
-        if (dR1 < 0.5 && dR2 < 0.5) bothMatchCnt += 1;
-    }
- 
-    //std::cout << "p1Match "<<p1MatchCnt<<" p2 "<<p2MatchCnt<<" both "<<bothMatchCnt<<std::endl;
+    const std::vector<unsigned>& p1Matches =
+      evt()->l1TauMatch(*daughter(i)).triggerMatches;
+    const std::vector<unsigned>& p2Matches =
+      evt()->l1TauMatch(*daughter(j)).triggerMatches;
+    int p1MatchCnt = p1Matches.size();
+    int p2MatchCnt = p2Matches.size();
+    // L1 taus matching both legs (the positions are sorted)
+    std::vector<unsigned> both;
+    std::set_intersection(p1Matches.begin(), p1Matches.end(),
+        p2Matches.begin(), p2Matches.end(), std::back_inserter(both));
+    int bothMatchCnt = both.size();
+
     // both match different iso taus
     if (p1MatchCnt > 0 && p2MatchCnt > 0 && bothMatchCnt == 0) return 1.0;
     // both share a single iso tau, but one tau matching 2 iso objects so
@@ -2217,90 +2223,20 @@ const float PATFinalState::doubleL1extraIsoTauMatching(const size_t i, const siz
     else if ((p1MatchCnt + p2MatchCnt) == 3 && bothMatchCnt == 1) return 2.0;
     // This should never happen...probably
     else if ((p1MatchCnt + p2MatchCnt) == 4 && bothMatchCnt == 2) return 3.0;
-   
+
     return 0.0;
 }
 
 
 const float PATFinalState::closestZMassEE(const std::string& filter="") const {
-  std::vector<const reco::Candidate*> candidates = getObjectsPassingFilter(
-    ptrizeCollection(evt()->electrons()), filter);
-
-  if (candidates.size() == 0) return 999;
-  float bestZmass = 999;
-  float absBestZmass = 999;
-  float currentZmass = 999;
-  float absCurrentZmass = 999;
-  // Make sure we don't calculate this unnecessairly
-  int cnt1 = 0;
-  for (auto cand1 : candidates) {
-    int cnt2 = 0;
-    for (auto cand2 : candidates) {
-      if (cnt2 <= cnt1) {
-        //std::cout << "Skipping: " << cnt1 << " : " << cnt2 << std::endl;
-        ++cnt2;
-        continue;
-      }
-      ++cnt2;
-      //std::cout << "pre - e1: " << cand1->pt() << " e2: " <<  cand2->pt() << std::endl;
-      if (cand1->pt() == cand2->pt()) continue;
-      if (cand1->charge()*cand2->charge() > 0) continue;
-      if (reco::deltaR(cand1->p4(), cand2->p4() ) < 0.3) continue;
-      LorentzVector lorentzTmp;
-      lorentzTmp += cand1->p4();
-      lorentzTmp += cand2->p4();
-      currentZmass = lorentzTmp.M();
-      absCurrentZmass = fabs( currentZmass - 91.1876 );
-      if ( absCurrentZmass < absBestZmass ) {
-        absBestZmass = absCurrentZmass;
-        bestZmass = currentZmass;
-      }
-      //std::cout << " --- mass: " << currentZmass << " abs: " << absCurrentZmass << " bestM: " << bestZmass << " absBM: " << absBestZmass << std::endl;
-    }
-    ++cnt1;
-  }
-  return bestZmass;
+  return evt()->osPairMasses().closestZMass(
+      evt()->electrons(), filter, evt()->filterCache());
 }
 
 
 const float PATFinalState::closestZMassMM(const std::string& filter="") const {
-  std::vector<const reco::Candidate*> candidates = getObjectsPassingFilter(
-    ptrizeCollection(evt()->muons()), filter);
-
-  if (candidates.size() == 0) return 999;
-  float bestZmass = 999;
-  float absBestZmass = 999;
-  float currentZmass = 999;
-  float absCurrentZmass = 999;
-  // Make sure we don't calculate this unnecessairly
-  int cnt1 = 0;
-  for (auto cand1 : candidates) {
-    int cnt2 = 0;
-    for (auto cand2 : candidates) {
-      if (cnt2 <= cnt1) {
-        //std::cout << "Skipping: " << cnt1 << " : " << cnt2 << std::endl;
-        ++cnt2;
-        continue;
-      }
-      ++cnt2;
-      //std::cout << "pre - e1: " << cand1->pt() << " e2: " <<  cand2->pt() << std::endl;
-      if (cand1->pt() == cand2->pt()) continue;
-      if (cand1->charge()*cand2->charge() > 0) continue;
-      if (reco::deltaR(cand1->p4(), cand2->p4() ) < 0.3) continue;
-      LorentzVector lorentzTmp;
-      lorentzTmp += cand1->p4();
-      lorentzTmp += cand2->p4();
-      currentZmass = lorentzTmp.M();
-      absCurrentZmass = fabs( currentZmass - 91.1876 );
-      if ( absCurrentZmass < absBestZmass ) {
-        absBestZmass = absCurrentZmass;
-        bestZmass = currentZmass;
-      }
-      //std::cout << " --- mass: " << currentZmass << " abs: " << absCurrentZmass << " bestM: " << bestZmass << " absBM: " << absBestZmass << std::endl;
-    }
-    ++cnt1;
-  }
-  return bestZmass;
+  return evt()->osPairMasses().closestZMass(
+      evt()->muons(), filter, evt()->filterCache());
 }
 
 
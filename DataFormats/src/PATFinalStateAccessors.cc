@@ -0,0 +1,530 @@
+#include "FinalStateAnalysis/DataFormats/interface/PATFinalStateAccessors.h"
+#include "FinalStateAnalysis/DataFormats/interface/PATFinalState.h"
+#include "FinalStateAnalysis/DataFormats/interface/PATFinalStateEvent.h"
+
+#include "CommonTools/Utils/interface/StringObjectFunction.h"
+#include "FinalStateAnalysis/Utilities/interface/ExpressionRegistry.h"
+#include "DataFormats/PatCandidates/interface/Electron.h"
+#include "DataFormats/PatCandidates/interface/Muon.h"
+#include "DataFormats/PatCandidates/interface/Tau.h"
+#include "DataFormats/PatCandidates/interface/Jet.h"
+#include "DataFormats/PatCandidates/interface/Photon.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <utility>
+
+namespace {
+
+typedef PATFinalStateAccessors::Function Function;
+typedef PATFinalStateAccessors::Arg Arg;
+typedef PATFinalStateAccessors::Args Args;
+typedef PATFinalStateAccessors::Factory Factory;
+
+// Accessors of a reco::Candidate or the PATFinalStateEvent
+typedef std::function<double(const reco::Candidate&)> CandFunction;
+typedef std::function<CandFunction(const Args&)> CandFactory;
+typedef std::function<double(const PATFinalStateEvent&)> EventFunction;
+typedef std::function<EventFunction(const Args&)> EventFactory;
+// Gets a candidate out of the final state
+typedef std::function<const reco::Candidate*(const PATFinalState&)> CandGetter;
+typedef std::function<CandGetter(const Args&)> CandGetterFactory;
+
+/////////////////////////////////////////////////////////////////////////////
+// Argument handling
+/////////////////////////////////////////////////////////////////////////////
+
+bool toIndex(const Arg& arg, int& out) {
+  if (arg.quoted || arg.value.empty())
+    return false;
+  char* end = 0;
+  long value = std::strtol(arg.value.c_str(), &end, 10);
+  if (*end != '\0')
+    return false;
+  out = value;
+  return true;
+}
+
+bool toString(const Arg& arg, std::string& out) {
+  if (!arg.quoted)
+    return false;
+  out = arg.value;
+  return true;
+}
+
+// Argument signatures used by the registered functions
+bool noArgs(const Args& args) { return args.empty(); }
+
+bool oneIndex(const Args& args, int& i) {
+  return args.size() == 1 && toIndex(args[0], i);
+}
+
+bool twoIndices(const Args& args, int& i, int& j) {
+  return args.size() == 2 && toIndex(args[0], i) && toIndex(args[1], j);
+}
+
+bool indexAndString(const Args& args, int& i, std::string& s) {
+  return args.size() == 2 && toIndex(args[0], i) && toString(args[1], s);
+}
+
+bool oneString(const Args& args, std::string& s) {
+  return args.size() == 1 && toString(args[0], s);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Parsing
+/////////////////////////////////////////////////////////////////////////////
+
+// Remove whitespace outside of quotes
+std::string stripSpaces(const std::string& expression) {
+  std::string output;
+  char quote = 0;
+  for (size_t i = 0; i < expression.size(); ++i) {
+    char c = expression[i];
+    if (quote) {
+      if (c == quote)
+        quote = 0;
+    } else if (c == '"' || c == '\'') {
+      quote = c;
+    } else if (std::isspace(c)) {
+      continue;
+    }
+    output += c;
+  }
+  return output;
+}
+
+// A single step of an expression: name, name() or name(args)
+struct Call {
+  std::string name;
+  Args args;
+};
+
+// Parse a call starting at [pos], and move [pos] past it
+bool parseCall(const std::string& expr, size_t& pos, Call& call) {
+  size_t start = pos;
+  while (pos < expr.size() && (std::isalnum(expr[pos]) || expr[pos] == '_'))
+    ++pos;
+  if (pos == start || std::isdigit(expr[start]))
+    return false;
+  call.name = expr.substr(start, pos - start);
+  call.args.clear();
+  if (pos == expr.size() || expr[pos] != '(')
+    return true;
+  ++pos;
+  if (pos < expr.size() && expr[pos] == ')') {
+    ++pos;
+    return true;
+  }
+  while (pos < expr.size()) {
+    Arg arg;
+    char c = expr[pos];
+    if (c == '"' || c == '\'') {
+      size_t end = expr.find(c, pos + 1);
+      if (end == std::string::npos)
+        return false;
+      arg.value = expr.substr(pos + 1, end - pos - 1);
+      arg.quoted = true;
+      pos = end + 1;
+    } else {
+      size_t end = expr.find_first_of(",)", pos);
+      if (end == std::string::npos)
+        return false;
+      arg.value = expr.substr(pos, end - pos);
+      arg.quoted = false;
+      // Only plain numbers, no nested expressions
+      char* numEnd = 0;
+      std::strtod(arg.value.c_str(), &numEnd);
+      if (arg.value.empty() || *numEnd != '\0')
+        return false;
+      pos = end;
+    }
+    call.args.push_back(arg);
+    if (pos == expr.size())
+      return false;
+    if (expr[pos] == ')') {
+      ++pos;
+      return true;
+    }
+    if (expr[pos] != ',')
+      return false;
+    ++pos;
+  }
+  return false;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Candidate members
+/////////////////////////////////////////////////////////////////////////////
+
+#define FSA_CANDIDATE_MEMBER(NAME) \
+  members[#NAME] = [](const Args& args) { \
+    if (!noArgs(args)) return CandFunction(); \
+    return CandFunction([](const reco::Candidate& c) { \
+        return double(c.NAME()); }); }
+
+// userFloat/userInt live in the PATObject<T> templates, so try the PAT types
+// we build final states from.  Anything else goes through reflection, which
+// is what the string expression would have done.
+template<typename T>
+bool patUserFloat(const reco::Candidate& c, const std::string& key,
+    double& out) {
+  const T* pat = dynamic_cast<const T*>(&c);
+  if (!pat)
+    return false;
+  out = pat->userFloat(key);
+  return true;
+}
+
+template<typename T>
+bool patUserInt(const reco::Candidate& c, const std::string& key,
+    double& out) {
+  const T* pat = dynamic_cast<const T*>(&c);
+  if (!pat)
+    return false;
+  out = pat->userInt(key);
+  return true;
+}
+
+CandFunction userFloat(const std::string& key) {
+  std::string expression = "userFloat(\"" + key + "\")";
+  boost::shared_ptr<const StringObjectFunction<reco::Candidate> > fallback =
+    ek::sharedExpression<StringObjectFunction<reco::Candidate> >(
+        expression, true);
+  return [key, fallback](const reco::Candidate& c) {
+    double out;
+    if (patUserFloat<pat::Muon>(c, key, out) ||
+        patUserFloat<pat::Electron>(c, key, out) ||
+        patUserFloat<pat::Tau>(c, key, out) ||
+        patUserFloat<pat::Jet>(c, key, out) ||
+        patUserFloat<pat::Photon>(c, key, out))
+      return out;
+    return (*fallback)(c);
+  };
+}
+
+CandFunction userInt(const std::string& key) {
+  std::string expression = "userInt(\"" + key + "\")";
+  boost::shared_ptr<const StringObjectFunction<reco::Candidate> > fallback =
+    ek::sharedExpression<StringObjectFunction<reco::Candidate> >(
+        expression, true);
+  return [key, fallback](const reco::Candidate& c) {
+    double out;
+    if (patUserInt<pat::Muon>(c, key, out) ||
+        patUserInt<pat::Electron>(c, key, out) ||
+        patUserInt<pat::Tau>(c, key, out) ||
+        patUserInt<pat::Jet>(c, key, out) ||
+        patUserInt<pat::Photon>(c, key, out))
+      return out;
+    return (*fallback)(c);
+  };
+}
+
+std::map<std::string, CandFactory> buildCandMembers() {
+  std::map<std::string, CandFactory> members;
+  FSA_CANDIDATE_MEMBER(pt);
+  FSA_CANDIDATE_MEMBER(eta);
+  FSA_CANDIDATE_MEMBER(phi);
+  FSA_CANDIDATE_MEMBER(mass);
+  FSA_CANDIDATE_MEMBER(energy);
+  FSA_CANDIDATE_MEMBER(et);
+  FSA_CANDIDATE_MEMBER(mt);
+  FSA_CANDIDATE_MEMBER(p);
+  FSA_CANDIDATE_MEMBER(px);
+  FSA_CANDIDATE_MEMBER(py);
+  FSA_CANDIDATE_MEMBER(pz);
+  FSA_CANDIDATE_MEMBER(theta);
+  FSA_CANDIDATE_MEMBER(rapidity);
+  FSA_CANDIDATE_MEMBER(charge);
+  FSA_CANDIDATE_MEMBER(pdgId);
+  FSA_CANDIDATE_MEMBER(vx);
+  FSA_CANDIDATE_MEMBER(vy);
+  FSA_CANDIDATE_MEMBER(vz);
+  members["userFloat"] = [](const Args& args) {
+    std::string key;
+    return oneString(args, key) ? userFloat(key) : CandFunction();
+  };
+  members["userInt"] = [](const Args& args) {
+    std::string key;
+    return oneString(args, key) ? userInt(key) : CandFunction();
+  };
+  return members;
+}
+
+#undef FSA_CANDIDATE_MEMBER
+
+/////////////////////////////////////////////////////////////////////////////
+// Candidates in the final state
+/////////////////////////////////////////////////////////////////////////////
+
+std::map<std::string, CandGetterFactory> buildCandGetters() {
+  std::map<std::string, CandGetterFactory> getters;
+  getters["daughter"] = [](const Args& args) {
+    int i;
+    if (!oneIndex(args, i))
+      return CandGetter();
+    return CandGetter([i](const PATFinalState& fs) {
+        return fs.daughter(i); });
+  };
+  getters["daughterUserCand"] = [](const Args& args) {
+    int i;
+    std::string tag;
+    if (!indexAndString(args, i, tag))
+      return CandGetter();
+    return CandGetter([i, tag](const PATFinalState& fs) {
+        return fs.daughterUserCand(i, tag).get(); });
+  };
+  return getters;
+}
+
+// Leg snapshot members, for daughter(i).member
+typedef std::function<double(const PATFinalStateLegSnapshot&, size_t)>
+  SnapshotMember;
+
+SnapshotMember snapshotMember(const std::string& name) {
+  if (name == "pt")
+    return [](const PATFinalStateLegSnapshot& l, size_t i) { return l.pt(i); };
+  if (name == "eta")
+    return [](const PATFinalStateLegSnapshot& l, size_t i) { return l.eta(i); };
+  if (name == "phi")
+    return [](const PATFinalStateLegSnapshot& l, size_t i) { return l.phi(i); };
+  if (name == "mass")
+    return [](const PATFinalStateLegSnapshot& l, size_t i) { return l.mass(i); };
+  if (name == "charge")
+    return [](const PATFinalStateLegSnapshot& l, size_t i) {
+      return double(l.charge(i)); };
+  if (name == "pdgId")
+    return [](const PATFinalStateLegSnapshot& l, size_t i) {
+      return double(l.pdgId(i)); };
+  return SnapshotMember();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Event members
+/////////////////////////////////////////////////////////////////////////////
+
+#define FSA_EVENT_MEMBER(NAME) \
+  members[#NAME] = [](const Args& args) { \
+    if (!noArgs(args)) return EventFunction(); \
+    return EventFunction([](const PATFinalStateEvent& evt) { \
+        return double(evt.NAME()); }); }
+
+std::map<std::string, EventFactory> buildEventMembers() {
+  std::map<std::string, EventFactory> members;
+  FSA_EVENT_MEMBER(numberVertices);
+  FSA_EVENT_MEMBER(rho);
+  FSA_EVENT_MEMBER(npNLO);
+  FSA_EVENT_MEMBER(metSignificance);
+  FSA_EVENT_MEMBER(isRealData);
+  members["weight"] = [](const Args& args) {
+    std::string name;
+    if (!oneString(args, name))
+      return EventFunction();
+    return EventFunction([name](const PATFinalStateEvent& evt) {
+        return double(evt.weight(name)); });
+  };
+  members["metShift"] = [](const Args& args) {
+    std::string type, var, tag;
+    if (args.size() < 2 || args.size() > 3 ||
+        !toString(args[0], type) || !toString(args[1], var) ||
+        (args.size() == 3 && !toString(args[2], tag)))
+      return EventFunction();
+    PATFinalStateEvent::METComponent component;
+    if (var == "pt")
+      component = PATFinalStateEvent::METPt;
+    else if (var == "phi")
+      component = PATFinalStateEvent::METPhi;
+    else if (var == "sumEt")
+      component = PATFinalStateEvent::METSumEt;
+    else
+      return EventFunction([](const PATFinalStateEvent&) { return 0.; });
+    // The variant is looked up by index in every event
+    const size_t id = PATFinalStateEvent::metVariantId(type, tag);
+    return EventFunction([id, component](const PATFinalStateEvent& evt) {
+        return evt.metShift(id, component); });
+  };
+  return members;
+}
+
+#undef FSA_EVENT_MEMBER
+
+/////////////////////////////////////////////////////////////////////////////
+// Final state functions
+/////////////////////////////////////////////////////////////////////////////
+
+#define FSA_FINALSTATE_MEMBER(NAME) \
+  functions[#NAME] = [](const Args& args) { \
+    if (!noArgs(args)) return Function(); \
+    return Function([](const PATFinalState& fs) { \
+        return double(fs.NAME()); }); }
+
+#define FSA_FINALSTATE_INDEX(NAME) \
+  functions[#NAME] = [](const Args& args) { \
+    int i; \
+    if (!oneIndex(args, i)) return Function(); \
+    return Function([i](const PATFinalState& fs) { \
+        return double(fs.NAME(i)); }); }
+
+#define FSA_FINALSTATE_PAIR(NAME) \
+  functions[#NAME] = [](const Args& args) { \
+    int i, j; \
+    if (!twoIndices(args, i, j)) return Function(); \
+    return Function([i, j](const PATFinalState& fs) { \
+        return double(fs.NAME(i, j)); }); }
+
+std::map<std::string, Factory> buildFunctions() {
+  std::map<std::string, Factory> functions;
+  FSA_FINALSTATE_MEMBER(pt);
+  FSA_FINALSTATE_MEMBER(eta);
+  FSA_FINALSTATE_MEMBER(phi);
+  FSA_FINALSTATE_MEMBER(mass);
+  FSA_FINALSTATE_MEMBER(charge);
+  FSA_FINALSTATE_MEMBER(smallestDeltaR);
+  FSA_FINALSTATE_MEMBER(smallestDeltaPhi);
+  FSA_FINALSTATE_INDEX(deltaPhiToMEt);
+  FSA_FINALSTATE_INDEX(getPVDZ);
+  FSA_FINALSTATE_INDEX(getPVDXY);
+  FSA_FINALSTATE_INDEX(getIP3D);
+  FSA_FINALSTATE_INDEX(getIP3DErr);
+  FSA_FINALSTATE_PAIR(likeSigned);
+  FSA_FINALSTATE_PAIR(orderedInPt);
+  FSA_FINALSTATE_PAIR(dR);
+  FSA_FINALSTATE_PAIR(dPhi);
+  FSA_FINALSTATE_PAIR(mt);
+  FSA_FINALSTATE_PAIR(zCompatibility);
+  functions["mtMET"] = [](const Args& args) {
+    int i;
+    std::string metTag;
+    if (oneIndex(args, i))
+      return Function([i](const PATFinalState& fs) { return fs.mtMET(i); });
+    if (indexAndString(args, i, metTag))
+      return Function([i, metTag](const PATFinalState& fs) {
+          return fs.mtMET(i, metTag); });
+    return Function();
+  };
+  functions["jetVariables"] = [](const Args& args) {
+    int i;
+    std::string key;
+    if (!indexAndString(args, i, key))
+      return Function();
+    return Function([i, key](const PATFinalState& fs) {
+        return double(fs.jetVariables(i, key)); });
+  };
+  return functions;
+}
+
+#undef FSA_FINALSTATE_MEMBER
+#undef FSA_FINALSTATE_INDEX
+#undef FSA_FINALSTATE_PAIR
+
+struct Registry {
+  Registry():
+    functions(buildFunctions()),
+    candGetters(buildCandGetters()),
+    candMembers(buildCandMembers()),
+    eventMembers(buildEventMembers()) {}
+
+  std::map<std::string, Factory> functions;
+  std::map<std::string, CandGetterFactory> candGetters;
+  std::map<std::string, CandFactory> candMembers;
+  std::map<std::string, EventFactory> eventMembers;
+  std::mutex mutex;
+};
+
+Registry& registry() {
+  static Registry theRegistry;
+  return theRegistry;
+}
+
+// Look up [call] in a table of factories and build it
+template<typename F>
+auto build(const std::map<std::string, F>& factories, const Call& call)
+    -> decltype(std::declval<F>()(call.args)) {
+  typename std::map<std::string, F>::const_iterator found =
+    factories.find(call.name);
+  if (found == factories.end())
+    return decltype(std::declval<F>()(call.args))();
+  return found->second(call.args);
+}
+
+}
+
+PATFinalStateAccessors::Function PATFinalStateAccessors::find(
+    const std::string& expression) {
+  const std::string expr = stripSpaces(expression);
+
+  size_t pos = 0;
+  Call first;
+  if (!parseCall(expr, pos, first))
+    return Function();
+
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+
+  // name(args)
+  if (pos == expr.size())
+    return build(reg.functions, first);
+
+  // something.member
+  if (expr[pos] != '.')
+    return Function();
+  ++pos;
+  Call second;
+  if (!parseCall(expr, pos, second) || pos != expr.size())
+    return Function();
+
+  if (first.name == "evt" && first.args.empty()) {
+    EventFunction member = build(reg.eventMembers, second);
+    if (!member)
+      return Function();
+    return [member](const PATFinalState& fs) { return member(*fs.evt()); };
+  }
+
+  CandGetter getter = build(reg.candGetters, first);
+  CandFunction member = build(reg.candMembers, second);
+  if (!getter || !member)
+    return Function();
+
+  // daughter(i) kinematics are read from the leg snapshot when it was taken
+  int i;
+  if (first.name == "daughter" && oneIndex(first.args, i) && i >= 0 &&
+      noArgs(second.args)) {
+    SnapshotMember snapped = snapshotMember(second.name);
+    if (snapped) {
+      const size_t leg = i;
+      return [getter, member, snapped, leg](const PATFinalState& fs) {
+        const PATFinalStateLegSnapshot& legs = fs.legs();
+        if (leg < legs.size())
+          return snapped(legs, leg);
+        return member(*getter(fs));
+      };
+    }
+  }
+
+  return [getter, member](const PATFinalState& fs) {
+    return member(*getter(fs));
+  };
+}
+
+bool PATFinalStateAccessors::eventLevel(const std::string& expression) {
+  const std::string expr = stripSpaces(expression);
+  return expr.compare(0, 4, "evt.") == 0 && find(expr);
+}
+
+void PATFinalStateAccessors::add(const std::string& name,
+    const Factory& factory) {
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  reg.functions[name] = factory;
+}
+
+PATFinalStateAccessors::Function nativeFunction(
+    const std::string& expression, const PATFinalState*) {
+  return PATFinalStateAccessors::find(expression);
+}
+
+bool nativeInvariant(const std::string& expression, const PATFinalState*) {
+  return PATFinalStateAccessors::eventLevel(expression);
+}
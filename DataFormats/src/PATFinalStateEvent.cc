@@ -4,6 +4,8 @@
 #include "FinalStateAnalysis/DataAlgos/interface/Hash.h"
 
 #include "DataFormats/Math/interface/deltaR.h"
+#include <boost/functional/hash.hpp>
+#include <mutex>
 //#include "FWCore/Framework/interface/Event.h"
 
 #define FSA_DATA_FORMAT_VERSION 3
@@ -80,14 +82,16 @@ void unpackTrigger(std::vector<pat::TriggerObjectStandAlone> trig, const edm::Tr
   }
 }
 
-PATFinalStateEvent::PATFinalStateEvent() {}
+PATFinalStateEvent::PATFinalStateEvent():
+  hasL1Taus_(false) { }
 
 // testing CTOR
 PATFinalStateEvent::PATFinalStateEvent(
     const edm::Ptr<reco::Vertex>& pv,
     const edm::Ptr<pat::MET>& met):
   pv_(pv),
-  met_(met) { }
+  met_(met),
+  hasL1Taus_(false) { }
 
 PATFinalStateEvent::PATFinalStateEvent(
     double rho,
@@ -179,7 +183,8 @@ PATFinalStateEvent::PATFinalStateEvent(
   geninfoweights_(geninfoweights),
   prefiringweights_(prefiringweights),
   npNLO_(npNLO),
-  filterFlagsMap_(filterFlagsMap)
+  filterFlagsMap_(filterFlagsMap),
+  hasL1Taus_(false)
 { }
 
 const edm::Ptr<reco::Vertex>& PATFinalStateEvent::pv() const { return pv_; }
@@ -257,15 +262,115 @@ const edm::TriggerResults& PATFinalStateEvent::trigResults() const {
 const BXVector<l1t::Tau>& PATFinalStateEvent::l1extraIsoTaus() const {
   return l1extraIsoTaus_; }
 
+const DerivedObjectFlags::Objects& PATFinalStateEvent::muonFlags() const {
+  return objectFlags_.muons(muons(), *pv());
+}
+
+const std::vector<double>& PATFinalStateEvent::vertexZ() const {
+  return objectFlags_.vertexZ(recoVertices_);
+}
+
+void PATFinalStateEvent::buildL1Taus(double minPt) {
+  l1Taus_ = compactL1Taus(l1extraIsoTaus_, minPt);
+  hasL1Taus_ = true;
+}
+
+const L1TauMatchIndex::LegMatch& PATFinalStateEvent::l1TauMatch(
+    const reco::Candidate& leg) const {
+  if (hasL1Taus_)
+    return l1TauMatches_.match(leg, l1Taus_);
+  return l1TauMatches_.match(leg, l1extraIsoTaus_);
+}
+
 const edm::Ptr<pat::MET>& PATFinalStateEvent::met() const {
   return met_;
 }
 
-const std::vector<pat::MET> PATFinalStateEvent::MVAMETs() const {
-  //std::cout << "newMvaMets, len: " << MVAMETs_.size() <<std::endl;
+const std::vector<pat::MET>& PATFinalStateEvent::MVAMETs() const {
   return MVAMETs_;
 }
 
+bool PATFinalStateEvent::MVAMETLeg::operator==(const MVAMETLeg& other) const {
+  return pt == other.pt && eta == other.eta && phi == other.phi &&
+    pdgId == other.pdgId;
+}
+
+bool PATFinalStateEvent::MVAMETLeg::operator<(const MVAMETLeg& other) const {
+  if (pt != other.pt)
+    return pt < other.pt;
+  if (eta != other.eta)
+    return eta < other.eta;
+  if (phi != other.phi)
+    return phi < other.phi;
+  return pdgId < other.pdgId;
+}
+
+size_t PATFinalStateEvent::MVAMETKeyHash::operator()(
+    const MVAMETKey& key) const {
+  size_t seed = 0;
+  const MVAMETLeg* legs[2] = {&key.first, &key.second};
+  for (size_t i = 0; i < 2; ++i) {
+    boost::hash_combine(seed, legs[i]->pt);
+    boost::hash_combine(seed, legs[i]->eta);
+    boost::hash_combine(seed, legs[i]->phi);
+    boost::hash_combine(seed, legs[i]->pdgId);
+  }
+  return seed;
+}
+
+PATFinalStateEvent::MVAMETKey PATFinalStateEvent::mvaMETKey(
+    const reco::Candidate& leg1, const reco::Candidate& leg2) {
+  MVAMETLeg first = {leg1.pt(), leg1.eta(), leg1.phi(), double(leg1.pdgId())};
+  MVAMETLeg second = {leg2.pt(), leg2.eta(), leg2.phi(), double(leg2.pdgId())};
+  if (second < first)
+    std::swap(first, second);
+  return MVAMETKey(first, second);
+}
+
+std::vector<double> PATFinalStateEvent::mvaMETRecord(const pat::MET& met) {
+  std::vector<double> record;
+  record.reserve(6);
+  record.push_back(met.pt());
+  record.push_back(met.phi());
+  record.push_back(met.getSignificanceMatrix()[0][0]);
+  record.push_back(met.getSignificanceMatrix()[1][0]);
+  record.push_back(met.getSignificanceMatrix()[0][1]);
+  record.push_back(met.getSignificanceMatrix()[1][1]);
+  return record;
+}
+
+void PATFinalStateEvent::buildMVAMETIndex() {
+  mvaMETRecords_.clear();
+  mvaMETIndex_.clear();
+  for (auto const& met : MVAMETs_) {
+    MVAMETKey key = mvaMETKey(*met.userCand("lepton0"),
+        *met.userCand("lepton1"));
+    // The first MET of a pair wins, as in the scan
+    if (mvaMETIndex_.count(key))
+      continue;
+    mvaMETIndex_[key] = mvaMETRecords_.size();
+    mvaMETRecords_.push_back(mvaMETRecord(met));
+  }
+}
+
+std::vector<double> PATFinalStateEvent::pairMVAMET(
+    const reco::Candidate& leg1, const reco::Candidate& leg2) const {
+  if (MVAMETs_.empty())
+    return std::vector<double>();
+  const MVAMETKey key = mvaMETKey(leg1, leg2);
+  if (!mvaMETIndex_.empty()) {
+    auto found = mvaMETIndex_.find(key);
+    return found == mvaMETIndex_.end() ? std::vector<double>() :
+      mvaMETRecords_[found->second];
+  }
+  // No index (e.g. read back from a file): scan the METs
+  for (auto const& met : MVAMETs_) {
+    if (mvaMETKey(*met.userCand("lepton0"), *met.userCand("lepton1")) == key)
+      return mvaMETRecord(met);
+  }
+  return std::vector<double>();
+}
+
 const double PATFinalStateEvent::metSig() const {
   return metSig_;
 }
@@ -296,72 +401,223 @@ double PATFinalStateEvent::metSignificance() const {
   return fshelpers::xySignficance(met_->momentum(), metCovariance_);
 }
 
+namespace {
+  // The shifts pat::MET knows about, by FSA tag
+  const std::map<std::string, pat::MET::METUncertainty>& metUncertaintyTags() {
+    static const std::map<std::string, pat::MET::METUncertainty> tags = {
+      {"jres+", pat::MET::JetResUp},
+      {"jres-", pat::MET::JetResDown},
+      {"jes+", pat::MET::JetEnUp},
+      {"jes-", pat::MET::JetEnDown},
+      {"mes+", pat::MET::MuonEnUp},
+      {"mes-", pat::MET::MuonEnDown},
+      {"ees+", pat::MET::ElectronEnUp},
+      {"ees-", pat::MET::ElectronEnDown},
+      {"tes+", pat::MET::TauEnUp},
+      {"tes-", pat::MET::TauEnDown},
+      {"ues+", pat::MET::UnclusteredEnUp},
+      {"ues-", pat::MET::UnclusteredEnDown},
+      {"pes+", pat::MET::PhotonEnUp},
+      {"pes-", pat::MET::PhotonEnDown},
+    };
+    return tags;
+  }
+}
+
+reco::Candidate::LorentzVector PATFinalStateEvent::computeMET4vector(
+    const std::string& type, const edm::Ptr<pat::MET>& met,
+    const std::string& metTag) const
+{
+  if(type=="mvamet")
+    return met->p4();
+  if(met->hasUserCand(metTag))
+    return met->userCand(metTag)->p4();
+
+  const std::map<std::string, pat::MET::METUncertainty>& tags =
+    metUncertaintyTags();
+  std::map<std::string, pat::MET::METUncertainty>::const_iterator shift =
+    tags.find(metTag);
+  if(shift != tags.end())
+    return met->shiftedP4(shift->second);
+  if(metTag == "raw")
+    return met->uncorP4();
+  return met->p4();
+}
+
+double PATFinalStateEvent::computeMETSumEt(const edm::Ptr<pat::MET>& met,
+    const std::string& metTag) const
+{
+  const std::map<std::string, pat::MET::METUncertainty>& tags =
+    metUncertaintyTags();
+  std::map<std::string, pat::MET::METUncertainty>::const_iterator shift =
+    tags.find(metTag);
+  if(!met->hasUserCand(metTag) && shift != tags.end())
+    return met->shiftedSumEt(shift->second);
+  if(metTag == "raw")
+    return met->uncorSumEt();
+  return met->sumEt();
+}
+
+namespace {
+  // MET variants by (type, tag), numbered in the order they are registered
+  struct METVariantRegistry {
+    std::map<std::pair<std::string, std::string>, size_t> ids;
+    std::vector<std::pair<std::string, std::string> > keys;
+    std::mutex mutex;
+  };
+
+  METVariantRegistry& metVariantRegistry() {
+    static METVariantRegistry registry;
+    return registry;
+  }
+
+  // Ids already seen by this thread, so the lock is only taken for new ones
+  typedef std::map<std::string, std::map<std::string, size_t> >
+    METVariantIdCache;
+  METVariantIdCache& metVariantIdCache() {
+    thread_local METVariantIdCache cache;
+    return cache;
+  }
+
+  bool cachedMETVariantId(const std::string& type, const std::string& tag,
+      size_t& id) {
+    const METVariantIdCache& cache = metVariantIdCache();
+    METVariantIdCache::const_iterator byType = cache.find(type);
+    if (byType == cache.end())
+      return false;
+    std::map<std::string, size_t>::const_iterator byTag =
+      byType->second.find(tag);
+    if (byTag == byType->second.end())
+      return false;
+    id = byTag->second;
+    return true;
+  }
+
+  // Id of an already registered variant, without registering it
+  bool findMETVariantId(const std::string& type, const std::string& tag,
+      size_t& id) {
+    if (cachedMETVariantId(type, tag, id))
+      return true;
+    METVariantRegistry& registry = metVariantRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    std::map<std::pair<std::string, std::string>, size_t>::const_iterator
+      found = registry.ids.find(std::make_pair(type, tag));
+    if (found == registry.ids.end())
+      return false;
+    id = found->second;
+    metVariantIdCache()[type][tag] = id;
+    return true;
+  }
+
+  // The registered variants, copied per thread as they only ever grow
+  const std::vector<std::pair<std::string, std::string> >&
+  registeredMETVariants() {
+    thread_local std::vector<std::pair<std::string, std::string> > keys;
+    METVariantRegistry& registry = metVariantRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    keys.insert(keys.end(), registry.keys.begin() + keys.size(),
+        registry.keys.end());
+    return keys;
+  }
+}
+
+size_t PATFinalStateEvent::metVariantId(const std::string& type,
+    const std::string& tag)
+{
+  size_t id;
+  if (cachedMETVariantId(type, tag, id))
+    return id;
+
+  METVariantRegistry& registry = metVariantRegistry();
+  {
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    const std::pair<std::string, std::string> key(type, tag);
+    std::pair<std::map<std::pair<std::string, std::string>, size_t>::iterator,
+      bool> inserted = registry.ids.insert(
+          std::make_pair(key, registry.keys.size()));
+    if (inserted.second)
+      registry.keys.push_back(key);
+    id = inserted.first->second;
+  }
+  metVariantIdCache()[type][tag] = id;
+  return id;
+}
+
+void PATFinalStateEvent::buildMETVariants()
+{
+  const std::vector<std::pair<std::string, std::string> >& keys =
+    registeredMETVariants();
+  metVariants_.assign(keys.size(), METVariant());
+  for (size_t id = 0; id < keys.size(); ++id) {
+    const edm::Ptr<pat::MET> theMet = met(keys[id].first);
+    if (theMet.isNull())
+      continue;
+    METVariant& variant = metVariants_[id];
+    variant.p4 = computeMET4vector(keys[id].first, theMet, keys[id].second);
+    variant.sumEt = computeMETSumEt(theMet, keys[id].second);
+    variant.valid = true;
+  }
+}
+
+const PATFinalStateEvent::METVariant* PATFinalStateEvent::findMETVariant(
+    size_t id) const
+{
+  if (id >= metVariants_.size() || !metVariants_[id].valid)
+    return NULL;
+  return &metVariants_[id];
+}
+
+const PATFinalStateEvent::METVariant* PATFinalStateEvent::findMETVariant(
+    const std::string& type, const std::string& tag) const
+{
+  size_t id;
+  if (metVariants_.empty() || !findMETVariantId(type, tag, id))
+    return NULL;
+  return findMETVariant(id);
+}
+
 const reco::Candidate::LorentzVector PATFinalStateEvent::met4vector(
 								    const std::string& type, 
 								    const std::string& metTag, 
 								    const int applyPhiCorr) const 
 {
+  const METVariant* variant = findMETVariant(type, metTag);
+  if (variant)
+    return variant->p4;
 
-  std::map<std::string, edm::Ptr<pat::MET> >::const_iterator findit =
-    mets_.find(type);
-  if (findit == mets_.end() || findit->second.isNull())
+  const edm::Ptr<pat::MET> theMet = met(type);
+  if (theMet.isNull())
     return reco::Candidate::LorentzVector();
 
-  reco::Candidate::LorentzVector metP4;
-
-  if(type=="mvamet"){  
-     metP4=met(type)->p4();
-  } 
-  else if ( met(type)->hasUserCand(metTag) ){ 
-       metP4=met(type)->userCand(metTag)->p4();
-  }
-  else{
-      if(metTag == "jres+")
-        metP4 = met(type)->shiftedP4(pat::MET::JetResUp);
-      else if(metTag == "jres-")
-        metP4 = met(type)->shiftedP4(pat::MET::JetResDown);
-      else if(metTag == "jes+")
-        metP4 = met(type)->shiftedP4(pat::MET::JetEnUp);
-      else if(metTag == "jes-")
-        metP4 = met(type)->shiftedP4(pat::MET::JetEnDown);
-      else if(metTag == "mes+")
-        metP4 = met(type)->shiftedP4(pat::MET::MuonEnUp);
-      else if(metTag == "mes-")
-        metP4 = met(type)->shiftedP4(pat::MET::MuonEnDown);
-      else if(metTag == "ees+")
-        metP4 = met(type)->shiftedP4(pat::MET::ElectronEnUp);
-      else if(metTag == "ees-")
-        metP4 = met(type)->shiftedP4(pat::MET::ElectronEnDown);
-      else if(metTag == "tes+")
-        metP4 = met(type)->shiftedP4(pat::MET::TauEnUp);
-      else if(metTag == "tes-")
-        metP4 = met(type)->shiftedP4(pat::MET::TauEnDown);
-      else if(metTag == "ues+")
-        metP4 = met(type)->shiftedP4(pat::MET::UnclusteredEnUp);
-      else if(metTag == "ues-")
-        metP4 = met(type)->shiftedP4(pat::MET::UnclusteredEnDown);
-      else if(metTag == "pes+")
-        metP4 = met(type)->shiftedP4(pat::MET::PhotonEnUp);
-      else if(metTag == "pes-")
-        metP4 = met(type)->shiftedP4(pat::MET::PhotonEnDown);
-      else if(metTag == "raw")
-        metP4 = met(type)->uncorP4();
-      else
-        metP4 = met(type)->p4();
-  } 
-
-  return metP4;
+  return computeMET4vector(type, theMet, metTag);
   // TODO
   //if (applyPhiCorr == 1)
   //  return fshelpers::metPhiCorrection(metp4, recoVertices_.size(), !isRealData_);
 }
 
+const reco::Candidate::LorentzVector PATFinalStateEvent::defaultMET4vector(
+    const std::string& metTag) const
+{
+  if (met_.isNull())
+    return reco::Candidate::LorentzVector();
+  return computeMET4vector("", met_, metTag);
+}
+
 double PATFinalStateEvent::metShift(const std::string& type, const std::string& var, const std::string& tag) const
 {
+  const METVariant* variant = findMETVariant(type, tag);
+  if (variant) {
+    if (var=="pt")
+      return variant->p4.pt();
+    else if (var=="phi")
+      return variant->p4.phi();
+    else if (var=="sumEt")
+      return variant->sumEt;
+    return 0;
+  }
 
-  std::map<std::string, edm::Ptr<pat::MET> >::const_iterator findit =
-    mets_.find(type);
-  if (findit == mets_.end() || findit->second.isNull())   
+  const edm::Ptr<pat::MET> theMet = met(type);
+  if (theMet.isNull())
         return 0.0;
   
   if (var=="pt") {
@@ -370,6 +626,9 @@ double PATFinalStateEvent::metShift(const std::string& type, const std::string&
   else if (var=="phi") {
         return met4vector(type,tag).phi();
   }
+  else if (var=="sumEt") {
+        return computeMETSumEt(theMet, tag);
+  }
   else return 0;
 
 /*
@@ -561,6 +820,30 @@ double PATFinalStateEvent::metShift(const std::string& type, const std::string&
  
 }
 
+double PATFinalStateEvent::metShift(size_t id, METComponent component) const
+{
+  const METVariant* variant = findMETVariant(id);
+  if (variant) {
+    switch (component) {
+      case METPt: return variant->p4.pt();
+      case METPhi: return variant->p4.phi();
+      case METSumEt: return variant->sumEt;
+    }
+    return 0;
+  }
+
+  std::pair<std::string, std::string> key;
+  {
+    METVariantRegistry& registry = metVariantRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    if (id >= registry.keys.size())
+      return 0;
+    key = registry.keys[id];
+  }
+  static const char* const names[] = {"pt", "phi", "sumEt"};
+  return metShift(key.first, names[component], key.second);
+}
+
 const edm::EventID& PATFinalStateEvent::evtId() const {
   return evtID_;
 }
@@ -0,0 +1,65 @@
+#include "FinalStateAnalysis/DataFormats/interface/PATFinalStateLegSnapshot.h"
+#include "FinalStateAnalysis/DataFormats/interface/PATFinalState.h"
+
+#include "FWCore/Utilities/interface/Exception.h"
+
+const size_t PATFinalStateLegSnapshot::maxLegs;
+const size_t PATFinalStateLegSnapshot::maxUserCands;
+
+void PATFinalStateLegSnapshot::fill(const PATFinalState& fs,
+    const std::vector<std::string>& userCandTags) {
+  if (userCandTags.size() > maxUserCands)
+    throw cms::Exception("Configuration") << "The leg snapshot holds at most "
+      << maxUserCands << " userCands, " << userCandTags.size()
+      << " were requested" << std::endl;
+
+  const size_t nLegs = fs.numberOfDaughters();
+  if (nLegs > maxLegs) {
+    size_ = 0;
+    nTags_ = 0;
+    return;
+  }
+  size_ = nLegs;
+  for (size_t i = 0; i < nLegs; ++i) {
+    const reco::Candidate* leg = fs.daughter(i);
+    pt_[i] = leg->pt();
+    eta_[i] = leg->eta();
+    phi_[i] = leg->phi();
+    mass_[i] = leg->mass();
+    charge_[i] = leg->charge();
+    pdgId_[i] = leg->pdgId();
+    p4_[i] = leg->p4();
+  }
+
+  nTags_ = userCandTags.size();
+  for (size_t k = 0; k < nTags_; ++k)
+    tags_[k] = userCandTags[k];
+  for (size_t i = 0; i < nLegs; ++i) {
+    for (size_t k = 0; k < nTags_; ++k) {
+      const size_t index = i*maxUserCands + k;
+      hasUserCand_[index] = false;
+      if (!fs.daughterHasUserCand(i, tags_[k]))
+        continue;
+      reco::CandidatePtr userCand = fs.daughterUserCandUnsafe(i, tags_[k]);
+      if (userCand.isNull())
+        continue;
+      userCandP4_[index] = userCand->p4();
+      hasUserCand_[index] = true;
+    }
+  }
+}
+
+const PATFinalStateLegSnapshot::LorentzVector*
+PATFinalStateLegSnapshot::userCandP4(size_t i, const std::string& tag) const {
+  if (i >= size_)
+    return 0;
+  if (tag.empty())
+    return &p4_[i];
+  for (size_t k = 0; k < nTags_; ++k) {
+    if (tags_[k] == tag) {
+      const size_t index = i*maxUserCands + k;
+      return hasUserCand_[index] ? &userCandP4_[index] : 0;
+    }
+  }
+  return 0;
+}
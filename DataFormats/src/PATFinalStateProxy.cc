@@ -1,9 +1,16 @@
 #include "FinalStateAnalysis/DataFormats/interface/PATFinalStateProxy.h"
 #include "FinalStateAnalysis/DataFormats/interface/PATFinalState.h"
+#include "FinalStateAnalysis/DataFormats/interface/PATMultiCandFinalState.h"
+
+#include <boost/make_shared.hpp>
 
 PATFinalStateProxy::PATFinalStateProxy(PATFinalState* finalState):
   finalState_(finalState) {}
 
+PATFinalStateProxy::PATFinalStateProxy(
+    const boost::shared_ptr<PATFinalState>& finalState):
+  finalState_(finalState) {}
+
 PATFinalStateProxy::PATFinalStateProxy() {}
 
 const PATFinalState* PATFinalStateProxy::get() const {
@@ -13,3 +20,18 @@ const PATFinalState* PATFinalStateProxy::get() const {
 const PATFinalState* PATFinalStateProxy::operator->() const {
   return finalState_.get();
 }
+
+PATFinalStateProxy PATFinalStateProxyCache::get(
+    const std::vector<reco::CandidatePtr>& cands,
+    const edm::Ptr<PATFinalStateEvent>& evt) {
+  PerEventMemo<Proxies>::Lock proxies(proxies_);
+  Proxies::iterator found = proxies->find(cands);
+  if (found != proxies->end())
+    return found->second;
+
+  // One allocation for the object and the reference count
+  PATFinalStateProxy proxy(boost::shared_ptr<PATFinalState>(
+        boost::make_shared<PATMultiCandFinalState>(cands, evt)));
+  proxies->insert(std::make_pair(cands, proxy));
+  return proxy;
+}
@@ -32,6 +32,12 @@ PATMultiCandFinalState* PATMultiCandFinalState::clone() const {
   return new PATMultiCandFinalState(*this);
 }
 
+PATMultiCandFinalState* PATMultiCandFinalState::cloneLegs() const {
+  PATMultiCandFinalState* output = new PATMultiCandFinalState();
+  output->cands_ = cands_;
+  return output;
+}
+
 const reco::Candidate* PATMultiCandFinalState::daughterUnsafe(size_t i) const {
   try {
     return cands_.at(i).get();
@@ -52,6 +52,7 @@ namespace {
 
     // base classes
     FWD_ABS_CLASSDECL(PATFinalState)
+    edm::Wrapper<PATFinalStatePtrVector> dummyPtrVectorWPATFinalState;
     FWD_CLASSDECL(PATFinalStateEvent)
     FWD_CLASSDECL(PATFinalStateLS)
 
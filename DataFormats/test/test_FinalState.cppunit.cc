@@ -4,9 +4,11 @@
 
 #include <cppunit/extensions/HelperMacros.h>
 #include <Utilities/Testing/interface/CppUnit_testdriver.icpp>
+#include <memory>
 #include <vector>
 
 #include "FinalStateAnalysis/DataFormats/interface/PATFinalStateEvent.h"
+#include "FinalStateAnalysis/DataFormats/interface/PATFinalStateFwd.h"
 
 #include "FinalStateAnalysis/DataFormats/interface/PATDiLeptonFinalStates.h"
 #include "FinalStateAnalysis/DataFormats/interface/PATTriLeptonFinalStates.h"
@@ -31,6 +33,8 @@ class testFinalState: public CppUnit::TestFixture {
   CPPUNIT_TEST(testTriLepton);
   CPPUNIT_TEST(testOverlaps);
   CPPUNIT_TEST(testIndexGetter);
+  CPPUNIT_TEST(testAccessors);
+  CPPUNIT_TEST(testLayers);
   CPPUNIT_TEST_SUITE_END();
   public:
     void setUp();
@@ -42,6 +46,8 @@ class testFinalState: public CppUnit::TestFixture {
     void testTriLepton();
     void testOverlaps();
     void testIndexGetter();
+    void testAccessors();
+    void testLayers();
 
     ProductID electronPID;
     std::vector<pat::Electron> mockElectronColl_;
@@ -471,4 +477,116 @@ void testFinalState::testIndexGetter() {
 
 }
 
+void testFinalState::testAccessors() {
+  const PATElecMuFinalState finalState(mockElectronPtr_, mockMuonPtr1_,
+      mockEventPtr_);
+
+  PATFinalStateAccessors::Function pt1 =
+    PATFinalStateAccessors::find("daughter(1).pt");
+  CPPUNIT_ASSERT(pt1);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(mockMuonPtr1_->pt(), pt1(finalState), 1e-6);
+
+  PATFinalStateAccessors::Function charge0 =
+    PATFinalStateAccessors::find(" daughter( 0 ).charge() ");
+  CPPUNIT_ASSERT(charge0);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(mockElectronPtr_->charge(),
+      charge0(finalState), 1e-6);
+
+  PATFinalStateAccessors::Function likeSigned =
+    PATFinalStateAccessors::find("likeSigned(0, 1)");
+  CPPUNIT_ASSERT(likeSigned);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(finalState.likeSigned(0, 1),
+      likeSigned(finalState), 1e-6);
+
+  // Known forms with the wrong arguments
+  CPPUNIT_ASSERT(!PATFinalStateAccessors::find("daughter(\"0\").pt"));
+  CPPUNIT_ASSERT(!PATFinalStateAccessors::find("likeSigned(0)"));
+  CPPUNIT_ASSERT(!PATFinalStateAccessors::find("daughterUserCand(0).pt"));
+  // Anything else is left to reflection
+  CPPUNIT_ASSERT(!PATFinalStateAccessors::find("daughter(0).pt + 1"));
+  CPPUNIT_ASSERT(!PATFinalStateAccessors::find("abs(daughter(0).eta)"));
+  CPPUNIT_ASSERT(!PATFinalStateAccessors::find("daughter(0).noSuchMethod"));
+
+  // The same answers from the leg snapshot
+  PATElecMuFinalState snapped(finalState);
+  CPPUNIT_ASSERT(snapped.legs().empty());
+  snapped.snapshotLegs(std::vector<std::string>(1, "aUserCand1"));
+  CPPUNIT_ASSERT_EQUAL(size_t(2), snapped.legs().size());
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(mockMuonPtr1_->pt(), pt1(snapped), 1e-6);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(mockElectronPtr_->charge(),
+      charge0(snapped), 1e-6);
+  CPPUNIT_ASSERT_EQUAL(finalState.likeSigned(0, 1), snapped.likeSigned(0, 1));
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(finalState.dR(0, "aUserCand1", 1, ""),
+      snapped.dR(0, "aUserCand1", 1, ""), 1e-6);
+  CPPUNIT_ASSERT(!snapped.legs().userCandP4(1, "aUserCand1"));
+  CPPUNIT_ASSERT_THROW(snapped.snapshotLegs(std::vector<std::string>(
+          PATFinalStateLegSnapshot::maxUserCands + 1, "aUserCand1")),
+      cms::Exception);
+}
+
+void testFinalState::testLayers() {
+  // An embedder chain: each step is a collection in the event, layered on
+  // the one before
+  PATFinalStateCollection built;
+  built.push_back(new PATElecMuMuFinalState(mockElectronPtr_, mockMuonPtr1_,
+        mockMuonPtr2_, mockEventPtr_));
+  built[0].addUserFloat("rho", 1.5);
+  built[0].setOverlaps("jets", mockJetEdmPtrVector_);
+  TestHandle<PATFinalStateCollection> builtHandle(&built, ProductID(1, 10));
+  const Ptr<PATFinalState> builtPtr(builtHandle, 0);
+
+  PATFinalStateCollection fitted;
+  fitted.push_back(PATFinalState::addLayer(builtPtr));
+  fitted[0].addUserFloat("vtxChi2", 2.5);
+  TestHandle<PATFinalStateCollection> fittedHandle(&fitted, ProductID(1, 11));
+  const Ptr<PATFinalState> fittedPtr(fittedHandle, 0);
+
+  PATFinalStateCollection embedded;
+  embedded.push_back(PATFinalState::addLayer(fittedPtr));
+  embedded[0].addUserFloat("rho", 3.5);
+  const PATFinalState& layer = embedded[0];
+
+  // Same type, legs and p4 as the final state it was built from
+  CPPUNIT_ASSERT(dynamic_cast<const PATElecMuMuFinalState*>(&layer));
+  CPPUNIT_ASSERT(layer.base() == fittedPtr);
+  CPPUNIT_ASSERT(fitted[0].base() == builtPtr);
+  CPPUNIT_ASSERT(built[0].base().isNull());
+  CPPUNIT_ASSERT_EQUAL(size_t(3), layer.numberOfDaughters());
+  for (size_t i = 0; i < 3; ++i) {
+    CPPUNIT_ASSERT(layer.daughter(i) == built[0].daughter(i));
+  }
+  CPPUNIT_ASSERT_EQUAL(built[0].charge(), layer.charge());
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(built[0].pt(), layer.pt(), 1e-6);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(built[0].mass(), layer.mass(), 1e-6);
+
+  // Each layer holds only its own user data
+  const PATLeafCandidate& own = layer;
+  CPPUNIT_ASSERT(own.hasUserFloat("rho"));
+  CPPUNIT_ASSERT(!own.hasUserFloat("vtxChi2"));
+  CPPUNIT_ASSERT(!own.hasOverlaps("jets"));
+
+  // Lookups fall through, the closest layer wins
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(3.5, layer.userFloat("rho"), 1e-6);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(1.5, fitted[0].userFloat("rho"), 1e-6);
+  CPPUNIT_ASSERT(layer.hasUserFloat("vtxChi2"));
+  CPPUNIT_ASSERT(!built[0].hasUserFloat("vtxChi2"));
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(2.5, layer.userFloat("vtxChi2"), 1e-6);
+  CPPUNIT_ASSERT(layer.hasOverlaps("jets"));
+  CPPUNIT_ASSERT(!layer.hasOverlaps("muons"));
+  CPPUNIT_ASSERT(layer.overlaps("jets") == mockJetEdmPtrVector_);
+  CPPUNIT_ASSERT(layer.extras("jets", "pt > 43.2") ==
+      built[0].extras("jets", "pt > 43.2"));
+
+  // The string expressions of the ntuple see the same
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(2.5, layer.eval("userFloat('vtxChi2')"), 1e-6);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(
+      built[0].eval("extras('jets', 'pt > 43.2').size()"),
+      layer.eval("extras('jets', 'pt > 43.2').size()"), 1e-6);
+
+  // A copy of a layer is still layered on the same base
+  std::unique_ptr<PATFinalState> copy(layer.clone());
+  CPPUNIT_ASSERT(copy->base() == fittedPtr);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(2.5, copy->userFloat("vtxChi2"), 1e-6);
+}
+
 CPPUNIT_TEST_SUITE_REGISTRATION(testFinalState);
@@ -21,15 +21,24 @@
  *  o plotBefore: A HistoFolder that is filled before the cut is applied.
  *  o invert: Invert the cut.  (default false)
  *
+ * analyze() evaluates the cut on the whole collection at once (see
+ * ek::FastCutObjectSelector::select).
+ *
+ * The pass/fail monitor histogram is filled in bulk by flush().  Each cut
+ * also counts how many objects it evaluated and how many passed, and, if
+ * setTiming(true) is called, the wall time spent evaluating the cut string.
+ *
  * The class is explicitly not copy-constructible, since it does not own some of
  * the histograms.  Use a ptr_vector for storage.
  */
 
 #include "FinalStateAnalysis/Utilities/interface/HistoFolder.h"
-#include "CommonTools/Utils/interface/StringCutObjectSelector.h"
+#include "FinalStateAnalysis/Utilities/interface/FastObjectFunction.h"
 #include "CommonTools/Utils/interface/TFileDirectory.h"
+#include "FinalStateAnalysis/Utilities/interface/TH1Accumulator.h"
 #include "TH1F.h"
 
+#include <chrono>
 #include <vector>
 #include <memory>
 #include <boost/utility.hpp>
@@ -43,6 +52,8 @@ class AnalysisCutHolderT : private boost::noncopyable{
     AnalysisCutHolderT(const edm::ParameterSet& pset, TFileDirectory& fs);
     // Simple predicate to check if it passes the cut
     bool filter(const T& object) const;
+    // Cut result for each of [objects]
+    void select(const VectorPtrT& objects, std::vector<bool>& pass) const;
     // Filter and plot a collection of objects
     VectorPtrT analyze(const VectorPtrT& objects, double weight) const;
 
@@ -53,19 +64,37 @@ class AnalysisCutHolderT : private boost::noncopyable{
     // will still be made, but the cut will always pass.
     void setIgnore(bool ignore) { ignored_ = ignore; }
 
+    // Measure the time spent evaluating the cut
+    void setTiming(bool timing) { timing_ = timing; }
+    bool timing() const { return timing_; }
+
+    // Objects evaluated, objects passing and seconds spent in the cut
+    unsigned long evaluated() const { return evaluated_; }
+    unsigned long passed() const { return passed_; }
+    double seconds() const { return seconds_; }
+
+    // Write pending fills into the before/after histograms
+    void flush();
+
   private:
-    typedef StringCutObjectSelector<T> StringCutT;
+    typedef ek::FastCutObjectSelector<T> StringCutT;
     typedef ek::HistoFolder<T> HistoFolderT;
     std::string name_;
     std::string description_;
 
-    std::auto_ptr<StringCutT> cut_;
+    boost::shared_ptr<const StringCutT> cut_;
     bool invert_;
     bool ignored_;
 
     std::auto_ptr<HistoFolderT> folder_;
     std::auto_ptr<HistoFolderT> folderBefore_;
     TH1F* cutHisto_;
+    mutable ek::TH1Accumulator cutHistoFills_;
+
+    bool timing_;
+    mutable unsigned long evaluated_;
+    mutable unsigned long passed_;
+    mutable double seconds_;
 };
 
 
@@ -76,13 +105,19 @@ AnalysisCutHolderT<T>::AnalysisCutHolderT(const edm::ParameterSet& pset,
   description_ = pset.exists("description") ?
     pset.getParameter<std::string>("description") : name_;
   ignored_ = false;
+  cutHisto_ = 0;
+  timing_ = false;
+  evaluated_ = 0;
+  passed_ = 0;
+  seconds_ = 0;
 
   // Make cut subdirectory
   TFileDirectory subdir = fs.mkdir(name_);
 
   // The cut to apply
   if (pset.exists("cut"))
-    cut_.reset(new StringCutT(pset.getParameter<std::string>("cut"), true));
+    cut_ = ek::sharedExpression<StringCutT>(
+        pset.getParameter<std::string>("cut"), true);
 
   invert_ = pset.exists("invert") ? pset.getParameter<bool>("invert") : false;
 
@@ -103,9 +138,19 @@ AnalysisCutHolderT<T>::AnalysisCutHolderT(const edm::ParameterSet& pset,
     cutHisto_->GetXaxis()->SetTitle("Filter result");
     cutHisto_->GetXaxis()->SetBinLabel(1, "Fail");
     cutHisto_->GetXaxis()->SetBinLabel(2, "Pass");
+    cutHistoFills_ = ek::TH1Accumulator(cutHisto_);
   }
 }
 
+template<class T> void
+AnalysisCutHolderT<T>::flush() {
+  cutHistoFills_.flush();
+  if (folder_.get())
+    folder_->flush();
+  if (folderBefore_.get())
+    folderBefore_->flush();
+}
+
 template<class T> bool
 AnalysisCutHolderT<T>::filter(const T& object) const {
   if (ignored_)
@@ -119,9 +164,32 @@ AnalysisCutHolderT<T>::filter(const T& object) const {
   return pass ^ invert_;
 }
 
+template<class T> void
+AnalysisCutHolderT<T>::select(const VectorPtrT& objects,
+    std::vector<bool>& pass) const {
+  if (ignored_ || !cut_.get()) {
+    pass.assign(objects.size(), true);
+    return;
+  }
+  cut_->select(objects, pass);
+  if (invert_)
+    pass.flip();
+}
+
 template<class T> std::vector<const T*>
 AnalysisCutHolderT<T>::analyze(const VectorPtrT& objects, double weight) const {
   VectorPtrT output;
+  // Get the cut results
+  std::vector<bool> passes;
+  if (timing_) {
+    std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+    select(objects, passes);
+    seconds_ += std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+  } else {
+    select(objects, passes);
+  }
   // Analyze each object in turn
   for (size_t i = 0; i < objects.size(); ++i) {
     const T* object = objects[i];
@@ -130,10 +198,12 @@ AnalysisCutHolderT<T>::analyze(const VectorPtrT& objects, double weight) const {
     if (folderBefore_.get()) {
       folderBefore_->fill(*object, weight, i);
     }
-    // Get cut result
-    bool pass = filter(*object);
+    const bool pass = passes[i];
+    ++evaluated_;
+    if (pass)
+      ++passed_;
     if (cutHisto_)
-      cutHisto_->Fill(pass, weight);
+      cutHistoFills_.fill(pass, weight);
     // Fill after plots
     if (pass && folder_.get()) {
       folder_->fill(*object, weight, output.size());
@@ -25,6 +25,7 @@
 #include "FinalStateAnalysis/DataFormats/interface/PATFinalStateEventFwd.h"
 
 #include "CommonTools/Utils/interface/StringObjectFunction.h"
+#include "FinalStateAnalysis/Utilities/interface/ExpressionRegistry.h"
 //#include "FWCore/Framework/interface/EDAnalyzer.h"
 #include "DataFormats/Common/interface/MergeableCounter.h"
 //#include "PhysicsTools/UtilAlgos/interface/BasicAnalyzer.h"
@@ -59,7 +60,7 @@ class PATFinalStateAnalysis {
     void endLuminosityBlock(const edm::LuminosityBlockBase& ls);
 
   private:
-    edm::EDGetTokenT<PATFinalStateCollection> srcToken_;
+    edm::EDGetTokenT<edm::View<PATFinalState> > srcToken_;
     std::string name_;
     TFileDirectory& fs_;
     edm::ParameterSet analysisCfg_;
@@ -68,7 +69,7 @@ class PATFinalStateAnalysis {
     // Tools for applying event weights
     typedef StringObjectFunction<PATFinalStateEvent> EventFunction;
     edm::EDGetTokenT<PATFinalStateEventCollection> evtSrcToken_;
-    std::vector<EventFunction> evtWeights_;
+    std::vector<boost::shared_ptr<const EventFunction> > evtWeights_;
 
     // Tool for examining individual runs
     bool splitRuns_;
@@ -36,6 +36,13 @@ class PATFinalStateSelection : public Selector<PATFinalStatePtrs> {
     // Get the cut flow table
     const ek::CutFlow* cutFlow() const { return cutFlow_.get(); }
 
+    // Write the accumulated histogram fills.  Call at endJob.
+    void flush();
+
+    // Print the number of evaluations and the time spent in each cut.
+    // Timing is only measured if the timeCuts option is set.
+    void printCutTiming(std::ostream& out) const;
+
   private:
     bool operator()(const PATFinalStatePtrs&, pat::strbitset&) {
       throw cms::Exception("notimplemented");
@@ -107,6 +107,33 @@ _eta_cuts = {
     'j': '2.5'
 }
 
+# Smaller, faster ntuples: baskets sized to the (hundreds of) branches and
+# the kinematic columns rounded to 12 mantissa bits (~1e-4 relative).
+# Pass as make_ntuple(..., writePolicy=compact_write_policy), see
+# Utilities/interface/ExpressionNtuplePolicy.h for the settings.
+compact_write_policy = cms.PSet(
+    basketBytes = cms.int32(16000000),
+    minBasketSize = cms.int32(4096),
+    compressionAlgorithm = cms.string("LZMA"),
+    compressionLevel = cms.int32(4),
+    columns = cms.VPSet(
+        cms.PSet(
+            names = cms.vstring('*Pt', '*Eta', '*Phi', '*Mass', '*_Mt',
+                                '*Energy', '*Px', '*Py', '*Pz'),
+            mantissaBits = cms.int32(12),
+        ),
+    ),
+)
+
+# Columnar output: every column also written as a numpy .npy file under
+# [directory], readable with FinalStateAnalysis.Utilities.columnar without
+# converting the TTree.  With only=True the TTree is left empty.
+def columnar_write_policy(directory, only=False, base=None):
+    policy = base.clone() if base is not None else cms.PSet()
+    policy.columnarDirectory = cms.string(directory)
+    policy.columnarOnly = cms.bool(only)
+    return policy
+
 # How to get from a leg name to "finalStateElecMuMuMu" etc
 _producer_translation = {
     'm': 'Mu',
@@ -164,7 +191,13 @@ def make_ntuple(*legs, **kwargs):
 
     You can specify that no disambiguation can be applied (i.e. a dimuon
     candidate will appear twice in the mu-mu ntuple, in both orders)
-    by setting 'noclean' to True in kwargs.
+    by setting 'noclean' to True in kwargs.  The final states must then be
+    built without uniqueLegs (see produce_final_states).
+
+    The tree write settings (baskets, compression, float precision) can be
+    set with the keyword argument writePolicy, e.g. compact_write_policy.
+    The writePolicy can also ask for columnar (.npy) output next to, or
+    instead of, the TTree, e.g. columnar_write_policy('columns').
 
     '''
     postfix = kwargs.pop('postfix','')
@@ -331,11 +364,12 @@ def make_ntuple(*legs, **kwargs):
             ntuple_config,
             dicandidate_template.replace(object1=leg_a, object2=leg_b),
             )
-        # Check if we want to enable SVfit
-        # Only do SVfit in states with 2 or 4 leptons
-        do_svfit = kwargs.get("svFit", False)
+        # Check if this is a di-tau candidate pair (gets the fast di-tau mass,
+        # and SVfit if enabled)
+        # Only in states with 2 or 4 leptons
+        is_ditau = True
         if not len(legs) % 2 == 0:
-            do_svfit = False
+            is_ditau = False
 
         leg_a_type = leg_a[0]
         leg_b_type = leg_b[0]
@@ -345,14 +379,19 @@ def make_ntuple(*legs, **kwargs):
         leg_b_index = legs.index(leg_b_type) \
             if counts[leg_b_type] == 1 else legs.index(leg_b_type) + int(leg_b[1]) - 1
 
-        # Never do SVfit on 'non-paired' leptons (eg legs 0 & 2), or legs 1&3
+        # Never pair 'non-paired' leptons (eg legs 0 & 2), or legs 1&3
         # legs either adjacent or both ends (0 and 3)
         if leg_a_index % 2 != 0 or abs(leg_a_index - leg_b_index) % 2 != 1:
-            do_svfit = False
-        # Only do SVfit on mu + tau, e + tau, e + mu, & tau + tau combinations
+            is_ditau = False
+        # Only mu + tau, e + tau, e + mu, & tau + tau combinations
         if leg_a_type == leg_b_type and leg_a_type in ('m', 'e'):
-            do_svfit = False
-        if do_svfit:
+            is_ditau = False
+        if is_ditau:
+            ntuple_config = PSet(
+                ntuple_config,
+                topology.ditau.replace(object1=leg_a, object2=leg_b)
+            )
+        if is_ditau and kwargs.get("svFit", False):
             print "SV fitting legs %s and %s in final state %s" % (
                 leg_a, leg_b, ''.join(legs))
             ntuple_config = PSet(
@@ -402,7 +441,8 @@ def make_ntuple(*legs, **kwargs):
             selections=cms.VPSet(),
             EventView=cms.bool(False),
             final=cms.PSet(
-                sort=cms.string('daughter(0).pt'),  # Doesn't really matter
+                # Rows are ordered by final state pt unless a 'sort'
+                # expression (or list of tie-breaking expressions) is given
                 take=cms.uint32(999), # max number of rows for an event
                 plot=cms.PSet(
                     histos=cms.VPSet(),  # Don't make any final plots
@@ -413,6 +453,9 @@ def make_ntuple(*legs, **kwargs):
         )
     )
 
+    if 'writePolicy' in kwargs:
+        output.analysis.final.plot.ntuple.writePolicy = kwargs['writePolicy']
+
     # Apply minimal pt and eta cuts and "uniqueness requirements" 
     # to reduce final processing/storage.
     # See NtupleTools/python/uniqueness_cut_generator for details.
@@ -107,6 +107,10 @@ pairs = PSet(
     #object1_object2_ToMETDPhi_Ty1 = 'twoParticleDeltaPhiToMEt({object1_idx}, {object2_idx}, "type1")',
 )
 
+ditau = PSet(
+    object1_object2_DiTauMass = 'diTauMass({object1_idx},{object2_idx},"")',
+)
+
 svfit = PSet(
     #object1_object2_SVfitMass = 'SVfit({object1_idx},{object2_idx}).at(0)',
     #object1_object2_SVfitPt = 'SVfit({object1_idx},{object2_idx}).at(1)',
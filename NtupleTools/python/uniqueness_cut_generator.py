@@ -65,6 +65,30 @@ def uniqueness_cuts(channel, ptCuts={'e':'0','m':'0','t':'0','g':'0','j':'0'},
     return cuts
 
 
+def pt_ordered_legs(channel, **kwargs):
+    '''
+    Pairs of leg indices (i, j) for which uniqueness_cuts always requires
+    orderedInPt(i, j), whatever other options are used.  The final state
+    builders can skip these permutations directly (see ptOrderedLegs in
+    PatTools/interface/FinalStateLegUniqueness.h).
+    '''
+    channel = sorted(channel, key=lambda x: object_order_.index(x))
+    pairs = []
+    firstIndex = 0
+    for obj in sorted(set(channel), key=lambda x: object_order_.index(x)):
+        count = channel.count(obj)
+        idx = [firstIndex + x for x in range(count)]
+        if count in (2, 3):
+            pairs.append((idx[0], idx[1]))
+        elif count == 4 and not kwargs.get('dblH', False):
+            pairs.append((idx[0], idx[1]))
+            pairs.append((idx[2], idx[3]))
+        elif count == 5:
+            pairs.extend((i, j) for i in idx for j in idx if i < j)
+        firstIndex += count
+    return pairs
+
+
 def uniqueness_2(cuts, obj, firstIndex, **kwargs):
     '''
     Order the objects by pt.
@@ -23,14 +23,14 @@ PATFinalStateAnalysis::PATFinalStateAnalysis(
     const edm::ParameterSet& pset, TFileDirectory& fs, edm::ConsumesCollector&& iC):
     //const edm::ParameterSet& pset, TFileDirectory& fs):
   fs_(fs) {
-  srcToken_ = iC.consumes<PATFinalStateCollection>(pset.getParameter<edm::InputTag>("src"));
+  srcToken_ = iC.consumes<edm::View<PATFinalState> >(pset.getParameter<edm::InputTag>("src"));
   name_ = pset.getParameter<std::string>("@module_label");
 
   // Setup the code to apply event level weights
   std::vector<std::string> weights =
     pset.getParameter<std::vector<std::string> >("weights");
   for (size_t i = 0; i < weights.size(); ++i) {
-    evtWeights_.push_back(EventFunction(weights[i]));
+    evtWeights_.push_back(ek::sharedExpression<EventFunction>(weights[i]));
   }
   evtSrcToken_ = iC.consumes<PATFinalStateEventCollection>(pset.getParameter<edm::InputTag>("evtSrc"));
 
@@ -142,7 +142,7 @@ bool PATFinalStateAnalysis::filter(const edm::Event& evt) {
     edm::Handle<PATFinalStateEventCollection> event;
     evt.getByToken(evtSrcToken_, event);
     for (size_t i = 0; i < evtWeights_.size(); ++i) {
-      eventWeight *= evtWeights_[i]( (*event)[0] );
+      eventWeight *= (*evtWeights_[i])( (*event)[0] );
     }
   }
   // Count this event
@@ -150,8 +150,8 @@ bool PATFinalStateAnalysis::filter(const edm::Event& evt) {
   eventCounterWeighted_->Fill(0.0, eventWeight);
   eventWeights_->Fill(eventWeight);
 
-  // Get the final states to analyze
-  edm::Handle<PATFinalStateCollection> finalStates;
+  // Get the final states to analyze (a collection or a PtrVector view)
+  edm::Handle<edm::View<PATFinalState> > finalStates;
   evt.getByToken(srcToken_, finalStates);
 
   std::vector<const PATFinalState*> finalStatePtrs;
@@ -206,7 +206,16 @@ void PATFinalStateAnalysis::analyze(const edm::Event& evt) {
 }
 
 void PATFinalStateAnalysis::endJob() {
+  // Histograms are filled in bulk, write them before the file is closed
+  analysis_->flush();
+  for (RunMap::iterator run = runAnalysis_.begin();
+       run != runAnalysis_.end(); ++run) {
+    run->second->flush();
+  }
   std::cout << "Cut flow for analyzer: " << name_ << std::endl;
   analysis_->cutFlow()->print(std::cout);
   std::cout << std::endl;
+  std::cout << "Cut evaluations for analyzer: " << name_ << std::endl;
+  analysis_->printCutTiming(std::cout);
+  std::cout << std::endl;
 }
@@ -4,6 +4,8 @@
 #include "FinalStateAnalysis/Utilities/interface/CutFlow.h"
 #include "FWCore/Utilities/interface/RegexMatch.h"
 
+#include <iomanip>
+
 
 namespace {
   class CandPtSorter {
@@ -44,11 +46,15 @@ PATFinalStateSelection::PATFinalStateSelection(
 
   //setIgnoredCuts(ignore);
 
+  bool timeCuts = pset.exists("timeCuts") ?
+    pset.getParameter<bool>("timeCuts") : false;
+
   // Setup any ignored cuts
   for (size_t i = 0; i < cuts_.size(); ++i) {
     std::string cutName = cuts_[i].name();
     index_type cutIndex(&bits_, cutName);
     cutIndices_.push_back(cutIndex);
+    cuts_[i].setTiming(timeCuts);
 
     bool isIgnored = false;
     // Check if we are ignoring this cut
@@ -79,7 +85,11 @@ PATFinalStateSelection::PATFinalStateSelection(
 
   edm::ParameterSet final = pset.getParameterSet("final");
 
-  if (final.exists("sort")) {
+  // Either a single sort expression, or several to break ties
+  if (final.existsAs<std::vector<std::string> >("sort")) {
+    finalSort_.reset(new StringObjectSorter<PATFinalState>(
+          final.getParameter<std::vector<std::string> >("sort")));
+  } else if (final.exists("sort")) {
     finalSort_.reset(new StringObjectSorter<PATFinalState>(
           final.getParameter<std::string>("sort")));
   }
@@ -103,6 +113,53 @@ PATFinalStateSelection::PATFinalStateSelection(
 
 PATFinalStateSelection::~PATFinalStateSelection(){}
 
+void PATFinalStateSelection::flush() {
+  for (size_t i = 0; i < cuts_.size(); ++i) {
+    cuts_[i].flush();
+  }
+  if (finalPlots_.get())
+    finalPlots_->flush();
+  if (finalPlotsEventView_.get())
+    finalPlotsEventView_->flush();
+  cutFlow_->flush();
+}
+
+void PATFinalStateSelection::printCutTiming(std::ostream& out) const {
+  size_t longestName = 20;
+  for (size_t i = 0; i < cuts_.size(); ++i) {
+    if (cuts_[i].name().size() + 4 > longestName)
+      longestName = cuts_[i].name().size() + 4;
+  }
+  double total = 0;
+  for (size_t i = 0; i < cuts_.size(); ++i) {
+    total += cuts_[i].seconds();
+  }
+  out << std::setw(longestName) << std::left << "Cut";
+  out << std::setw(15) << std::right << "Evaluated";
+  out << std::setw(15) << std::right << "Passed";
+  out << std::setw(15) << std::right << "Time [s]";
+  out << std::setw(15) << std::right << "us/eval";
+  out << std::setw(15) << std::right << "Frac. Time" << std::endl;
+  for (size_t i = 0; i < longestName + 75; ++i)
+    out << "-";
+  out << std::endl;
+
+  out.setf(std::ios::fixed, std::ios::floatfield);
+
+  for (size_t i = 0; i < cuts_.size(); ++i) {
+    const FinalStateCut& cut = cuts_[i];
+    out << std::setw(longestName) << std::left << cut.name();
+    out << std::setw(15) << std::right << cut.evaluated();
+    out << std::setw(15) << std::right << cut.passed();
+    out << std::setw(15) << std::right
+      << std::setprecision(3) << cut.seconds();
+    out << std::setw(15) << std::right << std::setprecision(3)
+      << (cut.evaluated() ? 1e6*cut.seconds()/cut.evaluated() : 0.);
+    out << std::setw(15) << std::right << std::setprecision(4)
+      << (total > 0 ? cut.seconds()/total : 0.) << std::endl;
+  }
+}
+
 bool PATFinalStateSelection::operator()(const PATFinalStatePtrs& input,
     double weight) {
   // Copy the collection to one that we can modify.
@@ -134,12 +191,12 @@ bool PATFinalStateSelection::operator()(const PATFinalStatePtrs& input,
   // Fill the cut flow
   cutFlow_->fill(bits_, weight);
 
-  // Check if we want to sort the final selected candidates
-  // TODO: fix me.  For some reason this has problems (see Utilities unit tests)
-//  if (finalSort_.get()) {
-//    std::sort(passingLocal.begin(), passingLocal.end(), *finalSort_);
-//  }
-  std::sort(passingLocal.begin(), passingLocal.end(), CandPtSorter());
+  // Sort the final selected candidates, evaluating the sort expression
+  // once per candidate
+  if (finalSort_.get())
+    finalSort_->sort(passingLocal);
+  else
+    std::stable_sort(passingLocal.begin(), passingLocal.end(), CandPtSorter());
 
   // Copy only the desired number
   passing_.clear();
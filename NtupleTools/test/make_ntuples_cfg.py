@@ -57,6 +57,9 @@ paramFile=''   - custom parameter file for ntuple production
 keepPat=0      - Instead of making flat ntuples, write high level 
                  physics objects including the PATFinalState objects
                  memory use if you don't use them)
+uniqueLegs=0   - Don't build permutations of identical legs that the ntuple
+                 uniqueness cuts would remove (ignored with keepPat, or
+                 if the parameters set noclean)
 isEmbedded=0   - run on embedded sameples
 '''
 
@@ -132,6 +135,7 @@ options = TauVarParsing.TauVarParsing(
     runFSRFilter=0, # 1 = filter for ZG, -1 inverts filter for DY
     eventsToSkip='',
     isEmbedded=0,
+    uniqueLegs=0,
 )
 
 options.register(
@@ -975,6 +979,10 @@ for fs in additional_fs:
 # states themselves, because that fills the file up with unwanted stuff
 output_to_keep = []
 
+# The ntuples keep the identical-leg permutations with noclean
+uniqueLegs = bool(options.uniqueLegs and not options.keepPat
+                  and not parameters.get('noclean', False))
+
 # Eventually, set buildFSAEvent to False, currently working around bug
 # in pat tuples.
 produce_final_states(process, 
@@ -989,6 +997,8 @@ produce_final_states(process,
                      noTracks=True, 
                      runMVAMET=False,
                      hzz=options.hzz, 
+                     dblhMode=options.dblhMode,
+                     uniqueLegs=uniqueLegs,
                      rochCor=options.rochCor,
                      eleCor=options.eleCor, 
                      **parameters)
@@ -1009,6 +1019,8 @@ for fs in additional_fs:
                          noTracks=True, 
                          runMVAMET=False,
                          hzz=options.hzz, 
+                         dblhMode=options.dblhMode,
+                         uniqueLegs=uniqueLegs,
                          rochCor=options.rochCor,
                          eleCor=options.eleCor, 
                          postfix=fs, 
@@ -0,0 +1,42 @@
+/** \class FinalStateLegUniqueness
+ *
+ * Removes permutations of identical legs when the final state builders make
+ * their combinatorics, instead of leaving them to the uniqueness cuts of the
+ * ntuple.
+ *
+ * The configuration parameters of the builder are:
+ *  o ptOrderedLegs: flat list of leg index pairs (i, j).  Combinations where
+ *    leg i does not have larger pt than leg j are not built, exactly as the
+ *    orderedInPt(i, j) cut would reject them.  Default none.
+ *
+ */
+
+#ifndef __FINALSTATELEGUNIQUENESS_H__
+#define __FINALSTATELEGUNIQUENESS_H__
+
+#include "DataFormats/Candidate/interface/CandidateFwd.h"
+
+#include <utility>
+#include <vector>
+
+namespace edm {
+  class ParameterSet;
+}
+
+class FinalStateLegUniqueness {
+  public:
+    typedef std::vector<reco::CandidatePtr> Legs;
+
+    FinalStateLegUniqueness(const edm::ParameterSet& pset, size_t nLegs);
+
+    // True if any permutations are removed
+    bool enabled() const { return !ptOrdered_.empty(); }
+
+    // Check the configured leg ordering
+    bool ordered(const Legs& legs) const;
+
+  private:
+    std::vector<std::pair<size_t, size_t> > ptOrdered_;
+};
+
+#endif
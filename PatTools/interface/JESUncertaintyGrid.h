@@ -0,0 +1,87 @@
+/** \class JESUncertaintyGrid
+ *
+ * Immutable lookup grid for a set of JES uncertainty sources.
+ *
+ * The uncertainty source text files are parsed once with
+ * JetCorrectorParameters, and the (eta bin, pt point, up, down) tables are
+ * copied into flat arrays.  Lookups reproduce
+ * JetCorrectionUncertainty::getUncertainty (linear interpolation in pt,
+ * clamped at the grid edges) but are const and do not touch any mutable
+ * state, so a single grid can be shared between modules and streams.
+ *
+ * Grids are shared: get() hands out the same instance to every module that
+ * asks for the same file and list of sources.  fingerprint() identifies the
+ * file and sources, so values computed with one grid (e.g. embedded in the
+ * jets) can be checked before they are reused.
+ *
+ * Only the standard source layout ({1 JetEta 1 JetPt}) is supported.
+ *
+ */
+
+#ifndef __JESUNCERTAINTYGRID_H__
+#define __JESUNCERTAINTYGRID_H__
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace pattools {
+  class JESUncertaintyGrid {
+  private:
+    struct source_info {
+      // nEtaBins + 1 edges
+      std::vector<float> eta_edges;
+      // Offsets into the flat pt/up/down arrays, nEtaBins + 1 entries
+      std::vector<size_t> offsets;
+      std::vector<float> pt;
+      std::vector<float> up;
+      std::vector<float> down;
+    };
+    std::vector<std::string> _names;
+    std::vector<source_info> _sources;
+    int _fingerprint;
+
+    float lookup(const source_info& source, float eta, float pt,
+                 bool up) const;
+
+  public:
+    JESUncertaintyGrid(const std::string& fileName,
+                       const std::vector<std::string>& sourceNames);
+
+    /// The regrouped sources used by the jet and MET systematics embedders,
+    /// as named in [fileName] (the year specific ones depend on the file),
+    /// and the labels they are stored under.  The last one is the total.
+    static std::vector<std::string> regroupedSources(
+        const std::string& fileName);
+    static const std::vector<std::string>& regroupedLabels();
+
+    size_t size() const { return _sources.size(); }
+    const std::string& name(size_t iSource) const { return _names[iSource]; }
+    /// Hash of the file name and the source names
+    int fingerprint() const { return _fingerprint; }
+
+    /// Get the grid for the given file and sources, building it on first use
+    static std::shared_ptr<const JESUncertaintyGrid> get(
+        const std::string& fileName,
+        const std::vector<std::string>& sourceNames);
+
+    /// Relative uncertainty of one source for a jet.  Returns -999 if the
+    /// jet is outside the eta range of the source, as JetCorrectionUncertainty
+    /// does.
+    float uncertainty(size_t iSource, float eta, float pt,
+                      bool up = true) const;
+
+    /// Relative uncertainties of every source for a jet, in source order.
+    void uncertainties(float eta, float pt, std::vector<float>& out,
+                       bool up = true) const;
+
+    /// Relative uncertainties of every source for a collection of jets,
+    /// source-major: out[iSource*nJets + iJet].  Same values as the per jet
+    /// calls.
+    void uncertainties(const std::vector<float>& etas,
+                       const std::vector<float>& pts,
+                       std::vector<float>& out, bool up = true) const;
+  };
+}
+
+#endif
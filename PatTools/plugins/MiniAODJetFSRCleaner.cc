@@ -2,7 +2,11 @@
 //                                                                          //
 //   MiniAODJetFSRCleaner.cc                                                //
 //                                                                          //
-//   Removes jets close to FSR photons.                                     //
+//   Removes jets close to FSR photons. The photons are gathered from the   //
+//       leptons passing this module's FSR selection, or, if                //
+//       'fsrAssociation' is set, taken from that                           //
+//       MiniAODLeptonFSRAssociationProducer (whose lepton selection must   //
+//       then be the one wanted for the jet cleaning).                      //
 //                                                                          //
 //   Author: Nate Woods, U. Wisconsin                                       //
 //                                                                          //
@@ -62,12 +66,16 @@ private:
               std::vector<CandPtr>& addTo) const;
   bool selectFSRLep(const ElecPtr& e) const;
   bool selectFSRLep(const MuonPtr& m) const;
-  
+
   //// Data
   edm::EDGetTokenT<JetView> collectionTokenJ;
   edm::EDGetTokenT<ElecView> collectionTokenE;
   edm::EDGetTokenT<MuonView> collectionTokenM;
 
+  // Photons from a MiniAODLeptonFSRAssociationProducer, if given
+  const bool useAssociation;
+  edm::EDGetTokenT<std::vector<CandPtr> > fsrToken;
+
   // Consider fsr from leptons passing these selections
   StringCutObjectSelector<Elec> fsrElecSelection;
   StringCutObjectSelector<Muon> fsrMuonSelection;
@@ -84,12 +92,7 @@ MiniAODJetFSRCleaner::MiniAODJetFSRCleaner(const edm::ParameterSet& iConfig):
   collectionTokenJ(consumes<JetView>(iConfig.exists("src") ? 
                                       iConfig.getParameter<edm::InputTag>("src") :
                                       edm::InputTag("slimmedJets"))),
-  collectionTokenE(consumes<ElecView>(iConfig.exists("srcE") ? 
-                                      iConfig.getParameter<edm::InputTag>("srcE") :
-                                      edm::InputTag("slimmedElectrons"))),
-  collectionTokenM(consumes<MuonView>(iConfig.exists("srcMu") ? 
-                                      iConfig.getParameter<edm::InputTag>("srcMu") :
-                                      edm::InputTag("slimmedMuons"))),
+  useAssociation(iConfig.exists("fsrAssociation")),
   fsrElecSelection(iConfig.exists("fsrElecSelection") ?
                    iConfig.getParameter<std::string>("fsrElecSelection") :
                    ""),
@@ -103,6 +106,19 @@ MiniAODJetFSRCleaner::MiniAODJetFSRCleaner(const edm::ParameterSet& iConfig):
            iConfig.getParameter<double>("deltaR") :
            0.4)
 {
+  if(useAssociation)
+    fsrToken = consumes<std::vector<CandPtr> >(edm::InputTag(iConfig.getParameter<edm::InputTag>("fsrAssociation").label(),
+                                                             "photons"));
+  else
+    {
+      collectionTokenE = consumes<ElecView>(iConfig.exists("srcE") ?
+                                            iConfig.getParameter<edm::InputTag>("srcE") :
+                                            edm::InputTag("slimmedElectrons"));
+      collectionTokenM = consumes<MuonView>(iConfig.exists("srcMu") ?
+                                            iConfig.getParameter<edm::InputTag>("srcMu") :
+                                            edm::InputTag("slimmedMuons"));
+    }
+
   produces<std::vector<Jet> >();
 }
 
@@ -110,17 +126,25 @@ MiniAODJetFSRCleaner::MiniAODJetFSRCleaner(const edm::ParameterSet& iConfig):
 void MiniAODJetFSRCleaner::produce(edm::Event& iEvent, const edm::EventSetup& iSetup)
 {
   edm::Handle<JetView> jetsIn;
-  edm::Handle<ElecView> elecsIn;
-  edm::Handle<MuonView> muonsIn;
-
   iEvent.getByToken(collectionTokenJ, jetsIn);
-  iEvent.getByToken(collectionTokenE, elecsIn);
-  iEvent.getByToken(collectionTokenM, muonsIn);
 
-  std::vector<CandPtr> fsr = getFSR(elecsIn, muonsIn);
+  edm::Handle<std::vector<CandPtr> > fsrIn;
+  std::vector<CandPtr> gathered;
+  if(useAssociation)
+    iEvent.getByToken(fsrToken, fsrIn);
+  else
+    {
+      edm::Handle<ElecView> elecsIn;
+      edm::Handle<MuonView> muonsIn;
+      iEvent.getByToken(collectionTokenE, elecsIn);
+      iEvent.getByToken(collectionTokenM, muonsIn);
+      gathered = getFSR(elecsIn, muonsIn);
+    }
+  const std::vector<CandPtr>& fsr = useAssociation ? *fsrIn : gathered;
 
   std::unique_ptr<std::vector<Jet> > out = 
     std::unique_ptr<std::vector<Jet> >(new std::vector<Jet>);
+  out->reserve(jetsIn->size());
 
   for(size_t iJ = 0; iJ < jetsIn->size(); ++iJ)
     {
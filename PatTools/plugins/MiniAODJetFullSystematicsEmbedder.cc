@@ -9,15 +9,14 @@
 #include "DataFormats/PatCandidates/interface/Jet.h"
 #include "DataFormats/Candidate/interface/LeafCandidate.h"
 
-#include "JetMETCorrections/Objects/interface/JetCorrector.h"
-#include "JetMETCorrections/Objects/interface/JetCorrectionsRecord.h"
-#include "CondFormats/JetMETObjects/interface/JetCorrectorParameters.h"
-#include "CondFormats/JetMETObjects/interface/JetCorrectionUncertainty.h"
 #include "DataFormats/PatCandidates/interface/MET.h"
 
+#include "FinalStateAnalysis/PatTools/interface/JESUncertaintyGrid.h"
+
 #include "FWCore/MessageLogger/interface/MessageLogger.h"
 
 #include <algorithm>
+#include <memory>
 #include <string>
 
 class MiniAODJetFullSystematicsEmbedder : public edm::EDProducer {
@@ -35,83 +34,11 @@ class MiniAODJetFullSystematicsEmbedder : public edm::EDProducer {
     edm::EDGetTokenT<edm::View<pat::Jet> > srcToken_;
     std::string label_;
     std::string fName_;
-    std::vector< std::string > outputNames = {
-    "Absolute", 
-    "Absoluteyear", 
-    "BBEC1",
-    "BBEC1year",
-    "EC2", 
-    "EC2year",
-    "FlavorQCD",
-    "HF",
-    "HFyear",
-    "RelativeBal",
-    "RelativeSample",
-    "Total"
-    };
-
-    std::vector< std::string > uncertNames2016 = {
-    "Absolute",
-    "Absolute_2016",
-    "BBEC1",
-    "BBEC1_2016",
-    "EC2",
-    "EC2_2016",
-    "FlavorQCD",
-    "HF",
-    "HF_2016",
-    "RelativeBal",
-    "RelativeSample_2016",
-    "Total"
-    };
-
-    std::vector< std::string > uncertNames2017 = {
-    "Absolute",
-    "Absolute_2017",
-    "BBEC1",
-    "BBEC1_2017",
-    "EC2",
-    "EC2_2017",
-    "FlavorQCD",
-    "HF",
-    "HF_2017",
-    "RelativeBal",
-    "RelativeSample_2017",
-    "Total"
-    };
-
-    std::vector< std::string > uncertNames2018 = {
-    "Absolute",
-    "Absolute_2018",
-    "BBEC1",
-    "BBEC1_2018",
-    "EC2",
-    "EC2_2018",
-    "FlavorQCD",
-    "HF",
-    "HF_2018",
-    "RelativeBal",
-    "RelativeSample_2018",
-    "Total"
-    };
-
-    std::vector< std::string > uncertNames = {
-    "Absolute",
-    "Absoluteyear",
-    "BBEC1",
-    "BBEC1year",
-    "EC2",
-    "EC2year",
-    "FlavorQCD",
-    "HF",
-    "HFyear",
-    "RelativeBal",
-    "RelativeSample",
-    "Total"
-    };
-
-    std::map<std::string, JetCorrectorParameters const *> JetCorParMap;
-    std::map<std::string, JetCorrectionUncertainty* > JetUncMap;
+    // Labels of the regrouped sources, the last one is the total
+    const std::vector<std::string>& outputNames =
+      pattools::JESUncertaintyGrid::regroupedLabels();
+
+    std::shared_ptr<const pattools::JESUncertaintyGrid> jesGrid_;
 };
 
 // Get the transverse component of the vector
@@ -131,29 +58,10 @@ MiniAODJetFullSystematicsEmbedder::MiniAODJetFullSystematicsEmbedder(const edm::
   std::cout << "Uncert File: " << fName_ << std::endl;
   produces<pat::JetCollection>();
 
-  size_t found2016 = fName_.find("Summer16");
-  size_t found2017 = fName_.find("Fall17");
-  size_t found2018 = fName_.find("Autumn18");
-
-  int k=0;
-  for (auto const& name : uncertNames) {
-     if (found2016!=std::string::npos) uncertNames[k]=uncertNames2016[k];
-     else if (found2017!=std::string::npos) uncertNames[k]=uncertNames2017[k];
-     else if (found2018!=std::string::npos) uncertNames[k]=uncertNames2018[k];
-     k=k+1;
-  }
-
-  // Create the uncertainty tool for each uncert
-  k=0;
-  for (auto const& name : uncertNames) {
-    JetCorrectorParameters const * JetCorPar = new JetCorrectorParameters(fName_, name);
-    JetCorParMap[name] = JetCorPar;
-
-    JetCorrectionUncertainty * jecUnc(
-        new JetCorrectionUncertainty(*JetCorParMap[name]));
-    JetUncMap[name] = jecUnc;
-    k=k+1;
-  };
+  // Parse every uncertainty source once into a shared lookup grid, the
+  // same one MiniAODMETJesSystematicsEmbedder gets for this file
+  jesGrid_ = pattools::JESUncertaintyGrid::get(fName_,
+      pattools::JESUncertaintyGrid::regroupedSources(fName_));
 }
 
 void MiniAODJetFullSystematicsEmbedder::produce(edm::Event& evt, const edm::EventSetup& es) {
@@ -164,24 +72,32 @@ void MiniAODJetFullSystematicsEmbedder::produce(edm::Event& evt, const edm::Even
   evt.getByToken(srcToken_, jets);
   size_t nJets = jets->size();
 
+  // All sources for all jets at once, source-major
+  std::vector<float> etas(nJets), pts(nJets);
+  for (size_t i = 0; i < nJets; ++i) {
+    etas[i] = jets->at(i).eta();
+    pts[i] = jets->at(i).pt();
+  }
+  std::vector<float> uncs;
+  jesGrid_->uncertainties(etas, pts, uncs, true);
+
   output->reserve(jets->size());
   for (size_t i = 0; i < jets->size(); ++i) {
     pat::Jet jet = jets->at(i);
 
-    int k=-1;
-    for (auto const& name : uncertNames) {
-      k=k+1;
-      double unc = 0;
-      if (std::abs(jet.eta()) < 5.2 && jet.pt() > 9) {
-          JetUncMap[name]->setJetEta(jet.eta());
-          JetUncMap[name]->setJetPt(jet.pt());
-          unc = JetUncMap[name]->getUncertainty(true);
-      } // Shifted jets within absEta and pT
+    // Shifted jets within absEta and pT
+    bool shifted = std::abs(jet.eta()) < 5.2 && jet.pt() > 9;
+
+    for (size_t k = 0; k < jesGrid_->size(); ++k) {
+      double unc = shifted ? uncs[k*nJets + i] : 0.;
       float ptplus=(1+unc)*jet.pt();
       float ptminus=(1-unc)*jet.pt();
       jet.addUserFloat("jes"+outputNames[k]+"+", ptplus);
       jet.addUserFloat("jes"+outputNames[k]+"-", ptminus);
     } // end loop over uncertainties
+    // Which file and sources the shifts come from, so they are only reused
+    // with the same grid
+    jet.addUserInt("jesGrid", jesGrid_->fingerprint());
     output->push_back(jet);
   } // end loop over jets
 
@@ -0,0 +1,245 @@
+//////////////////////////////////////////////////////////////////////////////
+//                                                                          //
+//   MiniAODLeptonFSRAssociationProducer.cc                                 //
+//                                                                          //
+//   Gathers the FSR photons attached to selected leptons once per event    //
+//       and publishes them, along with the lepton<->photon association     //
+//       (deltaR to the lepton's own FSR photon and the HZZ4l isolation     //
+//       footprint of all FSR photons), for use by the HZZ isolation        //
+//       decider (and optionally the jet FSR cleaner).                      //
+//                                                                          //
+//   Products:                                                              //
+//       "photons"                  std::vector<reco::CandidatePtr>         //
+//       "electronFSRIsoCorrection" edm::ValueMap<float>                    //
+//       "muonFSRIsoCorrection"     edm::ValueMap<float>                    //
+//       "electronFSRDeltaR"        edm::ValueMap<float> (-1 if no FSR)     //
+//       "muonFSRDeltaR"            edm::ValueMap<float> (-1 if no FSR)     //
+//                                                                          //
+//////////////////////////////////////////////////////////////////////////////
+
+
+// system includes
+#include <memory>
+#include <vector>
+
+// CMS includes
+#include "FWCore/Framework/interface/Frameworkfwd.h"
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Framework/interface/MakerMacros.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "DataFormats/PatCandidates/interface/Electron.h"
+#include "DataFormats/PatCandidates/interface/Muon.h"
+#include "DataFormats/Common/interface/ValueMap.h"
+#include "DataFormats/Common/interface/View.h"
+#include "DataFormats/Math/interface/deltaR.h"
+#include "CommonTools/Utils/interface/StringCutObjectSelector.h"
+#include "FWCore/Framework/interface/stream/EDProducer.h"
+
+typedef reco::Candidate Cand;
+typedef edm::Ptr<Cand> CandPtr;
+typedef pat::Electron Elec;
+typedef edm::Ptr<pat::Electron> ElecPtr;
+typedef edm::View<pat::Electron> ElecView;
+typedef pat::Muon Muon;
+typedef edm::Ptr<pat::Muon> MuonPtr;
+typedef edm::View<pat::Muon> MuonView;
+
+
+class MiniAODLeptonFSRAssociationProducer : public edm::stream::EDProducer<>
+{
+public:
+  explicit MiniAODLeptonFSRAssociationProducer(const edm::ParameterSet&);
+  ~MiniAODLeptonFSRAssociationProducer() {}
+
+private:
+  //// Methods
+  virtual void produce(edm::Event& iEvent, const edm::EventSetup& iSetup);
+
+  // Add the FSR photons of selected leptons to the list
+  template<typename Lep>
+  void addFSR(const edm::Handle<edm::View<Lep> >& leps,
+              std::vector<CandPtr>& fsr) const;
+  bool selectFSRLep(const ElecPtr& e) const;
+  bool selectFSRLep(const MuonPtr& m) const;
+
+  // Compute the association for every lepton in the collection and put
+  // the resulting value maps in the event
+  template<typename Lep>
+  void associate(edm::Event& iEvent,
+                 const edm::Handle<edm::View<Lep> >& leps,
+                 const std::vector<CandPtr>& fsr,
+                 const std::string& instance) const;
+
+  bool fsrInIsoCone(const ElecPtr& e, float fsrDR) const;
+  bool fsrInIsoCone(const MuonPtr& m, float fsrDR) const;
+
+  //// Data
+  edm::EDGetTokenT<ElecView> collectionTokenE;
+  edm::EDGetTokenT<MuonView> collectionTokenM;
+
+  //// Electron isolation footprint
+  const double isoConeDRMaxE;
+  const double isoConeDRMinE;
+  // only worry about isolation veto cone in barrel
+  const double isoConeVetoEtaThresholdE;
+
+  //// Muon isolation footprint
+  const double isoConeDRMaxM;
+  const double isoConeDRMinM;
+
+  // Consider fsr from leptons passing these selections
+  StringCutObjectSelector<Elec> fsrElecSelection;
+  StringCutObjectSelector<Muon> fsrMuonSelection;
+
+  // Label of FSR userCand
+  const std::string fsrLabel;
+};
+
+
+MiniAODLeptonFSRAssociationProducer::MiniAODLeptonFSRAssociationProducer(const edm::ParameterSet& iConfig):
+  collectionTokenE(consumes<ElecView>(iConfig.exists("srcE") ?
+                                      iConfig.getParameter<edm::InputTag>("srcE") :
+                                      edm::InputTag("slimmedElectrons"))),
+  collectionTokenM(consumes<MuonView>(iConfig.exists("srcMu") ?
+                                      iConfig.getParameter<edm::InputTag>("srcMu") :
+                                      edm::InputTag("slimmedMuons"))),
+  isoConeDRMaxE(iConfig.exists("isoConeDRMaxE") ?
+                iConfig.getParameter<double>("isoConeDRMaxE") : 0.4),
+  isoConeDRMinE(iConfig.exists("isoConeDRMinE") ?
+                iConfig.getParameter<double>("isoConeDRMinE") : 0.08),
+  isoConeVetoEtaThresholdE(iConfig.exists("isoConeVetoEtaThresholdE") ?
+                           iConfig.getParameter<double>("isoConeVetoEtaThresholdE") :
+                           1.479),
+  isoConeDRMaxM(iConfig.exists("isoConeDRMaxMu") ?
+                iConfig.getParameter<double>("isoConeDRMaxMu") : 0.4),
+  isoConeDRMinM(iConfig.exists("isoConeDRMinMu") ?
+                iConfig.getParameter<double>("isoConeDRMinMu") : 0.01),
+  fsrElecSelection(iConfig.exists("fsrElecSelection") ?
+                   iConfig.getParameter<std::string>("fsrElecSelection") :
+                   ""),
+  fsrMuonSelection(iConfig.exists("fsrMuonSelection") ?
+                   iConfig.getParameter<std::string>("fsrMuonSelection") :
+                   ""),
+  fsrLabel(iConfig.exists("fsrLabel") ?
+           iConfig.getParameter<std::string>("fsrLabel") :
+           std::string("dretFSRCand"))
+{
+  produces<std::vector<CandPtr> >("photons");
+  produces<edm::ValueMap<float> >("electronFSRIsoCorrection");
+  produces<edm::ValueMap<float> >("muonFSRIsoCorrection");
+  produces<edm::ValueMap<float> >("electronFSRDeltaR");
+  produces<edm::ValueMap<float> >("muonFSRDeltaR");
+}
+
+
+void MiniAODLeptonFSRAssociationProducer::produce(edm::Event& iEvent, const edm::EventSetup& iSetup)
+{
+  edm::Handle<ElecView> elecsIn;
+  edm::Handle<MuonView> muonsIn;
+
+  iEvent.getByToken(collectionTokenE, elecsIn);
+  iEvent.getByToken(collectionTokenM, muonsIn);
+
+  std::unique_ptr<std::vector<CandPtr> > fsr(new std::vector<CandPtr>);
+
+  addFSR(elecsIn, *fsr);
+  addFSR(muonsIn, *fsr);
+
+  associate(iEvent, elecsIn, *fsr, "electron");
+  associate(iEvent, muonsIn, *fsr, "muon");
+
+  iEvent.put(std::move(fsr), "photons");
+}
+
+
+template<typename Lep>
+void
+MiniAODLeptonFSRAssociationProducer::addFSR(const edm::Handle<edm::View<Lep> >& leps,
+                                            std::vector<CandPtr>& fsr) const
+{
+  for(size_t iLep = 0; iLep < leps->size(); ++iLep)
+    {
+      edm::Ptr<Lep> lep = leps->ptrAt(iLep);
+
+      if(!selectFSRLep(lep)) continue;
+
+      if(lep->hasUserCand(fsrLabel))
+        fsr.push_back(lep->userCand(fsrLabel));
+    }
+}
+
+
+template<typename Lep>
+void
+MiniAODLeptonFSRAssociationProducer::associate(edm::Event& iEvent,
+                                               const edm::Handle<edm::View<Lep> >& leps,
+                                               const std::vector<CandPtr>& fsr,
+                                               const std::string& instance) const
+{
+  std::vector<float> isoCorrections(leps->size(), 0.);
+  std::vector<float> ownFSRDR(leps->size(), -1.);
+
+  for(size_t iLep = 0; iLep < leps->size(); ++iLep)
+    {
+      const edm::Ptr<Lep> lep = leps->ptrAt(iLep);
+
+      if(selectFSRLep(lep) && lep->hasUserCand(fsrLabel))
+        ownFSRDR[iLep] = reco::deltaR(lep->userCand(fsrLabel)->p4(), lep->p4());
+
+      for(size_t iFSR = 0; iFSR < fsr.size(); ++iFSR)
+        {
+          float fsrDR = reco::deltaR(fsr[iFSR]->p4(), lep->p4());
+
+          if(fsrInIsoCone(lep, fsrDR))
+            isoCorrections[iLep] += fsr[iFSR]->pt();
+        }
+    }
+
+  std::unique_ptr<edm::ValueMap<float> > isoOut(new edm::ValueMap<float>);
+  edm::ValueMap<float>::Filler isoFiller(*isoOut);
+  isoFiller.insert(leps, isoCorrections.begin(), isoCorrections.end());
+  isoFiller.fill();
+  iEvent.put(std::move(isoOut), instance + "FSRIsoCorrection");
+
+  std::unique_ptr<edm::ValueMap<float> > drOut(new edm::ValueMap<float>);
+  edm::ValueMap<float>::Filler drFiller(*drOut);
+  drFiller.insert(leps, ownFSRDR.begin(), ownFSRDR.end());
+  drFiller.fill();
+  iEvent.put(std::move(drOut), instance + "FSRDeltaR");
+}
+
+
+bool
+MiniAODLeptonFSRAssociationProducer::fsrInIsoCone(const ElecPtr& e,
+                                                  float fsrDR) const
+{
+  return (fsrDR < isoConeDRMaxE &&
+          (e->superCluster()->eta() < isoConeVetoEtaThresholdE ||
+           fsrDR > isoConeDRMinE));
+}
+
+
+bool
+MiniAODLeptonFSRAssociationProducer::fsrInIsoCone(const MuonPtr& m,
+                                                  float fsrDR) const
+{
+  return (fsrDR < isoConeDRMaxM && fsrDR > isoConeDRMinM);
+}
+
+
+bool
+MiniAODLeptonFSRAssociationProducer::selectFSRLep(const ElecPtr& e) const
+{
+  return fsrElecSelection(*e);
+}
+
+
+bool
+MiniAODLeptonFSRAssociationProducer::selectFSRLep(const MuonPtr& m) const
+{
+  return fsrMuonSelection(*m);
+}
+
+
+//define this as a plug-in
+DEFINE_FWK_MODULE(MiniAODLeptonFSRAssociationProducer);
@@ -5,6 +5,10 @@
 //   Embeds lepton relative isolation and isolation decisions as userfloats //
 //       (1 for true, 0 for false) for use in other modules, using          //
 //       HZZ4l2015 definitions.                                             //
+//       The FSR isolation footprint is taken from the association made     //
+//       by a MiniAODLeptonFSRAssociationProducer if 'fsrAssociation' is    //
+//       set, otherwise the photons are gathered here from the leptons      //
+//       passing fsrElecSelection/fsrMuonSelection.                         //
 //                                                                          //
 //   Author: Nate Woods, U. Wisconsin                                       //
 //                                                                          //
@@ -26,6 +30,7 @@
 #include "DataFormats/PatCandidates/interface/Muon.h"
 #include "DataFormats/Common/interface/ValueMap.h"
 #include "DataFormats/Common/interface/View.h"
+#include "DataFormats/Math/interface/deltaR.h"
 #include "FWCore/ServiceRegistry/interface/Service.h"
 #include "CommonTools/UtilAlgos/interface/TFileService.h"
 #include "CommonTools/Utils/interface/StringCutObjectSelector.h"
@@ -54,15 +59,18 @@ private:
   virtual void produce(edm::Event& iEvent, const edm::EventSetup& iSetup);
 
   // Make collection to output. Heap allocation done here.
+  // The FSR footprint comes from [fsrIsoCorrections] if given, otherwise
+  // from [fsrs]
   template<typename Lep>
-  std::auto_ptr<std::vector<Lep> >
+  std::unique_ptr<std::vector<Lep> >
   makeCollection(const edm::Handle<edm::View<Lep> >& lepsIn,
+                 const edm::ValueMap<float>* fsrIsoCorrections,
                  const std::vector<CandPtr>& fsrs) const;
 
   // Actual isolation calculation
   template<typename Lep>
   float relPFIsoFSR(const edm::Ptr<Lep>& lep,
-                    const std::vector<CandPtr>& fsrs) const;
+                    float fsrCorrection) const;
   float isoPUCorrection(const ElecPtr& e) const;
   float isoPUCorrection(const MuonPtr& m) const;
   template<typename Lep>
@@ -72,7 +80,7 @@ private:
                     const CandPtr& fsr) const;
   bool fsrInIsoCone(const MuonPtr& m,
                     const CandPtr& fsr) const;
-  
+
   // Isolation variables for e and mu (why isn't this standard???)
   const reco::GsfElectron::PflowIsolationVariables& 
   isolationVariables(const ElecPtr&) const;
@@ -97,14 +105,15 @@ private:
   edm::EDGetTokenT<ElecView> collectionTokenE;
   edm::EDGetTokenT<MuonView> collectionTokenM;
 
+  // Footprints from a MiniAODLeptonFSRAssociationProducer, if given
+  const bool useAssociation;
+  edm::EDGetTokenT<edm::ValueMap<float> > fsrIsoCorrectionTokenE;
+  edm::EDGetTokenT<edm::ValueMap<float> > fsrIsoCorrectionTokenM;
+
   // UserFloat labels
   const std::string isoValueLabel;
   const std::string isoDecisionLabel;
 
-  // Collections we'll output at the end
-    std::unique_ptr<std::vector<Elec> > outE;
-  std::unique_ptr<std::vector<Muon> > outM;
-
   //// Electron WPs
   const double isoCutE;
   const std::string rhoLabel;
@@ -141,6 +150,7 @@ MiniAODLeptonHZZIsoDecider::MiniAODLeptonHZZIsoDecider(const edm::ParameterSet&
   collectionTokenM(consumes<MuonView>(iConfig.exists("srcMu") ? 
                                       iConfig.getParameter<edm::InputTag>("srcMu") :
                                       edm::InputTag("slimmedMuons"))),
+  useAssociation(iConfig.exists("fsrAssociation")),
   isoValueLabel(iConfig.exists("isoValueLabel") ?
                 iConfig.getParameter<std::string>("isoValueLabel") :
                 std::string("HZZ4lIso")),
@@ -161,7 +171,7 @@ MiniAODLeptonHZZIsoDecider::MiniAODLeptonHZZIsoDecider(const edm::ParameterSet&
   isoConeDRMinE(iConfig.exists("isoConeDRMinE") ? 
                 iConfig.getParameter<double>("isoConeDRMinE") : 0.08),
   isoConeVetoEtaThresholdE(iConfig.exists("isoConeVetoEtaThresholdE") ? 
-                           iConfig.getParameter<double>("isoConeVetoEtaThreshold") : 
+                           iConfig.getParameter<double>("isoConeVetoEtaThresholdE") : 
                            1.479),
   isoCutM(iConfig.exists("isoCutMu") ? iConfig.getParameter<double>("isoCutMu") : 0.4),
   isoConeDRMaxM(iConfig.exists("isoConeDRMaxMu") ? 
@@ -178,6 +188,16 @@ MiniAODLeptonHZZIsoDecider::MiniAODLeptonHZZIsoDecider(const edm::ParameterSet&
            iConfig.getParameter<std::string>("fsrLabel") :
            std::string("dretFSRCand"))
 {
+  if(useAssociation)
+    {
+      const std::string association =
+        iConfig.getParameter<edm::InputTag>("fsrAssociation").label();
+      fsrIsoCorrectionTokenE = consumes<edm::ValueMap<float> >(edm::InputTag(association,
+                                                                             "electronFSRIsoCorrection"));
+      fsrIsoCorrectionTokenM = consumes<edm::ValueMap<float> >(edm::InputTag(association,
+                                                                             "muonFSRIsoCorrection"));
+    }
+
   produces<std::vector<Elec> >("electrons");
   produces<std::vector<Muon> >("muons");
 }
@@ -191,23 +211,36 @@ void MiniAODLeptonHZZIsoDecider::produce(edm::Event& iEvent, const edm::EventSet
   iEvent.getByToken(collectionTokenE, elecsIn);
   iEvent.getByToken(collectionTokenM, muonsIn);
 
-  std::vector<CandPtr> fsr = getFSR(elecsIn, muonsIn);
-
-  outE = makeCollection(elecsIn, fsr);
-  outM = makeCollection(muonsIn, fsr);
+  if(useAssociation)
+    {
+      edm::Handle<edm::ValueMap<float> > fsrIsoE;
+      edm::Handle<edm::ValueMap<float> > fsrIsoM;
+      iEvent.getByToken(fsrIsoCorrectionTokenE, fsrIsoE);
+      iEvent.getByToken(fsrIsoCorrectionTokenM, fsrIsoM);
+
+      const std::vector<CandPtr> noFSR;
+      iEvent.put(makeCollection(elecsIn, fsrIsoE.product(), noFSR), "electrons");
+      iEvent.put(makeCollection(muonsIn, fsrIsoM.product(), noFSR), "muons");
+    }
+  else
+    {
+      const std::vector<CandPtr> fsr = getFSR(elecsIn, muonsIn);
 
-    iEvent.put(std::move(outE), "electrons");
-    iEvent.put(std::move(outM), "muons");
+      iEvent.put(makeCollection(elecsIn, 0, fsr), "electrons");
+      iEvent.put(makeCollection(muonsIn, 0, fsr), "muons");
+    }
 }
     
 
 template<typename Lep>
-std::auto_ptr<std::vector<Lep> >
+std::unique_ptr<std::vector<Lep> >
 MiniAODLeptonHZZIsoDecider::makeCollection(const edm::Handle<edm::View<Lep> >& lepsIn,
+                                           const edm::ValueMap<float>* fsrIsoCorrections,
                                            const std::vector<CandPtr>& fsrs) const
 {
-  std::auto_ptr<std::vector<Lep> > out = 
-    std::auto_ptr<std::vector<Lep> >(new std::vector<Lep>);
+  std::unique_ptr<std::vector<Lep> > out = 
+    std::unique_ptr<std::vector<Lep> >(new std::vector<Lep>);
+  out->reserve(lepsIn->size());
 
   for(size_t iLep = 0; iLep < lepsIn->size(); ++iLep)
     {
@@ -221,7 +254,9 @@ MiniAODLeptonHZZIsoDecider::makeCollection(const edm::Handle<edm::View<Lep> >& l
       bool decision  = false;
       if(out->back().pt() > 0.)
         {
-          iso = relPFIsoFSR(lep, fsrs);
+          const float fsrCorrection = fsrIsoCorrections ?
+            (*fsrIsoCorrections)[lep] : isoFSRCorrection(lep, fsrs);
+          iso = relPFIsoFSR(lep, fsrCorrection);
           decision = (iso < getIsoCut(lep));
         }
       out->back().addUserFloat(isoValueLabel, iso);
@@ -236,15 +271,13 @@ MiniAODLeptonHZZIsoDecider::makeCollection(const edm::Handle<edm::View<Lep> >& l
 template<typename Lep>
 float 
 MiniAODLeptonHZZIsoDecider::relPFIsoFSR(const edm::Ptr<Lep>& lep,
-                                        const std::vector<CandPtr>& fsrs) const
+                                        float fsrCorrection) const
 {
   float chHadIso = isolationVariables(lep).sumChargedHadronPt;
   float nHadIso = isolationVariables(lep).sumNeutralHadronEt;
   float phoIso = isolationVariables(lep).sumPhotonEt;
   float puCorrection = isoPUCorrection(lep);
 
-  float fsrCorrection = isoFSRCorrection(lep, fsrs);
-  
   float neutralIso = nHadIso + phoIso - puCorrection - fsrCorrection;
   if(neutralIso < 0.)
     neutralIso = 0.;
@@ -304,7 +337,6 @@ bool
 MiniAODLeptonHZZIsoDecider::fsrInIsoCone(const ElecPtr& e,
                                          const CandPtr& fsr) const
 {
-  // float fsrDR = reco::deltaR(*fsr, *(e->superCluster()));
   float fsrDR = reco::deltaR(fsr->p4(), e->p4());
 
   bool inCone = (fsrDR < isoConeDRMaxE && 
@@ -346,9 +378,7 @@ MiniAODLeptonHZZIsoDecider::addFSR(const edm::Handle<edm::View<Lep> >& leps,
   for(size_t iLep = 0; iLep < leps->size(); ++iLep)
     {
       edm::Ptr<Lep> lep = leps->ptrAt(iLep);
-      
       if(!selectFSRLep(lep)) continue;
-
       if(lep->hasUserCand(fsrLabel))
         fsr.push_back(lep->userCand(fsrLabel));
     }
@@ -9,14 +9,13 @@
 #include "DataFormats/PatCandidates/interface/Jet.h"
 #include "DataFormats/Candidate/interface/LeafCandidate.h"
 
-#include "JetMETCorrections/Objects/interface/JetCorrector.h"
-#include "JetMETCorrections/Objects/interface/JetCorrectionsRecord.h"
-#include "CondFormats/JetMETObjects/interface/JetCorrectorParameters.h"
-#include "CondFormats/JetMETObjects/interface/JetCorrectionUncertainty.h"
 #include "DataFormats/PatCandidates/interface/MET.h"
 
+#include "FinalStateAnalysis/PatTools/interface/JESUncertaintyGrid.h"
+
 #include "FWCore/MessageLogger/interface/MessageLogger.h"
 
+#include <memory>
 #include <string>
 
 class MiniAODMETJesSystematicsEmbedder : public edm::EDProducer {
@@ -38,78 +37,13 @@ class MiniAODMETJesSystematicsEmbedder : public edm::EDProducer {
   std::string label_;
   std::string fName_;
 
-    std::vector< std::string > outputNames = {
-    "Absolute",
-    "Absoluteyear",
-    "BBEC1",
-    "BBEC1year",
-    "EC2",
-    "EC2year",
-    "FlavorQCD",
-    "HF",
-    "HFyear",
-    "RelativeBal",
-    "RelativeSample"
-    };
-
-    std::vector< std::string > uncertNames2016 = {
-    "Absolute",
-    "Absolute_2016",
-    "BBEC1",
-    "BBEC1_2016",
-    "EC2",
-    "EC2_2016",
-    "FlavorQCD",
-    "HF",
-    "HF_2016",
-    "RelativeBal",
-    "RelativeSample_2016"
-    };
-
-    std::vector< std::string > uncertNames2017 = {
-    "Absolute",
-    "Absolute_2017",
-    "BBEC1",
-    "BBEC1_2017",
-    "EC2",
-    "EC2_2017",
-    "FlavorQCD",
-    "HF",
-    "HF_2017",
-    "RelativeBal",
-    "RelativeSample_2017"
-    };
-
-    std::vector< std::string > uncertNames2018 = {
-    "Absolute",
-    "Absolute_2018",
-    "BBEC1",
-    "BBEC1_2018",
-    "EC2",
-    "EC2_2018",
-    "FlavorQCD",
-    "HF",
-    "HF_2018",
-    "RelativeBal",
-    "RelativeSample_2018"
-    };
-
-    std::vector< std::string > uncertNames = {
-    "Absolute",
-    "Absoluteyear",
-    "BBEC1",
-    "BBEC1year",
-    "EC2",
-    "EC2year",
-    "FlavorQCD",
-    "HF",
-    "HFyear",
-    "RelativeBal",
-    "RelativeSample"
-    };
-
-  std::map<std::string, JetCorrectorParameters const *> JetCorParMap;
-  std::map<std::string, JetCorrectionUncertainty* > JetUncMap;
+  // Labels of the regrouped sources; the MET is shifted by all but the
+  // last one, the total
+  const std::vector<std::string>& outputNames =
+    pattools::JESUncertaintyGrid::regroupedLabels();
+  const size_t nSources = outputNames.size() - 1;
+
+  std::shared_ptr<const pattools::JESUncertaintyGrid> jesGrid_;
 };
 
 // Get the transverse component of the vector
@@ -138,32 +72,14 @@ MiniAODMETJesSystematicsEmbedder::MiniAODMETJesSystematicsEmbedder(const edm::Pa
  produces<ShiftedCandCollection>("METJERUp");
  produces<ShiftedCandCollection>("METJERDown");
 
-  size_t found2016 = fName_.find("Summer16");
-  size_t found2017 = fName_.find("Fall17");
-  size_t found2018 = fName_.find("Autumn18");
-
-  int k=0;
-  for (auto const& name : uncertNames) {
-     if (found2016!=std::string::npos) uncertNames[k]=uncertNames2016[k];
-     if (found2017!=std::string::npos) uncertNames[k]=uncertNames2017[k];
-     if (found2018!=std::string::npos) uncertNames[k]=uncertNames2018[k];
-     k=k+1;
-  }
-
- k=0;
- for (auto const& name : uncertNames) {
+ for (size_t k = 0; k < nSources; ++k) {
   produces<ShiftedCandCollection>("p4OutMETUpJetsUncor"+outputNames[k]);
   produces<ShiftedCandCollection>("p4OutMETDownJetsUncor"+outputNames[k]);
-
-  // Create the uncertainty tool for each uncert
-  JetCorrectorParameters const * JetCorPar = new JetCorrectorParameters(fName_, name);
-  JetCorParMap[name] = JetCorPar;
-
-  JetCorrectionUncertainty * jecUnc(
-    new JetCorrectionUncertainty(*JetCorParMap[name]));
-  JetUncMap[name] = jecUnc;
-  k=k+1;
  };
+
+ // Same grid as MiniAODJetFullSystematicsEmbedder gets for this file
+ jesGrid_ = pattools::JESUncertaintyGrid::get(fName_,
+     pattools::JESUncertaintyGrid::regroupedSources(fName_));
 }
 
 void MiniAODMETJesSystematicsEmbedder::produce(edm::Event& evt, const edm::EventSetup& es) {
@@ -194,9 +110,43 @@ void MiniAODMETJesSystematicsEmbedder::produce(edm::Event& evt, const edm::Event
 
  bool skipMuons_=true;
 
- int k=-1;
- for (auto const& name : uncertNames) {
-  k=k+1;
+ // Evaluate every source once per jet, source-major.  Jets coming out of
+ // MiniAODJetFullSystematicsEmbedder already have the shifted pts embedded
+ // as jes<source>+ userFloats; those are only reused if they were computed
+ // with this grid (same file and sources), otherwise everything is
+ // recomputed here.
+ bool cached = true;
+ for (size_t i = 0; i < nJets && cached; ++i) {
+  const pat::Jet& jet = jets->at(i);
+  if (!(std::fabs(jet.eta()) < 5.2 && jet.pt() > 9)) continue;
+  cached = jet.hasUserInt("jesGrid") &&
+    jet.userInt("jesGrid") == jesGrid_->fingerprint();
+ }
+
+ std::vector<float> uncs;
+ if (cached) {
+  uncs.assign(nSources*nJets, 0.);
+  for (size_t i = 0; i < nJets; ++i) {
+   const pat::Jet& jet = jets->at(i);
+   if (!(std::fabs(jet.eta()) < 5.2 && jet.pt() > 9)) continue;
+   for (size_t k = 0; k < nSources; ++k)
+    uncs[k*nJets + i] = jet.userFloat("jes"+outputNames[k]+"+")/jet.pt() - 1.;
+  }
+ } else {
+  std::vector<float> etas(nJets), pts(nJets);
+  for (size_t i = 0; i < nJets; ++i) {
+   etas[i] = jets->at(i).eta();
+   pts[i] = jets->at(i).pt();
+  }
+  jesGrid_->uncertainties(etas, pts, uncs, true);
+  for (size_t i = 0; i < nJets; ++i) {
+   if (std::fabs(etas[i]) < 5.2 && pts[i] > 9) continue;
+   for (size_t k = 0; k < nSources; ++k)
+    uncs[k*nJets + i] = 0.;
+  }
+ }
+
+ for (size_t k = 0; k < nSources; ++k) {
   std::unique_ptr<ShiftedCandCollection> p4OutMETUpJets(new ShiftedCandCollection);
   std::unique_ptr<ShiftedCandCollection> p4OutMETDownJets(new ShiftedCandCollection);
 
@@ -211,16 +161,7 @@ void MiniAODMETJesSystematicsEmbedder::produce(edm::Event& evt, const edm::Event
 
    LorentzVector JetP4= jet.p4();
 
-   double unc = 0;
-   //double unc2=0;
-   if (std::fabs(jet.eta()) < 5.2 && JetP4.pt() > 9) {
-    JetUncMap[name]->setJetEta(JetP4.eta());
-    JetUncMap[name]->setJetPt(JetP4.pt());
-    unc = JetUncMap[name]->getUncertainty(true);  //up
-    JetUncMap[name]->setJetEta(JetP4.eta());
-    JetUncMap[name]->setJetPt(JetP4.pt());
-    //unc2 = JetUncMap[name]->getUncertainty(false);   // down
-   }
+   double unc = uncs[k*nJets + i];
 
    // Get uncorrected pt
    assert(jet.jecSetsAvailable());
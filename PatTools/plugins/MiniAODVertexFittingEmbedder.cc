@@ -72,7 +72,8 @@ void MiniAODVertexFittingEmbedder::produce(edm::Event& iEvent, const edm::EventS
 
   for (size_t iFS = 0; iFS < finalStatesIn->size(); ++iFS) 
     {
-      PATFinalState* embedInto = finalStatesIn->ptrAt(iFS)->clone();
+      PATFinalState* embedInto =
+        PATFinalState::addLayer(finalStatesIn->ptrAt(iFS));
 
       const double cat12 = getVertexFitting(*embedInto,12,iSetup);
       const double cat23 = getVertexFitting(*embedInto,23,iSetup);
@@ -3,6 +3,10 @@
  *
  * For process naming purposes.
  *
+ * With asPtrs = True nothing is copied: the output is an edm::PtrVector to
+ * the input final states, which downstream modules read through
+ * edm::View<PATFinalState>.
+ *
  * Author: Evan K. Friis, UW Madison
  *
  */
@@ -27,19 +31,32 @@ class PATFinalStateCopier : public edm::EDProducer {
   private:
     edm::EDGetTokenT<edm::View<PATFinalState> > srcToken_;
     std::string name_;
+    bool asPtrs_;
 };
 
 PATFinalStateCopier::PATFinalStateCopier(
     const edm::ParameterSet& pset) {
   srcToken_ = consumes<edm::View<PATFinalState> >(pset.getParameter<edm::InputTag>("src"));
-  produces<PATFinalStateCollection>();
+  asPtrs_ = pset.exists("asPtrs") ? pset.getParameter<bool>("asPtrs") : false;
+  if (asPtrs_)
+    produces<PATFinalStatePtrVector>();
+  else
+    produces<PATFinalStateCollection>();
 }
 void PATFinalStateCopier::produce(edm::Event& evt, const edm::EventSetup& es) {
-  std::unique_ptr<PATFinalStateCollection> output(new PATFinalStateCollection);
-
   edm::Handle<edm::View<PATFinalState> > finalStatesH;
   evt.getByToken(srcToken_, finalStatesH);
 
+  if (asPtrs_) {
+    std::unique_ptr<PATFinalStatePtrVector> output(new PATFinalStatePtrVector);
+    for (size_t i = 0; i < finalStatesH->size(); ++i) {
+      output->push_back(finalStatesH->ptrAt(i));
+    }
+    evt.put(std::move(output));
+    return;
+  }
+
+  std::unique_ptr<PATFinalStateCollection> output(new PATFinalStateCollection);
   for (size_t i = 0; i < finalStatesH->size(); ++i) {
     PATFinalState* embedInto = finalStatesH->ptrAt(i)->clone();
     output->push_back(embedInto); // takes ownership
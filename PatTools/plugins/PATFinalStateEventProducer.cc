@@ -113,6 +113,8 @@ private:
   edm::EDGetTokenT<edm::TriggerResults> trgResultsSrcToken_;
   edm::EDGetTokenT<edm::TriggerResults> trgResultsSrc2Token_;
   edm::EDGetTokenT< BXVector<l1t::Tau> > l1extraIsoTauSrcToken_;
+  // L1 taus below this pt are not kept for the matching
+  double l1TauMinPt_;
 
   //edm::EDGetTokenT<pat::JetCollection> jetAK8SrcToken_;
 
@@ -174,6 +176,8 @@ PATFinalStateEventProducer::PATFinalStateEventProducer(
   trgResultsSrcToken_ = consumes<edm::TriggerResults>(pset.getParameter<edm::InputTag>("trgResultsSrc"));
 						      trgResultsSrc2Token_ = consumes<edm::TriggerResults>(pset.getParameter<edm::InputTag>("trgResultsSrc2"));
   l1extraIsoTauSrcToken_ = consumes< BXVector<l1t::Tau> >(pset.getParameter<edm::InputTag>("l1extraIsoTauSrc"));
+  l1TauMinPt_ = pset.exists("l1TauMinPt") ?
+    pset.getParameter<double>("l1TauMinPt") : 0.;
   htxsSrc_ = consumes<HTXS::HiggsClassification>(edm::InputTag("rivetProducerHTXS","HiggsClassification"));
 
   //photonCoreSrcToken_ = consumes<edm::InputTag>(pset.getParameter<edm::InputTag>("photonCoreSrc"));
@@ -481,6 +485,11 @@ void PATFinalStateEventProducer::produce(edm::Event& evt,
                               pfRefProd, packedPFRefProd, trackRefProd, gsftrackRefProd, theMEts,
                               lheweights, geninfoweights, prefiringweights, npNLO, filterFlagsInfo); //FIXME 
 
+  // Resolve all MET shifts once, instead of once per MET column per row
+  theEvent.buildMETVariants();
+  theEvent.buildMVAMETIndex();
+  theEvent.buildL1Taus(l1TauMinPt_);
+
   std::vector<std::string> extras = extraWeights_.getParameterNames();
   for (size_t i = 0; i < extras.size(); ++i) {
     if (extraWeights_.existsAs<double>(extras[i])) {
@@ -46,7 +46,8 @@ void PATFinalStateFloatEmbedder::produce(edm::Event& evt, const edm::EventSetup&
   evt.getByLabel(toEmbedSrc_, toEmbedH);
 
   for (size_t i = 0; i < finalStatesH->size(); ++i) {
-    PATFinalState* embedInto = finalStatesH->ptrAt(i)->clone();
+    PATFinalState* embedInto = PATFinalState::addLayer(
+        finalStatesH->ptrAt(i));
     embedInto->addUserFloat(name_, *toEmbedH);
     output->push_back(embedInto); // takes ownership
   }
@@ -58,7 +58,8 @@ void PATFinalStateOverlapEmbedder::produce(edm::Event& evt, const edm::EventSetu
   evt.getByToken(toEmbedSrcToken_, toEmbedH);
 
   for (size_t i = 0; i < finalStatesH->size(); ++i) {
-    PATFinalState* embedInto = finalStatesH->ptrAt(i)->clone();
+    PATFinalState* embedInto = PATFinalState::addLayer(
+        finalStatesH->ptrAt(i));
     reco::CandidatePtrVector overlaps;
     for (size_t j = 0; j < toEmbedH->size(); ++j) {
       const reco::CandidatePtr toTest = toEmbedH->ptrAt(j);
@@ -4,6 +4,7 @@
  * This combinatoric approach is good for searches, but not for SMP
  * Incorporating a "rankByPt" variable that gives the position of the object in the collection, by Pt
  * Could be refined, and some care has to be taken if cuts are applied to the collection before being handled in the ntuple
+ * The ranking expression(s) can be changed with "rankBy" and the name of the userFloat with "label".
  *
  * Author: M.C., UW Madison
  *
@@ -17,6 +18,7 @@
 #include <vector>
 #include <string>
 #include "DataFormats/Candidate/interface/Candidate.h"
+#include "FinalStateAnalysis/Utilities/interface/StringObjectSorter.h"
 
 template<typename T>
 class PATRankEmbedder : public edm::EDProducer {
@@ -26,15 +28,21 @@ class PATRankEmbedder : public edm::EDProducer {
 
     void produce(edm::Event& evt, const edm::EventSetup& es);
 
-    inline bool ptComparator(const reco::Candidate* a , const reco::Candidate* b) {return a->pt() > b->pt(); }
- 
     PATRankEmbedder(const edm::ParameterSet& pset) :
-    src_ (consumes<edm::View<T> >(pset.getParameter<edm::InputTag>("src"))){
+    src_ (consumes<edm::View<T> >(pset.getParameter<edm::InputTag>("src"))),
+    sorter_(pset.exists("rankBy") ?
+            pset.getParameter<std::vector<std::string> >("rankBy") :
+            std::vector<std::string>(1, "pt")),
+    label_(pset.exists("label") ?
+           pset.getParameter<std::string>("label") :
+           std::string("rankByPt")) {
       produces< TCollection >();
     }
 
   private:
      edm::EDGetTokenT<edm::View<T> > src_;
+     StringObjectSorter<T> sorter_;
+     std::string label_;
 
 };
 
@@ -46,13 +54,21 @@ void PATRankEmbedder< T>::produce(edm::Event& evt, const edm::EventSetup& es) {
   evt.getByToken(src_, candidates);
   output->reserve(candidates->size());
 
+  // Each ranking expression is evaluated once per object; the sort is
+  // stable, so an already ordered collection keeps rank == index
+  std::vector<const T*> objects;
+  objects.reserve(candidates->size());
+  for (size_t i = 0; i < candidates->size(); i++)
+    objects.push_back(&candidates->at(i));
+  std::vector<size_t> order = sorter_.order(objects);
+  std::vector<float> rank(order.size());
+  for (size_t r = 0; r < order.size(); r++)
+    rank[order[r]] = float(r);
 
   for (size_t i = 0; i < candidates->size(); i++) {
-    T embedInto = *(candidates->ptrAt(i));
-    embedInto.addUserFloat("rankByPt",float(i));
-    output->push_back(embedInto); // takes ownership
+    output->push_back(candidates->at(i));
+    output->back().addUserFloat(label_, rank[i]);
   }
   evt.put(std::move(output));
 
 }
-
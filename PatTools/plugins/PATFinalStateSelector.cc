@@ -3,6 +3,11 @@
 //   PATFinalStateSelector.cc                                               //
 //                                                                          //
 //   Removes PATFinalStates from the collection if they fail string cuts.   //
+//   Each cut is evaluated on the whole collection at once.                 //
+//                                                                          //
+//   With asPtrs = True, the passing final states are not copied: the      //
+//       output is an edm::PtrVector into the input collection, which      //
+//       downstream modules read through edm::View<PATFinalState>.         //
 //                                                                          //
 //   Author: Nate Woods, U. Wisconsin                                       //
 //                                                                          //
@@ -18,9 +23,9 @@
 #include "FWCore/Framework/interface/EDProducer.h"
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
-#include "CommonTools/Utils/interface/StringCutObjectSelector.h"
 
 // FSA includes
+#include "FinalStateAnalysis/Utilities/interface/FastObjectFunction.h"
 #include "FinalStateAnalysis/DataFormats/interface/PATFinalState.h"
 #include "FinalStateAnalysis/DataFormats/interface/PATFinalStateFwd.h"
 
@@ -39,14 +44,23 @@ class PATFinalStateSelector : public edm::EDProducer {
   edm::EDGetTokenT<edm::View<PATFinalState> > srcToken_;
 
   // List of selectors
-  std::vector<StringCutObjectSelector<PATFinalState> > cuts_;
+  std::vector<ek::FastCutObjectSelector<PATFinalState> > cuts_;
+
+  // Put a PtrVector to the passing final states instead of copies
+  bool asPtrs_;
+
+  // Result of all the cuts for each final state
+  void passes(const std::vector<const PATFinalState*>& finalStates,
+              std::vector<bool>& pass) const;
 };
 
 
 PATFinalStateSelector::PATFinalStateSelector(const edm::ParameterSet& iConfig) :
   srcToken_(consumes<edm::View<PATFinalState> >(iConfig.exists("src") ?
        iConfig.getParameter<edm::InputTag>("src") :
-       edm::InputTag("finalStateeeee")))
+       edm::InputTag("finalStateeeee"))),
+  asPtrs_(iConfig.exists("asPtrs") ?
+          iConfig.getParameter<bool>("asPtrs") : false)
 {
   const std::vector<std::string> cutStrings = (iConfig.exists("cuts") ?
                                                iConfig.getParameter<std::vector<std::string> >("cuts") :
@@ -54,40 +68,80 @@ PATFinalStateSelector::PATFinalStateSelector(const edm::ParameterSet& iConfig) :
 
   for(auto iCut = cutStrings.begin(); iCut != cutStrings.end(); ++iCut)
     {
-      cuts_.push_back(StringCutObjectSelector<PATFinalState>(*iCut));
+      cuts_.push_back(ek::FastCutObjectSelector<PATFinalState>(*iCut));
     }
 
-  produces<PATFinalStateCollection>();
+  if(asPtrs_)
+    produces<PATFinalStatePtrVector>();
+  else
+    produces<PATFinalStateCollection>();
 }
 
 
 void PATFinalStateSelector::produce(edm::Event& iEvent, const edm::EventSetup& iSetup) 
 {
-  std::unique_ptr<PATFinalStateCollection> output(new PATFinalStateCollection);
-
   edm::Handle<edm::View<PATFinalState> > finalStatesIn;
   iEvent.getByToken(srcToken_, finalStatesIn);
 
-  for (size_t iFS = 0; iFS < finalStatesIn->size(); ++iFS) 
+  // Cuts are evaluated on the input, only passing final states are copied
+  std::vector<const PATFinalState*> finalStates;
+  finalStates.reserve(finalStatesIn->size());
+  for (size_t iFS = 0; iFS < finalStatesIn->size(); ++iFS)
+    finalStates.push_back(&finalStatesIn->at(iFS));
+  std::vector<bool> pass;
+  passes(finalStates, pass);
+
+  if(asPtrs_)
     {
-      PATFinalState* fs = finalStatesIn->ptrAt(iFS)->clone();
-      bool pass = true;
-      for(auto iCut = cuts_.begin(); iCut != cuts_.end(); ++iCut)
-	{
-          if(!(*iCut)(*fs))
-            {
-              pass = false;
-              break;
-            }
-	}
+      std::unique_ptr<PATFinalStatePtrVector> output(new PATFinalStatePtrVector);
+      for (size_t iFS = 0; iFS < finalStatesIn->size(); ++iFS)
+        {
+          if(pass[iFS])
+            output->push_back(finalStatesIn->ptrAt(iFS));
+        }
+      iEvent.put(std::move(output));
+      return;
+    }
 
-      if(pass)
-        output->push_back(fs); // takes ownership
+  std::unique_ptr<PATFinalStateCollection> output(new PATFinalStateCollection);
+  for (size_t iFS = 0; iFS < finalStatesIn->size(); ++iFS) 
+    {
+      if(pass[iFS])
+        output->push_back(finalStatesIn->at(iFS).clone()); // takes ownership
     }
 
   iEvent.put(std::move(output));
 }
 
+void PATFinalStateSelector::passes(const std::vector<const PATFinalState*>& finalStates,
+                                   std::vector<bool>& pass) const
+{
+  pass.assign(finalStates.size(), true);
+  // Each cut only sees the final states which passed the previous ones
+  std::vector<const PATFinalState*> alive(finalStates);
+  std::vector<size_t> aliveIndex(finalStates.size());
+  for (size_t iFS = 0; iFS < aliveIndex.size(); ++iFS)
+    aliveIndex[iFS] = iFS;
+  std::vector<bool> cutPass;
+  for(auto iCut = cuts_.begin(); iCut != cuts_.end() && !alive.empty(); ++iCut)
+    {
+      iCut->select(alive, cutPass);
+      size_t nAlive = 0;
+      for (size_t i = 0; i < alive.size(); ++i)
+        {
+          if(cutPass[i])
+            {
+              alive[nAlive] = alive[i];
+              aliveIndex[nAlive++] = aliveIndex[i];
+            }
+          else
+            pass[aliveIndex[i]] = false;
+        }
+      alive.resize(nAlive);
+      aliveIndex.resize(nAlive);
+    }
+}
+
 void PATFinalStateSelector::beginJob(){}
 void PATFinalStateSelector::endJob(){}
 
@@ -55,43 +55,52 @@ class PATFinalStateVertexFitter : public edm::EDProducer {
 PATFinalStateVertexFitter::PATFinalStateVertexFitter(const edm::ParameterSet& pset) {
   srcToken_ = consumes<edm::View<PATFinalState> >(pset.getParameter<edm::InputTag>("src"));
   enable_ = pset.getParameter<bool>("enable");
-  produces<PATFinalStateCollection>();
+  // If disabled there is nothing to embed, so just point to the input
+  if (enable_)
+    produces<PATFinalStateCollection>();
+  else
+    produces<PATFinalStatePtrVector>();
 }
 void PATFinalStateVertexFitter::produce(edm::Event& evt, const edm::EventSetup& es) {
-  std::unique_ptr<PATFinalStateCollection> output(new PATFinalStateCollection);
-
   edm::Handle<edm::View<PATFinalState> > finalStates;
   evt.getByToken(srcToken_, finalStates);
 
-  edm::ESHandle<TransientTrackBuilder> trackBuilderHandle;
-  if (enable_) {
-    es.get<TransientTrackRecord>().get("TransientTrackBuilder", trackBuilderHandle);
+  if (!enable_) {
+    std::unique_ptr<PATFinalStatePtrVector> output(new PATFinalStatePtrVector);
+    for (size_t i = 0; i < finalStates->size(); ++i) {
+      output->push_back(finalStates->ptrAt(i));
+    }
+    evt.put(std::move(output));
+    return;
   }
 
+  std::unique_ptr<PATFinalStateCollection> output(new PATFinalStateCollection);
+
+  edm::ESHandle<TransientTrackBuilder> trackBuilderHandle;
+  es.get<TransientTrackRecord>().get("TransientTrackBuilder", trackBuilderHandle);
+
   for (size_t i = 0; i < finalStates->size(); ++i) {
-    PATFinalState * clone = finalStates->at(i).clone();
-    assert(clone);
-    if (enable_) {
-      std::vector<reco::TransientTrack> tracks;
-      for (size_t d = 0; d < clone->numberOfDaughters(); ++d) {
-	reco::TransientTrack transtrack = getTracks(clone->daughter(d),
-	      trackBuilderHandle.product());
-	if (transtrack.isValid())
-	  tracks.push_back(transtrack);
-      }
-      double vtxChi2 = -1;
-      double vtxNDOF = -1;
-      // Make sure all legs have a track
-      if (tracks.size() >= clone->numberOfDaughters()) {
-	KalmanVertexFitter kvf(true);
-	TransientVertex vtx = kvf.vertex(tracks);
-	vtxChi2 = vtx.totalChiSquared();
-	vtxNDOF = vtx.degreesOfFreedom();
-      }
-      clone->addUserFloat("vtxChi2", vtxChi2);
-      clone->addUserFloat("vtxNDOF", vtxNDOF);
+    const PATFinalState& finalState = finalStates->at(i);
+    std::vector<reco::TransientTrack> tracks;
+    for (size_t d = 0; d < finalState.numberOfDaughters(); ++d) {
+      reco::TransientTrack transtrack = getTracks(finalState.daughter(d),
+	    trackBuilderHandle.product());
+      if (transtrack.isValid())
+	tracks.push_back(transtrack);
+    }
+    double vtxChi2 = -1;
+    double vtxNDOF = -1;
+    // Make sure all legs have a track
+    if (tracks.size() >= finalState.numberOfDaughters()) {
+      KalmanVertexFitter kvf(true);
+      TransientVertex vtx = kvf.vertex(tracks);
+      vtxChi2 = vtx.totalChiSquared();
+      vtxNDOF = vtx.degreesOfFreedom();
     }
-    output->push_back(clone);
+    PATFinalState * layer = PATFinalState::addLayer(finalStates->ptrAt(i));
+    layer->addUserFloat("vtxChi2", vtxChi2);
+    layer->addUserFloat("vtxNDOF", vtxNDOF);
+    output->push_back(layer);
   }
   evt.put(std::move(output));
 }
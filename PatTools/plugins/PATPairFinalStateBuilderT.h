@@ -4,7 +4,8 @@
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 #include "FWCore/Framework/interface/EDProducer.h"
 
-#include "CommonTools/Utils/interface/StringCutObjectSelector.h"
+#include "FinalStateAnalysis/Utilities/interface/FastObjectFunction.h"
+#include "FinalStateAnalysis/PatTools/interface/FinalStateLegUniqueness.h"
 #include "FinalStateAnalysis/DataFormats/interface/PATFinalState.h"
 #include "FinalStateAnalysis/DataFormats/interface/PATFinalStateEvent.h"
 #include "FinalStateAnalysis/DataFormats/interface/PATPairFinalStateT.h"
@@ -21,13 +22,20 @@ class PATPairFinalStateBuilderT : public edm::EDProducer {
     edm::EDGetTokenT<edm::View<typename FinalStatePair::daughter1_type> > leg1SrcToken_;
     edm::EDGetTokenT<edm::View<typename FinalStatePair::daughter2_type> > leg2SrcToken_;
     edm::EDGetTokenT<edm::View<PATFinalStateEvent> > evtSrcToken_;
-    StringCutObjectSelector<PATFinalState> cut_;
+    ek::FastCutObjectSelector<PATFinalState> cut_;
+    // userCand p4s to copy into the leg snapshot
+    std::vector<std::string> snapshotUserCands_;
+    const FinalStateLegUniqueness uniqueness_;
 };
 
 template<class FinalStatePair>
 PATPairFinalStateBuilderT<FinalStatePair>::PATPairFinalStateBuilderT(
     const edm::ParameterSet& pset):
-  cut_(pset.getParameter<std::string>("cut"), true) {
+  cut_(pset.getParameter<std::string>("cut"), true),
+  uniqueness_(pset, 2) {
+  if (pset.exists("snapshotUserCands"))
+    snapshotUserCands_ = pset.getParameter<std::vector<std::string> >(
+        "snapshotUserCands");
   leg1SrcToken_ = consumes<edm::View<typename FinalStatePair::daughter1_type> >(pset.getParameter<edm::InputTag>("leg1Src"));
   leg2SrcToken_ = consumes<edm::View<typename FinalStatePair::daughter2_type> >(pset.getParameter<edm::InputTag>("leg2Src"));
   evtSrcToken_  = consumes<edm::View<PATFinalStateEvent> >(pset.getParameter<edm::InputTag>("evtSrc"));
@@ -62,9 +70,19 @@ PATPairFinalStateBuilderT<FinalStatePair>::produce(
       if (reco::CandidatePtr(leg1) == reco::CandidatePtr(leg2))
         continue;
 
+      // Skip permutations of identical legs, if requested
+      if (uniqueness_.enabled()) {
+        FinalStateLegUniqueness::Legs legs = {
+          reco::CandidatePtr(leg1), reco::CandidatePtr(leg2)};
+        if (!uniqueness_.ordered(legs))
+          continue;
+      }
+
       FinalStatePair outputCand(leg1, leg2, evtPtr);
-      if (cut_(outputCand))
+      if (cut_(outputCand)) {
         output->push_back(outputCand);
+        output->back().snapshotLegs(snapshotUserCands_);
+      }
     }
   }
   evt.put(std::move(output));
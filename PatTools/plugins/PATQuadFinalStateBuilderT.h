@@ -4,7 +4,8 @@
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 #include "FWCore/Framework/interface/EDProducer.h"
 
-#include "CommonTools/Utils/interface/StringCutObjectSelector.h"
+#include "FinalStateAnalysis/Utilities/interface/FastObjectFunction.h"
+#include "FinalStateAnalysis/PatTools/interface/FinalStateLegUniqueness.h"
 #include "FinalStateAnalysis/DataFormats/interface/PATFinalState.h"
 #include "FinalStateAnalysis/DataFormats/interface/PATFinalStateEvent.h"
 #include "FinalStateAnalysis/DataFormats/interface/PATQuadFinalStateT.h"
@@ -23,13 +24,20 @@ class PATQuadFinalStateBuilderT : public edm::EDProducer {
     edm::EDGetTokenT<edm::View<typename FinalState::daughter3_type> > leg3SrcToken_;
     edm::EDGetTokenT<edm::View<typename FinalState::daughter4_type> > leg4SrcToken_;
     edm::EDGetTokenT<edm::View<PATFinalStateEvent> > evtSrcToken_;
-    StringCutObjectSelector<PATFinalState> cut_;
+    ek::FastCutObjectSelector<PATFinalState> cut_;
+    // userCand p4s to copy into the leg snapshot
+    std::vector<std::string> snapshotUserCands_;
+    const FinalStateLegUniqueness uniqueness_;
 };
 
 template<class FinalState>
 PATQuadFinalStateBuilderT<FinalState>::PATQuadFinalStateBuilderT(
     const edm::ParameterSet& pset):
-  cut_(pset.getParameter<std::string>("cut"), true) {
+  cut_(pset.getParameter<std::string>("cut"), true),
+  uniqueness_(pset, 4) {
+  if (pset.exists("snapshotUserCands"))
+    snapshotUserCands_ = pset.getParameter<std::vector<std::string> >(
+        "snapshotUserCands");
   leg1SrcToken_ = consumes<edm::View<typename FinalState::daughter1_type> >(pset.getParameter<edm::InputTag>("leg1Src"));
   leg2SrcToken_ = consumes<edm::View<typename FinalState::daughter2_type> >(pset.getParameter<edm::InputTag>("leg2Src"));
   leg3SrcToken_ = consumes<edm::View<typename FinalState::daughter3_type> >(pset.getParameter<edm::InputTag>("leg3Src"));
@@ -95,9 +103,20 @@ PATQuadFinalStateBuilderT<FinalState>::produce(
           if (reco::CandidatePtr(leg3) == reco::CandidatePtr(leg4))
             continue;
 
+          // Skip permutations of identical legs, if requested
+          if (uniqueness_.enabled()) {
+            FinalStateLegUniqueness::Legs legs = {
+              reco::CandidatePtr(leg1), reco::CandidatePtr(leg2),
+              reco::CandidatePtr(leg3), reco::CandidatePtr(leg4)};
+            if (!uniqueness_.ordered(legs))
+              continue;
+          }
+
           FinalState outputCand(leg1, leg2, leg3, leg4, evtPtr);
-          if (cut_(outputCand))
+          if (cut_(outputCand)) {
             output->push_back(outputCand);
+            output->back().snapshotLegs(snapshotUserCands_);
+          }
         }
       }
     }
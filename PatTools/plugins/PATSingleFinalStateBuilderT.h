@@ -4,7 +4,7 @@
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 #include "FWCore/Framework/interface/EDProducer.h"
 
-#include "CommonTools/Utils/interface/StringCutObjectSelector.h"
+#include "FinalStateAnalysis/Utilities/interface/FastObjectFunction.h"
 #include "FinalStateAnalysis/DataFormats/interface/PATFinalState.h"
 #include "FinalStateAnalysis/DataFormats/interface/PATFinalStateEvent.h"
 #include "FinalStateAnalysis/DataFormats/interface/PATSingleFinalStateT.h"
@@ -20,13 +20,18 @@ class PATSingleFinalStateBuilderT : public edm::EDProducer {
   private:
     edm::EDGetTokenT<edm::View<typename FinalStateSingle::daughter1_type> > leg1SrcToken_;
     edm::EDGetTokenT<edm::View<PATFinalStateEvent> > evtSrcToken_;
-    StringCutObjectSelector<PATFinalState> cut_;
+    ek::FastCutObjectSelector<PATFinalState> cut_;
+    // userCand p4s to copy into the leg snapshot
+    std::vector<std::string> snapshotUserCands_;
 };
 
 template<class FinalStateSingle>
 PATSingleFinalStateBuilderT<FinalStateSingle>::PATSingleFinalStateBuilderT(
     const edm::ParameterSet& pset):
   cut_(pset.getParameter<std::string>("cut"), true) {
+  if (pset.exists("snapshotUserCands"))
+    snapshotUserCands_ = pset.getParameter<std::vector<std::string> >(
+        "snapshotUserCands");
   leg1SrcToken_ = consumes<edm::View<typename FinalStateSingle::daughter1_type> >(pset.getParameter<edm::InputTag>("leg1Src"));
   evtSrcToken_  = consumes<edm::View<PATFinalStateEvent> >(pset.getParameter<edm::InputTag>("evtSrc"));
   produces<FinalStateSingleCollection>();
@@ -50,8 +55,10 @@ PATSingleFinalStateBuilderT<FinalStateSingle>::produce(
     edm::Ptr<typename FinalStateSingle::daughter1_type> leg1 = leg1s->ptrAt(iLeg1);
     assert(leg1.isNonnull());
     FinalStateSingle outputCand(leg1, evtPtr);
-    if (cut_(outputCand))
+    if (cut_(outputCand)) {
       output->push_back(outputCand);
+      output->back().snapshotLegs(snapshotUserCands_);
+    }
     }
   evt.put(std::move(output));
 }
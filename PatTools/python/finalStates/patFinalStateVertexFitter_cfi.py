@@ -3,6 +3,7 @@ import FWCore.ParameterSet.Config as cms
 patFinalStateVertexFitter = cms.EDProducer(
     "PATFinalStateVertexFitter",
     src = cms.InputTag("fixme"),
-    # If disabled, do nothing.  Allows to run even without tracks.
+    # If disabled, do nothing (the final states are passed on without being
+    # copied).  Allows to run even without tracks.
     enable = cms.bool(True),
 )
@@ -230,6 +230,10 @@ def produce_final_states(process, daughter_collections, output_commands,
 
     crossCleaning = kwargs.get('crossCleaning','smallestDeltaR() > 0.3')
 
+    # Only build the permutations of identical legs that survive the ntuple
+    # uniqueness cuts.  Don't use if the final states are kept without them.
+    uniqueLegs = kwargs.get('uniqueLegs', False)
+
 
     builderSeqs = {}
 
@@ -257,6 +261,16 @@ def produce_final_states(process, daughter_collections, output_commands,
         for i in range(nObj):
             setattr(producer, 'leg{}Src'.format(i+1),
                     object_types[channel[i]])
+        # The HZZ uniqueness cuts add the FSR photons to the legs
+        if hzz:
+            producer.snapshotUserCands = cms.vstring('dretFSRCand')
+        if uniqueLegs:
+            from FinalStateAnalysis.NtupleTools.uniqueness_cut_generator \
+                import pt_ordered_legs
+            pairs = pt_ordered_legs(channel,
+                                    dblH=kwargs.get('dblhMode', False))
+            producer.ptOrderedLegs = cms.vuint32(
+                *[i for pair in pairs for i in pair])
         producer_name = "finalState{0}{1}".format(producerSuffix,postfix)
         setattr(process, producer_name + "Raw", producer)
         builderSeqs[nObj] += producer
@@ -266,8 +280,10 @@ def produce_final_states(process, daughter_collections, output_commands,
         builderSeqs[nObj] += embedder_seq
         # Do some trickery so the final module has a nice output name
         final_module_name = chain_sequence(embedder_seq, producer_name + "Raw")
+        # (points to the embedded final states rather than copying them)
         final_module = cms.EDProducer(
-            "PATFinalStateCopier", src=final_module_name)
+            "PATFinalStateCopier", src=final_module_name,
+            asPtrs=cms.bool(True))
         setattr(process, producer_name, final_module)
         builderSeqs[nObj] += final_module
 
@@ -0,0 +1,29 @@
+#include "FinalStateAnalysis/PatTools/interface/FinalStateLegUniqueness.h"
+
+#include "DataFormats/Candidate/interface/Candidate.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/Utilities/interface/Exception.h"
+
+FinalStateLegUniqueness::FinalStateLegUniqueness(
+    const edm::ParameterSet& pset, size_t nLegs) {
+  std::vector<unsigned int> ptOrdered = pset.exists("ptOrderedLegs") ?
+    pset.getParameter<std::vector<unsigned int> >("ptOrderedLegs") :
+    std::vector<unsigned int>();
+  if (ptOrdered.size() % 2)
+    throw cms::Exception("FinalStateLegUniqueness") << "ptOrderedLegs must"
+      << " be a list of index pairs!\n";
+  for (size_t i = 0; i < ptOrdered.size(); i += 2) {
+    if (ptOrdered[i] >= nLegs || ptOrdered[i+1] >= nLegs)
+      throw cms::Exception("FinalStateLegUniqueness") << "ptOrderedLegs"
+        << " index out of range for " << nLegs << " legs!\n";
+    ptOrdered_.push_back(std::make_pair(ptOrdered[i], ptOrdered[i+1]));
+  }
+}
+
+bool FinalStateLegUniqueness::ordered(const Legs& legs) const {
+  for (size_t i = 0; i < ptOrdered_.size(); ++i) {
+    if (!(legs[ptOrdered_[i].first]->pt() > legs[ptOrdered_[i].second]->pt()))
+      return false;
+  }
+  return true;
+}
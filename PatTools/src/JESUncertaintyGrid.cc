@@ -0,0 +1,181 @@
+#include "FinalStateAnalysis/PatTools/interface/JESUncertaintyGrid.h"
+
+#include "CondFormats/JetMETObjects/interface/JetCorrectorParameters.h"
+#include "FWCore/Utilities/interface/Exception.h"
+
+#include <boost/functional/hash.hpp>
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+
+namespace pattools {
+
+  JESUncertaintyGrid::JESUncertaintyGrid(const std::string& fileName,
+      const std::vector<std::string>& sourceNames):
+    _names(sourceNames) {
+
+    size_t hash = boost::hash_value(fileName);
+    boost::hash_combine(hash, sourceNames);
+    _fingerprint = int(hash);
+
+    for (auto const& name : sourceNames) {
+      JetCorrectorParameters params(fileName, name);
+      const JetCorrectorParameters::Definitions& defs = params.definitions();
+
+      if (defs.nBinVar() != 1 || defs.binVar(0) != "JetEta" ||
+          defs.nParVar() != 1 || defs.parVar(0) != "JetPt")
+        throw cms::Exception("JESUncertaintyGrid") << "source " << name
+                                                   << " in " << fileName
+                                                   << " is not binned in"
+                                                   << " JetEta with JetPt"
+                                                   << " points!\n";
+
+      source_info source;
+      source.offsets.push_back(0);
+      for (unsigned iBin = 0; iBin < params.size(); ++iBin) {
+        const JetCorrectorParameters::Record& record = params.record(iBin);
+        const std::vector<float>& p = record.parameters();
+        if (p.size() == 0 || (p.size() % 3) != 0)
+          throw cms::Exception("JESUncertaintyGrid") << "source " << name
+                                                     << " has a bad number"
+                                                     << " of parameters: "
+                                                     << p.size() << "\n";
+        // The bins have to tile eta in increasing order for the lookup
+        if (iBin == 0)
+          source.eta_edges.push_back(record.xMin(0));
+        else if (record.xMin(0) != source.eta_edges.back())
+          throw cms::Exception("JESUncertaintyGrid") << "source " << name
+                                                     << " has eta bins that"
+                                                     << " are not contiguous!\n";
+        source.eta_edges.push_back(record.xMax(0));
+
+        for (size_t k = 0; k < p.size(); k += 3) {
+          source.pt.push_back(p[k]);
+          source.up.push_back(p[k+1]);
+          source.down.push_back(p[k+2]);
+        }
+        source.offsets.push_back(source.pt.size());
+      }
+      _sources.push_back(source);
+    }
+  }
+
+  std::shared_ptr<const JESUncertaintyGrid> JESUncertaintyGrid::get(
+      const std::string& fileName,
+      const std::vector<std::string>& sourceNames) {
+    typedef std::pair<std::string, std::vector<std::string> > key_type;
+    static std::mutex registryMutex;
+    static std::map<key_type, std::weak_ptr<const JESUncertaintyGrid> > registry;
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    std::weak_ptr<const JESUncertaintyGrid>& entry =
+      registry[key_type(fileName, sourceNames)];
+    std::shared_ptr<const JESUncertaintyGrid> grid = entry.lock();
+    if (!grid) {
+      grid = std::make_shared<const JESUncertaintyGrid>(fileName, sourceNames);
+      entry = grid;
+    }
+    return grid;
+  }
+
+  std::vector<std::string> JESUncertaintyGrid::regroupedSources(
+      const std::string& fileName) {
+    std::string year;
+    if (fileName.find("Summer16") != std::string::npos)
+      year = "2016";
+    else if (fileName.find("Fall17") != std::string::npos)
+      year = "2017";
+    else if (fileName.find("Autumn18") != std::string::npos)
+      year = "2018";
+
+    // Absoluteyear -> Absolute_2016, RelativeSample -> RelativeSample_2016
+    std::vector<std::string> sources = regroupedLabels();
+    if (!year.empty()) {
+      for (auto& source : sources) {
+        size_t pos = source.rfind("year");
+        if (pos != std::string::npos && pos + 4 == source.size())
+          source.replace(pos, 4, "_" + year);
+        else if (source == "RelativeSample")
+          source += "_" + year;
+      }
+    }
+    return sources;
+  }
+
+  const std::vector<std::string>& JESUncertaintyGrid::regroupedLabels() {
+    static const std::vector<std::string> labels = {
+      "Absolute",
+      "Absoluteyear",
+      "BBEC1",
+      "BBEC1year",
+      "EC2",
+      "EC2year",
+      "FlavorQCD",
+      "HF",
+      "HFyear",
+      "RelativeBal",
+      "RelativeSample",
+      "Total"
+    };
+    return labels;
+  }
+
+  float JESUncertaintyGrid::lookup(const source_info& source, float eta,
+                                   float pt, bool up) const {
+    const std::vector<float>& edges = source.eta_edges;
+    if (edges.empty() || eta < edges.front() || eta >= edges.back())
+      return -999.0;
+    size_t bin = std::upper_bound(edges.begin(), edges.end(), eta)
+      - edges.begin() - 1;
+
+    const size_t first = source.offsets[bin];
+    const size_t last = source.offsets[bin+1] - 1;
+    const std::vector<float>& value = up ? source.up : source.down;
+
+    if (pt <= source.pt[first])
+      return value[first];
+    if (pt >= source.pt[last])
+      return value[last];
+
+    // First point with pt strictly above, the one before it brackets pt
+    size_t i = std::upper_bound(source.pt.begin() + first,
+                                source.pt.begin() + last + 1, pt)
+      - source.pt.begin() - 1;
+
+    // Same interpolation as SimpleJetCorrectionUncertainty
+    const float x0 = source.pt[i], x1 = source.pt[i+1];
+    const float y0 = value[i], y1 = value[i+1];
+    if (x0 == x1)
+      return y0;
+    float a = (y1 - y0) / (x1 - x0);
+    float b = (y0*x1 - y1*x0) / (x1 - x0);
+    return a*pt + b;
+  }
+
+  float JESUncertaintyGrid::uncertainty(size_t iSource, float eta, float pt,
+                                        bool up) const {
+    return lookup(_sources[iSource], eta, pt, up);
+  }
+
+  void JESUncertaintyGrid::uncertainties(float eta, float pt,
+                                         std::vector<float>& out,
+                                         bool up) const {
+    out.resize(_sources.size());
+    for (size_t k = 0; k < _sources.size(); ++k)
+      out[k] = lookup(_sources[k], eta, pt, up);
+  }
+
+  void JESUncertaintyGrid::uncertainties(const std::vector<float>& etas,
+                                         const std::vector<float>& pts,
+                                         std::vector<float>& out,
+                                         bool up) const {
+    const size_t nJets = std::min(etas.size(), pts.size());
+    out.resize(_sources.size() * nJets);
+    for (size_t k = 0; k < _sources.size(); ++k) {
+      const source_info& source = _sources[k];
+      for (size_t j = 0; j < nJets; ++j)
+        out[k*nJets + j] = lookup(source, etas[j], pts[j], up);
+    }
+  }
+}
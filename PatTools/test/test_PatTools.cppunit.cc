@@ -0,0 +1,294 @@
+/*
+ * Test the PatTools helpers
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <Utilities/Testing/interface/CppUnit_testdriver.icpp>
+#include <vector>
+
+#include "FinalStateAnalysis/PatTools/interface/FinalStateLegUniqueness.h"
+#include "FinalStateAnalysis/PatTools/interface/JESUncertaintyGrid.h"
+
+#include "CondFormats/JetMETObjects/interface/JetCorrectorParameters.h"
+#include "CondFormats/JetMETObjects/interface/JetCorrectionUncertainty.h"
+#include "DataFormats/Candidate/interface/LeafCandidate.h"
+#include "DataFormats/Common/interface/TestHandle.h"
+#include "DataFormats/Math/interface/LorentzVector.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/Utilities/interface/Exception.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+namespace {
+
+// Two sources with different eta binning, one of them with a repeated pt
+// point.  Written out as a Summer16 uncertainty source file.
+const char* jesSourceFile = "test_PatTools_Summer16_UncertaintySources.txt";
+
+void writeSourceFile() {
+  std::ofstream file(jesSourceFile);
+  file << "[Absolute]\n"
+       << "{1 JetEta 1 JetPt \"\" Correction JECSource}\n"
+       << "-5.4 -2.5 9 10 0.05 0.06 50 0.03 0.04 500 0.01 0.02\n"
+       << "-2.5 0.0 12 10 0.04 0.05 30 0.02 0.03 100 0.015 0.025"
+       << " 1000 0.01 0.01\n"
+       << "0.0 2.5 12 10 0.045 0.05 30 0.025 0.03 100 0.02 0.02"
+       << " 1000 0.008 0.012\n"
+       << "2.5 5.4 9 10 0.055 0.06 50 0.035 0.04 500 0.015 0.02\n"
+       << "[HF_2016]\n"
+       << "{1 JetEta 1 JetPt \"\" Correction JECSource}\n"
+       << "-4.7 -3.0 9 15 0.1 0.12 40 0.05 0.05 40 0.04 0.04\n"
+       << "-3.0 3.0 6 15 0.0 0.0 2000 0.0 0.0\n"
+       << "3.0 4.7 9 15 0.11 0.12 40 0.06 0.05 40 0.04 0.04\n";
+}
+
+float reference(const std::string& source, float eta, float pt, bool up) {
+  JetCorrectionUncertainty uncertainty(
+      JetCorrectorParameters(jesSourceFile, source));
+  uncertainty.setJetEta(eta);
+  uncertainty.setJetPt(pt);
+  return uncertainty.getUncertainty(up);
+}
+
+// Candidates with the given pts, as CandidatePtrs into [coll]
+std::vector<reco::CandidatePtr> makeLegs(
+    std::vector<reco::LeafCandidate>& coll, const std::vector<double>& pts,
+    unsigned int productIndex) {
+  for (double pt : pts)
+    coll.push_back(reco::LeafCandidate(0, reco::Candidate::LorentzVector(
+            math::PtEtaPhiMLorentzVector(pt, 0.5, 1., 0))));
+  edm::TestHandle<std::vector<reco::LeafCandidate> > handle(&coll,
+      edm::ProductID(1, productIndex));
+  std::vector<reco::CandidatePtr> legs;
+  for (size_t i = 0; i < coll.size(); ++i)
+    legs.push_back(edm::Ptr<reco::LeafCandidate>(handle, i));
+  return legs;
+}
+
+edm::ParameterSet uniquenessPSet(const std::vector<unsigned int>& pairs) {
+  edm::ParameterSet pset;
+  pset.addParameter<std::vector<unsigned int> >("ptOrderedLegs", pairs);
+  return pset;
+}
+
+// What the orderedInPt(i, j) uniqueness cuts of the ntuple keep
+bool orderedInPt(const FinalStateLegUniqueness::Legs& legs,
+    const std::vector<unsigned int>& pairs) {
+  for (size_t i = 0; i < pairs.size(); i += 2) {
+    if (!(legs[pairs[i]]->pt() > legs[pairs[i+1]]->pt()))
+      return false;
+  }
+  return true;
+}
+
+// Every combination the builder loops over: leg i from sources[i], the
+// same candidate never used twice
+void combinations(const std::vector<std::vector<reco::CandidatePtr> >& sources,
+    FinalStateLegUniqueness::Legs& current,
+    std::vector<FinalStateLegUniqueness::Legs>& out) {
+  if (current.size() == sources.size()) {
+    out.push_back(current);
+    return;
+  }
+  for (const reco::CandidatePtr& cand : sources[current.size()]) {
+    if (std::find(current.begin(), current.end(), cand) != current.end())
+      continue;
+    current.push_back(cand);
+    combinations(sources, current, out);
+    current.pop_back();
+  }
+}
+
+std::vector<FinalStateLegUniqueness::Legs> combinations(
+    const std::vector<std::vector<reco::CandidatePtr> >& sources) {
+  FinalStateLegUniqueness::Legs current;
+  std::vector<FinalStateLegUniqueness::Legs> out;
+  combinations(sources, current, out);
+  return out;
+}
+
+}
+
+class testPatTools: public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(testPatTools);
+  CPPUNIT_TEST(testJESUncertaintyGrid);
+  CPPUNIT_TEST(testJESUncertaintyGridSources);
+  CPPUNIT_TEST(testLegUniquenessSameFlavour);
+  CPPUNIT_TEST(testLegUniquenessMixedFlavour);
+  CPPUNIT_TEST(testLegUniquenessConfiguration);
+  CPPUNIT_TEST_SUITE_END();
+  public:
+    void setUp() { writeSourceFile(); }
+    void tearDown() { std::remove(jesSourceFile); }
+    void testJESUncertaintyGrid();
+    void testJESUncertaintyGridSources();
+    void testLegUniquenessSameFlavour();
+    void testLegUniquenessMixedFlavour();
+    void testLegUniquenessConfiguration();
+};
+
+void testPatTools::testJESUncertaintyGrid() {
+  const std::vector<std::string> sources = {"Absolute", "HF_2016"};
+  pattools::JESUncertaintyGrid grid(jesSourceFile, sources);
+  CPPUNIT_ASSERT_EQUAL(sources.size(), grid.size());
+
+  // Bin edges, either side of them, and outside the eta range of the
+  // sources; pt points, between them and beyond the ends.
+  const float etas[] = {-6.0, -5.4, -5.0, -4.7, -3.0, -2.5, -2.4999, -1.0,
+    0.0, 1.0, 2.5, 3.0, 4.69, 4.7, 5.3999, 5.4, 6.0};
+  const float pts[] = {0., 5., 10., 12.5, 15., 30., 40., 50., 75., 100.,
+    500., 700., 1000., 2000., 6500.};
+
+  std::vector<float> allEtas, allPts;
+  for (float eta : etas) {
+    for (float pt : pts) {
+      allEtas.push_back(eta);
+      allPts.push_back(pt);
+    }
+  }
+
+  for (bool up : {true, false}) {
+    std::vector<float> perJet;
+    std::vector<float> vectorized;
+    grid.uncertainties(allEtas, allPts, vectorized, up);
+    CPPUNIT_ASSERT_EQUAL(sources.size()*allEtas.size(), vectorized.size());
+
+    for (size_t j = 0; j < allEtas.size(); ++j) {
+      grid.uncertainties(allEtas[j], allPts[j], perJet, up);
+      CPPUNIT_ASSERT_EQUAL(sources.size(), perJet.size());
+      for (size_t k = 0; k < sources.size(); ++k) {
+        const float expected = reference(sources[k], allEtas[j], allPts[j],
+            up);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(expected,
+            grid.uncertainty(k, allEtas[j], allPts[j], up), 1e-6);
+        CPPUNIT_ASSERT_EQUAL(grid.uncertainty(k, allEtas[j], allPts[j], up),
+            perJet[k]);
+        CPPUNIT_ASSERT_EQUAL(perJet[k],
+            vectorized[k*allEtas.size() + j]);
+      }
+    }
+  }
+
+  // Out of the eta range of a source
+  CPPUNIT_ASSERT_EQUAL(-999.f, grid.uncertainty(0, 5.4, 50.));
+  CPPUNIT_ASSERT_EQUAL(-999.f, grid.uncertainty(1, -5.0, 50.));
+}
+
+void testPatTools::testJESUncertaintyGridSources() {
+  const std::vector<std::string>& labels =
+    pattools::JESUncertaintyGrid::regroupedLabels();
+  std::vector<std::string> sources =
+    pattools::JESUncertaintyGrid::regroupedSources(jesSourceFile);
+  CPPUNIT_ASSERT_EQUAL(labels.size(), sources.size());
+  CPPUNIT_ASSERT_EQUAL(std::string("Absolute"), sources[0]);
+  CPPUNIT_ASSERT_EQUAL(std::string("Absolute_2016"), sources[1]);
+  CPPUNIT_ASSERT_EQUAL(std::string("HF_2016"), sources[8]);
+  CPPUNIT_ASSERT_EQUAL(std::string("RelativeSample_2016"), sources[10]);
+  CPPUNIT_ASSERT_EQUAL(std::string("Total"), sources.back());
+  // Without a known year the labels are the sources
+  CPPUNIT_ASSERT(labels ==
+      pattools::JESUncertaintyGrid::regroupedSources("Uncertainties.txt"));
+
+  // One grid per file and sources
+  const std::vector<std::string> absolute = {"Absolute"};
+  const std::vector<std::string> both = {"Absolute", "HF_2016"};
+  auto grid = pattools::JESUncertaintyGrid::get(jesSourceFile, absolute);
+  CPPUNIT_ASSERT(grid == pattools::JESUncertaintyGrid::get(jesSourceFile,
+        absolute));
+  auto other = pattools::JESUncertaintyGrid::get(jesSourceFile, both);
+  CPPUNIT_ASSERT(grid != other);
+  CPPUNIT_ASSERT(grid->fingerprint() != other->fingerprint());
+  CPPUNIT_ASSERT_EQUAL(grid->fingerprint(),
+      pattools::JESUncertaintyGrid(jesSourceFile, absolute).fingerprint());
+}
+
+void testPatTools::testLegUniquenessSameFlavour() {
+  // Two of the electrons have the same pt
+  std::vector<reco::LeafCandidate> electronColl;
+  const std::vector<reco::CandidatePtr> electrons = makeLegs(electronColl,
+      {30., 20., 20., 45.}, 1);
+
+  // ee, eee and eeee (not dblH) as pt_ordered_legs lists them
+  const std::vector<std::vector<unsigned int> > orderings = {
+    {0, 1}, {0, 1}, {0, 1, 2, 3}};
+  for (size_t n = 2; n <= 4; ++n) {
+    const std::vector<unsigned int>& pairs = orderings[n-2];
+    const FinalStateLegUniqueness uniqueness(uniquenessPSet(pairs), n);
+    CPPUNIT_ASSERT(uniqueness.enabled());
+
+    const std::vector<FinalStateLegUniqueness::Legs> all = combinations(
+        std::vector<std::vector<reco::CandidatePtr> >(n, electrons));
+    size_t kept = 0;
+    for (const FinalStateLegUniqueness::Legs& legs : all) {
+      CPPUNIT_ASSERT_EQUAL(orderedInPt(legs, pairs), uniqueness.ordered(legs));
+      if (uniqueness.ordered(legs))
+        ++kept;
+    }
+    // Of each ordered pair only the leading first is kept, and a pair with
+    // tied pts is not kept at all, like orderedInPt does
+    const size_t expected[] = {0, 0, 5, 10, 4};
+    CPPUNIT_ASSERT_EQUAL(expected[n], kept);
+  }
+
+  // The ee permutations of the two tied electrons
+  const FinalStateLegUniqueness uniqueness(uniquenessPSet({0, 1}), 2);
+  CPPUNIT_ASSERT(!uniqueness.ordered({electrons[1], electrons[2]}));
+  CPPUNIT_ASSERT(!uniqueness.ordered({electrons[2], electrons[1]}));
+  CPPUNIT_ASSERT(uniqueness.ordered({electrons[0], electrons[1]}));
+  CPPUNIT_ASSERT(!uniqueness.ordered({electrons[1], electrons[0]}));
+}
+
+void testPatTools::testLegUniquenessMixedFlavour() {
+  std::vector<reco::LeafCandidate> electronColl, muonColl;
+  const std::vector<reco::CandidatePtr> electrons = makeLegs(electronColl,
+      {30., 20.}, 1);
+  const std::vector<reco::CandidatePtr> muons = makeLegs(muonColl,
+      {25., 40., 25.}, 2);
+
+  // emm: only the two muons are ordered, whatever the electron pt
+  const std::vector<unsigned int> pairs = {1, 2};
+  const FinalStateLegUniqueness uniqueness(uniquenessPSet(pairs), 3);
+  const std::vector<FinalStateLegUniqueness::Legs> all = combinations(
+      {electrons, muons, muons});
+  CPPUNIT_ASSERT_EQUAL(size_t(2*3*2), all.size());
+  size_t kept = 0;
+  for (const FinalStateLegUniqueness::Legs& legs : all) {
+    CPPUNIT_ASSERT_EQUAL(orderedInPt(legs, pairs), uniqueness.ordered(legs));
+    if (uniqueness.ordered(legs))
+      ++kept;
+  }
+  // (40, 25) twice for each electron, the tied muons never
+  CPPUNIT_ASSERT_EQUAL(size_t(4), kept);
+  CPPUNIT_ASSERT(uniqueness.ordered({electrons[1], muons[1], muons[0]}));
+  CPPUNIT_ASSERT(!uniqueness.ordered({electrons[0], muons[0], muons[2]}));
+
+  // em: nothing to order, every combination is built
+  const FinalStateLegUniqueness none(edm::ParameterSet(), 2);
+  CPPUNIT_ASSERT(!none.enabled());
+  for (const FinalStateLegUniqueness::Legs& legs :
+      combinations({electrons, muons}))
+    CPPUNIT_ASSERT(none.ordered(legs));
+}
+
+void testPatTools::testLegUniquenessConfiguration() {
+  bool thrown = false;
+  try {
+    FinalStateLegUniqueness uniqueness(uniquenessPSet({0, 1, 2}), 3);
+  } catch (const cms::Exception&) {
+    thrown = true;
+  }
+  CPPUNIT_ASSERT(thrown);
+
+  thrown = false;
+  try {
+    FinalStateLegUniqueness uniqueness(uniquenessPSet({0, 2}), 2);
+  } catch (const cms::Exception&) {
+    thrown = true;
+  }
+  CPPUNIT_ASSERT(thrown);
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(testPatTools);
@@ -0,0 +1,70 @@
+#ifndef FinalStateAnalysis_Utilities_BinnedExpressionHisto_h
+#define FinalStateAnalysis_Utilities_BinnedExpressionHisto_h
+
+/*
+ * BinnedExpressionHisto
+ *
+ * Drop-in replacement for ExpressionHisto (same configuration parameters)
+ * for uniformly binned 1D histograms.  Fills are buffered in a TH1Accumulator
+ * and only added to the TH1F when flush() is called.  The per-item
+ * histograms of ExpressionHisto (itemsToPlot) are not supported, asking for
+ * them is a configuration error.
+ *
+ * The expression is not owned by the histogram, so histograms of the same
+ * quantity can share one StringObjectFunction (see HistoFolder).
+ *
+ */
+
+#include <string>
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/Utilities/interface/Exception.h"
+#include "CommonTools/Utils/interface/TFileDirectory.h"
+#include "FinalStateAnalysis/Utilities/interface/TH1Accumulator.h"
+#include "TH1F.h"
+
+namespace ek {
+
+class BinnedExpressionHisto {
+  public:
+    BinnedExpressionHisto(const edm::ParameterSet& pset):
+      min_(pset.getUntrackedParameter<double>("min")),
+      max_(pset.getUntrackedParameter<double>("max")),
+      nbins_(pset.getUntrackedParameter<int>("nbins")),
+      name_(pset.getUntrackedParameter<std::string>("name")),
+      description_(pset.getUntrackedParameter<std::string>("description")),
+      expression_(pset.getUntrackedParameter<std::string>("plotquantity")),
+      lazy_(pset.getUntrackedParameter<bool>("lazyParsing", false)) {
+      if (pset.getUntrackedParameter<int>("itemsToPlot", -1) > 0) {
+        throw cms::Exception("Configuration")
+          << "The histogram " << name_ << " sets itemsToPlot, which"
+          << " HistoFolder doesn't support" << std::endl;
+      }
+    }
+
+    void initialize(TFileDirectory& fs) {
+      accumulator_ = TH1Accumulator(fs.make<TH1F>(
+            name_.c_str(), description_.c_str(), nbins_, min_, max_));
+    }
+
+    const std::string& expression() const { return expression_; }
+    bool lazy() const { return lazy_; }
+
+    void fill(double x, double weight) { accumulator_.fill(x, weight); }
+
+    // Add the accumulated fills to the histogram
+    void flush() { accumulator_.flush(); }
+
+  private:
+    double min_;
+    double max_;
+    int nbins_;
+    std::string name_;
+    std::string description_;
+    std::string expression_;
+    bool lazy_;
+    TH1Accumulator accumulator_;
+};
+
+}
+
+#endif /* end of include guard: FinalStateAnalysis_Utilities_BinnedExpressionHisto_h */
@@ -0,0 +1,66 @@
+#ifndef FinalStateAnalysis_Utilities_ColumnarNtupleWriter_h
+#define FinalStateAnalysis_Utilities_ColumnarNtupleWriter_h
+
+/*
+ * Columnar copy of the rows of a flat TTree, written as one NumPy .npy file
+ * per branch in a directory, so they can be memory mapped (numpy.load(...,
+ * mmap_mode='r')) without a conversion step.
+ *
+ * The branches are read from the tree's leaves at each fill(), so any tree
+ * of I, i, L, l, F and D leaves works.  Each column is buffered
+ * contiguously and appended to its file every [chunkRows] rows.  For
+ * variable length leaves (the event view ntuples) the file holds the
+ * values of all rows back to back, and the counter branch gives the number
+ * of values of each row.
+ *
+ * The files are complete once close() (or the destructor) has run.
+ *
+ */
+
+#include <boost/utility.hpp>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class TLeaf;
+class TTree;
+
+namespace ek {
+
+class ColumnarNtupleWriter : private boost::noncopyable {
+  public:
+    // Mirror the branches of [tree] into [directory], which is created
+    ColumnarNtupleWriter(TTree* tree, const std::string& directory,
+        size_t chunkRows);
+    ~ColumnarNtupleWriter();
+
+    // Append the current branch values
+    void fill();
+    // Write the buffered rows and the final .npy headers
+    void close();
+
+    size_t rows() const { return rows_; }
+
+  private:
+    struct Column {
+      TLeaf* leaf;
+      size_t width;
+      std::string descr;
+      std::string path;
+      std::FILE* file;
+      size_t values;
+      std::vector<char> buffer;
+    };
+
+    void flush();
+    static void writeHeader(Column& column);
+
+    std::vector<Column> columns_;
+    size_t chunkRows_;
+    size_t rows_;
+    bool closed_;
+};
+
+}
+
+#endif /* end of include guard: FinalStateAnalysis_Utilities_ColumnarNtupleWriter_h */
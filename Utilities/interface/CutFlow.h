@@ -5,7 +5,10 @@
  * Implements a wrapper around a TH1I which holds a cut flow.
  *
  * The cut flow is filled using the pat::strbitset objects produced by
- * Selector<T> modules.
+ * Selector<T> modules.  Fills are accumulated in flat arrays owned by this
+ * instance and only written to the histogram by flush(), which must be
+ * called before the histogram is saved.  The accessors include the pending
+ * fills, so the cut flow can be printed before or after flushing.
  *
  * Author: Evan K. Friis, UW Madison
  *
@@ -18,6 +21,7 @@
 #include <boost/utility.hpp>
 #include <vector>
 #include <string>
+#include "FinalStateAnalysis/Utilities/interface/TH1Accumulator.h"
 
 namespace pat {
   class strbitset;
@@ -44,6 +48,9 @@ class CutFlow : public boost::noncopyable {
     void fill(const CutSet& cuts, double w=1.0);
     void fill(const std::vector<const CutSet*>& cuts, double w=1.0);
 
+    // Write the accumulated fills into the histogram
+    void flush();
+
     const TH1F* cutFlow() const { return cutFlow_; }
 
     // Get information about the nth cut
@@ -65,6 +72,7 @@ class CutFlow : public boost::noncopyable {
 
     bool mustCleanupHistogram_;
     TH1F* cutFlow_;
+    TH1Accumulator pending_;
 };
 
 }
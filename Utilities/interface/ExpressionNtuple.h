@@ -10,6 +10,7 @@
 
 #include "boost/utility.hpp"
  #include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/scoped_ptr.hpp>
 
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 #include "CommonTools/Utils/interface/TFileDirectory.h"
@@ -17,7 +18,10 @@
 #include "FWCore/Utilities/interface/TypeWithDict.h"
 
 #include "FinalStateAnalysis/Utilities/interface/ExpressionNtupleColumn.h"
+#include "FinalStateAnalysis/Utilities/interface/ExpressionNtuplePolicy.h"
+#include "FinalStateAnalysis/Utilities/interface/ColumnarNtupleWriter.h"
 
+#include <algorithm>
 #include <sstream>
 
 template<class T>
@@ -32,25 +36,34 @@ class ExpressionNtuple : private boost::noncopyable {
     // If do_commit is true, the held TTree is filled at the end
     // of the fill() function
     void fill(const T& element, int idx = -1, bool do_commit=true);
-    // Fill the held TTree based on the current branches
-    void commit() { tree_->Fill(); }
+    // Fill the held TTree (and columnar output) with the current branches
+    void commit() {
+      if (policy_.fillTree()) tree_->Fill();
+      if (columnar_) columnar_->fill();
+    }
     // Get access to the internal tree
     TTree* tree() const { return tree_; }
   private:
     TTree* tree_;
     std::vector<std::string> columnNames_;
     edm::ParameterSet pset_;
+    ek::ExpressionNtuplePolicy policy_;
+    boost::scoped_ptr<ek::ColumnarNtupleWriter> columnar_;
     boost::ptr_vector<ExpressionNtupleColumn<T> > columns_;
     boost::shared_ptr<Int_t> idxBranch_;
 };
 
 template<class T>
 ExpressionNtuple<T>::ExpressionNtuple(const edm::ParameterSet& pset):
-  pset_(pset) {
+  pset_(pset), policy_(pset) {
   tree_ = NULL;
   typedef std::vector<std::string> vstring;
   // Double check no column already exists
   columnNames_ = pset.getParameterNames();
+  // The write settings are not a column
+  columnNames_.erase(std::remove(columnNames_.begin(), columnNames_.end(),
+        std::string(ek::ExpressionNtuplePolicy::parameterName())),
+      columnNames_.end());
   std::set<std::string> enteredAlready;
   for (size_t i = 0; i < columnNames_.size(); ++i) {
     const std::string& colName = columnNames_[i];
@@ -69,10 +82,18 @@ template<class T> ExpressionNtuple<T>::~ExpressionNtuple() {}
 template<class T> void ExpressionNtuple<T>::initialize(TFileDirectory& fs) {
   tree_ = fs.make<TTree>("Ntuple", "Expression Ntuple");
   // Build branches
-  for (size_t i = 0; i < columnNames_.size(); ++i) 
+  for (size_t i = 0; i < columnNames_.size(); ++i) {
     columns_.push_back(buildColumn<T>(columnNames_[i], pset_, tree_));
+    columns_.back().setMantissaBits(policy_.mantissaBits(columnNames_[i]));
+  }
   // A special branch so we know which subrow we are on.
   tree_->Branch("idx", idxBranch_.get(), "idx/I");
+  policy_.apply(tree_);
+  if (!policy_.columnarDirectory().empty()) {
+    columnar_.reset(new ek::ColumnarNtupleWriter(tree_,
+          policy_.columnarDirectory() + "/" + fs.fullPath(),
+          policy_.columnarChunkRows()));
+  }
 }
 
 template<class T> void ExpressionNtuple<T>::fill(const T& element, 
@@ -99,14 +120,19 @@ class ExpressionNtuple<std::vector<const T*> > : private boost::noncopyable {
   // Fill the tree with an element with given index.
   void fill(const std::vector<const T*>& element, int idx = -1, 
 	    bool do_commit=true);
-  // Fill the held TTree based on the current branches
-    void commit() { tree_->Fill(); }
+  // Fill the held TTree (and columnar output) with the current branches
+    void commit() {
+      if (policy_.fillTree()) tree_->Fill();
+      if (columnar_) columnar_->fill();
+    }
   // Get access to the internal tree
   TTree* tree() const { return tree_; }
  private:
   TTree* tree_;
   std::vector<std::string> columnNames_;
   edm::ParameterSet pset_;
+  ek::ExpressionNtuplePolicy policy_;
+  boost::scoped_ptr<ek::ColumnarNtupleWriter> columnar_;
   boost::ptr_vector<ExpressionNtupleColumn<std::vector<const T*> > > columns_;
   boost::shared_ptr<Int_t> idxBranch_;  
 };
@@ -114,11 +140,15 @@ class ExpressionNtuple<std::vector<const T*> > : private boost::noncopyable {
 template<class T>
 ExpressionNtuple<std::vector<const T*> >::
 ExpressionNtuple(const edm::ParameterSet& pset):
-  pset_(pset) {
+  pset_(pset), policy_(pset) {
   tree_ = NULL;
   typedef std::vector<std::string> vstring;
   // Double check no column already exists
   columnNames_ = pset.getParameterNames();
+  // The write settings are not a column
+  columnNames_.erase(std::remove(columnNames_.begin(), columnNames_.end(),
+        std::string(ek::ExpressionNtuplePolicy::parameterName())),
+      columnNames_.end());
   std::set<std::string> enteredAlready;
   for (size_t i = 0; i < columnNames_.size(); ++i) {
     const std::string& colName = columnNames_[i];
@@ -148,9 +178,17 @@ void ExpressionNtuple<std::vector<const T*> >::initialize(TFileDirectory& fs) {
   // variable length leaves
   tree_->Branch(name.str().c_str(), idxBranch_.get(), leaf.str().c_str());
   // Build branches
-  for (size_t i = 0; i < columnNames_.size(); ++i)
+  for (size_t i = 0; i < columnNames_.size(); ++i) {
     columns_.push_back(buildColumn<std::vector<const T*> >(columnNames_[i], 
 							   pset_, tree_));
+    columns_.back().setMantissaBits(policy_.mantissaBits(columnNames_[i]));
+  }
+  policy_.apply(tree_);
+  if (!policy_.columnarDirectory().empty()) {
+    columnar_.reset(new ek::ColumnarNtupleWriter(tree_,
+          policy_.columnarDirectory() + "/" + fs.fullPath(),
+          policy_.columnarChunkRows()));
+  }
 }
 
 template<class T> 
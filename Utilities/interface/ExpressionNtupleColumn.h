@@ -1,7 +1,9 @@
 /*
  * ExpressionNtupleColumn
  *
- * Abstract base class which fills the appropriate branch variable
+ * Abstract base class which fills the appropriate branch variable.  Common
+ * expressions are evaluated with compiled accessors (see FastObjectFunction),
+ * shared by every column of the job with the same expression.
  *
  * ExpressionNtupleColumnT
  *
@@ -21,7 +23,8 @@
 
 #include <TTree.h>
 #include <TLeaf.h>
-#include "CommonTools/Utils/interface/StringObjectFunction.h"
+#include "FinalStateAnalysis/Utilities/interface/FastObjectFunction.h"
+#include "FinalStateAnalysis/Utilities/interface/ExpressionNtuplePolicy.h"
 #include <TMath.h>
 #include <iostream>
 #include <sstream>
@@ -32,25 +35,31 @@ class ExpressionNtupleColumn {
 public:
     /// Compute the column function and store result in branch variable
   void compute(const ObjType& obj);
+  /// Round float values to [bits] mantissa bits (0: full precision)
+  void setMantissaBits(int bits) { mantissaBits_ = bits; }
 protected:
   /// Abstract function which takes the result from the compute and fills the
   /// branch
   virtual void setValue(double value) = 0;
   virtual void setValue(const std::vector<double>& value) = 0;
   ExpressionNtupleColumn(const std::string& name, const std::string& func);
+  int mantissaBits() const { return mantissaBits_; }
 private:
   std::string name_, expression_;
-  StringObjectFunction<ObjType> func_;
+  boost::shared_ptr<const ek::FastObjectFunction<ObjType> > func_;
+  int mantissaBits_;
 };
 
 template<typename T>
 ExpressionNtupleColumn<T>::ExpressionNtupleColumn(
     const std::string& name, const std::string& func):
-name_(name), expression_(func), func_(func, true) {}
+name_(name), expression_(func),
+  func_(ek::sharedExpression<ek::FastObjectFunction<T> >(func, true)),
+  mantissaBits_(0) {}
 
 template<typename T> void ExpressionNtupleColumn<T>::compute(const T& obj) {
     try{
-      this->setValue(func_(obj));
+      this->setValue((*func_)(obj));
     } catch(cms::Exception& iException) {
       iException << "Caught exception in evaluating branch: "
         << name_ << " with formula: " << expression_;
@@ -64,21 +73,27 @@ class ExpressionNtupleColumn<std::vector<const T*> > {
 public:
   /// Compute the column function and store result in branch variable
   void compute(const std::vector<const T*>& obj);
+  /// Round float values to [bits] mantissa bits (0: full precision)
+  void setMantissaBits(int bits) { mantissaBits_ = bits; }
 protected:
   /// Abstract function which takes the result from the compute and fills the
   /// branch
   virtual void setValue(double value) = 0;
   virtual void setValue(const std::vector<double>& value) = 0;
   ExpressionNtupleColumn(const std::string& name, const std::string& func);
+  int mantissaBits() const { return mantissaBits_; }
 private:
   std::string name_;
-  StringObjectFunction<T> func_;
+  boost::shared_ptr<const ek::FastObjectFunction<T> > func_;
+  int mantissaBits_;
 };
 
 template<class T>
 ExpressionNtupleColumn<std::vector<const T*> >::ExpressionNtupleColumn(
     const std::string& name, const std::string& func):
-  name_(name), func_(func, true) {}
+  name_(name),
+  func_(ek::sharedExpression<ek::FastObjectFunction<T> >(func, true)),
+  mantissaBits_(0) {}
 
 template<class T>
 void ExpressionNtupleColumn<std::vector<const T*> >::compute(
@@ -87,7 +102,7 @@ void ExpressionNtupleColumn<std::vector<const T*> >::compute(
   typename std::vector<const T*>::const_iterator i = obj.begin();
   typename std::vector<const T*>::const_iterator e = obj.end();
   for( ; i != e; ++i ) {
-    result.push_back(func_(*(*i)));
+    result.push_back((*func_)(*(*i)));
 
   }
   this->setValue(result);
@@ -112,6 +127,12 @@ namespace {
   template<> UInt_t convertVal<UInt_t>(double x) { return TMath::Nint(fabs(x)); }
   template<> Long64_t convertVal<Long64_t>(double x) { return lrint(x); }
   template<> ULong64_t convertVal<ULong64_t>(double x) { return lrint(fabs(x)); }
+
+  // Only floats are rounded
+  template<typename T> T reducePrecision(T x, int) { return x; }
+  template<> Float_t reducePrecision<Float_t>(Float_t x, int bits) {
+    return ek::reduceMantissa(x, bits);
+  }
   //vector spec
   template<typename T> std::vector<T> convertVector(const vdouble& x) {
     std::vector<T> result;
@@ -202,7 +223,8 @@ ExpressionNtupleColumnT<ObjType, ColType>::ExpressionNtupleColumnT(
 
 template<typename ObjType, typename ColType>
 void ExpressionNtupleColumnT<ObjType, ColType>::setValue(double value) {
-  *branch_ = convertVal<ColType>(value);
+  *branch_ = reducePrecision(convertVal<ColType>(value),
+      this->mantissaBits());
 }
 
 template<typename T>
@@ -335,7 +357,7 @@ setValue(const std::vector<double>& value) {
   ColType * newValues = new ColType[arrSize];
   // read in the new values
   for( unsigned i = 0; i < arrSize; ++i ) {
-    newValues[i] = thevals[i];
+    newValues[i] = reducePrecision(thevals[i], this->mantissaBits());
   }
   // replace old values
   branch_.reset(newValues,array_deleter<ColType>());
@@ -0,0 +1,101 @@
+#ifndef FinalStateAnalysis_Utilities_ExpressionNtuplePolicy_h
+#define FinalStateAnalysis_Utilities_ExpressionNtuplePolicy_h
+
+/*
+ * Write settings of an ExpressionNtuple, read from the optional
+ * "writePolicy" PSet of the ntuple configuration.  Everything is optional,
+ * without it the tree is written with the ROOT defaults.
+ *
+ *   autoFlush            int32   TTree::SetAutoFlush (entries if > 0,
+ *                                bytes if < 0)
+ *   basketBytes          int32   basket memory of the whole tree, split
+ *                                evenly between the branches, within
+ *   minBasketSize        int32     (default 1024)
+ *   maxBasketSize        int32     (default 32000)
+ *   compressionAlgorithm string  ZLIB, LZMA, LZ4 or ZSTD
+ *   compressionLevel     int32   0 to write uncompressed
+ *   columns              VPSet   per column settings, the first PSet with
+ *                                a matching pattern wins:
+ *     names                vstring wildcard patterns of column names
+ *     mantissaBits         int32   round float columns to this many
+ *                                  mantissa bits (1-23), which then
+ *                                  compress much better
+ *     basketSize, compressionAlgorithm, compressionLevel
+ *   columnarDirectory    string  also write the rows as one .npy file per
+ *                                column, under this directory (see
+ *                                ColumnarNtupleWriter)
+ *   columnarChunkRows    int32   rows buffered per column before they are
+ *                                written (default 10000)
+ *   columnarOnly         bool    don't fill the TTree, only the columns
+ *
+ */
+
+#include <string>
+#include <vector>
+
+namespace edm {
+  class ParameterSet;
+}
+class TTree;
+
+namespace ek {
+
+class ExpressionNtuplePolicy {
+  public:
+    // Name of the policy PSet in the ntuple configuration
+    static const char* parameterName() { return "writePolicy"; }
+
+    // ROOT defaults
+    ExpressionNtuplePolicy();
+    // From the writePolicy PSet of [ntuple], if it has one
+    explicit ExpressionNtuplePolicy(const edm::ParameterSet& ntuple);
+
+    // Mantissa bits kept for [column], 0 for full precision
+    int mantissaBits(const std::string& column) const;
+
+    // Apply the tree and branch settings, once all branches are booked
+    void apply(TTree* tree) const;
+
+    // Empty if no columnar output is requested
+    const std::string& columnarDirectory() const { return columnarDirectory_; }
+    size_t columnarChunkRows() const { return columnarChunkRows_; }
+    // Fill the TTree (false if only the columnar output is written)
+    bool fillTree() const { return !columnarOnly_; }
+
+  private:
+    struct Settings {
+      Settings();
+      // 0 for unset
+      int basketSize;
+      int compressionAlgorithm;
+      // -1 for unset, 0 turns compression off
+      int compressionLevel;
+      // 0 for unset
+      int mantissaBits;
+      void read(const edm::ParameterSet& pset);
+    };
+    struct ColumnRule {
+      std::vector<std::string> names;
+      Settings settings;
+    };
+
+    const Settings* rule(const std::string& column) const;
+
+    bool hasAutoFlush_;
+    long long autoFlush_;
+    int basketBytes_;
+    int minBasketSize_;
+    int maxBasketSize_;
+    Settings tree_;
+    std::vector<ColumnRule> columns_;
+    std::string columnarDirectory_;
+    size_t columnarChunkRows_;
+    bool columnarOnly_;
+};
+
+// [x] rounded to the nearest float with [bits] mantissa bits
+float reduceMantissa(float x, int bits);
+
+}
+
+#endif /* end of include guard: FinalStateAnalysis_Utilities_ExpressionNtuplePolicy_h */
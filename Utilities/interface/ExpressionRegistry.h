@@ -0,0 +1,89 @@
+#ifndef FinalStateAnalysis_Utilities_ExpressionRegistry_h
+#define FinalStateAnalysis_Utilities_ExpressionRegistry_h
+
+/*
+ * Process wide registry of compiled string expressions.
+ *
+ *   boost::shared_ptr<const StringObjectFunction<T> > f =
+ *     ek::sharedExpression<StringObjectFunction<T> >("pt", true);
+ *
+ * Each distinct (type, expression, lazy) is parsed once per job, every
+ * later request gets the same immutable object.  Works for any type built
+ * from (expression, lazy): StringObjectFunction, StringCutObjectSelector,
+ * ek::FastObjectFunction and ek::FastCutObjectSelector.
+ *
+ * Entries are never removed, so the objects (and references to them) live
+ * until the end of the job.  Lookups are serialized with a mutex; keep the
+ * returned pointer instead of looking the expression up per event.  Code
+ * which only gets the expression string per event (PATFinalState::eval)
+ * uses
+ *
+ *   const StringObjectFunction<T>& f =
+ *     ek::cachedExpression<StringObjectFunction<T> >("pt", true);
+ *
+ * which keeps a per-thread copy of the lookups and only takes the lock the
+ * first time a thread sees an expression.
+ *
+ */
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <boost/shared_ptr.hpp>
+
+namespace ek {
+
+template<typename E>
+class ExpressionRegistry {
+  public:
+    typedef boost::shared_ptr<const E> Ptr;
+
+    static Ptr get(const std::string& expression, bool lazy) {
+      ExpressionRegistry& registry = instance();
+      std::lock_guard<std::mutex> lock(registry.mutex_);
+      Ptr& output = registry.expressions_[std::make_pair(expression, lazy)];
+      // If parsing throws, the empty entry is built again next time
+      if (!output)
+        output.reset(new E(expression, lazy));
+      return output;
+    }
+
+    // get(), remembered per thread
+    static const E& getCached(const std::string& expression, bool lazy) {
+      typedef std::map<std::string, const E*> Cache;
+      thread_local Cache caches[2];
+      Cache& cache = caches[lazy];
+      typename Cache::const_iterator found = cache.find(expression);
+      if (found != cache.end())
+        return *found->second;
+      // Kept alive by the registry
+      const E* output = get(expression, lazy).get();
+      cache.insert(std::make_pair(expression, output));
+      return *output;
+    }
+
+  private:
+    static ExpressionRegistry& instance() {
+      static ExpressionRegistry registry;
+      return registry;
+    }
+
+    std::map<std::pair<std::string, bool>, Ptr> expressions_;
+    std::mutex mutex_;
+};
+
+template<typename E>
+boost::shared_ptr<const E> sharedExpression(const std::string& expression,
+    bool lazy=false) {
+  return ExpressionRegistry<E>::get(expression, lazy);
+}
+
+template<typename E>
+const E& cachedExpression(const std::string& expression, bool lazy=false) {
+  return ExpressionRegistry<E>::getCached(expression, lazy);
+}
+
+}
+
+#endif /* end of include guard: FinalStateAnalysis_Utilities_ExpressionRegistry_h */
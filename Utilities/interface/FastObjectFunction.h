@@ -0,0 +1,336 @@
+#ifndef FinalStateAnalysis_Utilities_FastObjectFunction_h
+#define FinalStateAnalysis_Utilities_FastObjectFunction_h
+
+/*
+ * FastObjectFunction<T> / FastCutObjectSelector<T>
+ *
+ * Drop-in replacements for StringObjectFunction<T> and
+ * StringCutObjectSelector<T> which use compiled accessors where they exist.
+ *
+ * A type publishes its accessors by declaring, next to the type,
+ *
+ *   std::function<double(const T&)> nativeFunction(
+ *       const std::string& expression, const T*);
+ *
+ * returning an empty function for expressions it does not handle (see
+ * PATFinalStateAccessors).  It is found by argument dependent lookup.
+ *
+ * The cut selector handles conjunctions of simple comparisons, such as
+ * "daughter(0).pt > 20 & abs(daughter(0).eta) < 2.1".  If any part of a cut
+ * or function is not understood, the whole expression goes through
+ * reflection as before.
+ *
+ * FastCutObjectSelector::select() applies a cut to a whole collection, one
+ * comparison at a time: each side of a comparison is evaluated into a column
+ * for the objects still passing, then the column is compared in one loop.
+ * A type can mark expressions whose value is the same for every object of a
+ * collection (for final states: evt.*) with
+ *
+ *   bool nativeInvariant(const std::string& expression, const T*);
+ *
+ * These are evaluated once per select() call.
+ *
+ * The reflection fallbacks come from the ExpressionRegistry, so an
+ * expression is only parsed once per job.  Whole Fast* objects can be
+ * shared the same way (ek::sharedExpression<FastObjectFunction<T> >).
+ *
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include "CommonTools/Utils/interface/StringObjectFunction.h"
+#include "CommonTools/Utils/interface/StringCutObjectSelector.h"
+#include "FinalStateAnalysis/Utilities/interface/ExpressionRegistry.h"
+
+namespace ek {
+
+// Default: no compiled accessors
+template<typename T>
+std::function<double(const T&)> nativeFunction(const std::string&, const T*) {
+  return std::function<double(const T&)>();
+}
+
+// Default: nothing is invariant
+template<typename T>
+bool nativeInvariant(const std::string&, const T*) {
+  return false;
+}
+
+template<typename T>
+std::function<double(const T&)> findNativeFunction(
+    const std::string& expression) {
+  return nativeFunction(expression, static_cast<const T*>(0));
+}
+
+template<typename T>
+bool findNativeInvariant(const std::string& expression) {
+  return nativeInvariant(expression, static_cast<const T*>(0));
+}
+
+template<typename T>
+class FastObjectFunction {
+  public:
+    FastObjectFunction(const std::string& expression, bool lazy=false):
+      native_(findNativeFunction<T>(expression)) {
+      if (!native_)
+        func_ = sharedExpression<StringObjectFunction<T> >(expression, lazy);
+    }
+
+    double operator()(const T& t) const {
+      return native_ ? native_(t) : (*func_)(t);
+    }
+
+    // True if the expression does not use reflection
+    bool native() const { return bool(native_); }
+
+  private:
+    std::function<double(const T&)> native_;
+    boost::shared_ptr<const StringObjectFunction<T> > func_;
+};
+
+template<typename T>
+class FastCutObjectSelector {
+  public:
+    FastCutObjectSelector(const std::string& cut, bool lazy=false) {
+      if (!parseCut(cut)) {
+        terms_.clear();
+        cut_ = sharedExpression<StringCutObjectSelector<T> >(cut, lazy);
+      }
+    }
+
+    bool operator()(const T& t) const {
+      if (cut_)
+        return (*cut_)(t);
+      for (size_t i = 0; i < terms_.size(); ++i) {
+        if (!terms_[i].pass(t))
+          return false;
+      }
+      return true;
+    }
+
+    // Evaluate the cut on all [objects], pass[i] is the result for
+    // objects[i].  Invariant terms are evaluated on the first object only.
+    void select(const std::vector<const T*>& objects,
+        std::vector<bool>& pass) const {
+      pass.assign(objects.size(), true);
+      if (cut_) {
+        for (size_t i = 0; i < objects.size(); ++i) {
+          pass[i] = (*cut_)(*objects[i]);
+        }
+        return;
+      }
+      // Indices of the objects which passed all terms so far
+      std::vector<size_t> alive(objects.size());
+      for (size_t i = 0; i < alive.size(); ++i) {
+        alive[i] = i;
+      }
+      std::vector<double> lhs;
+      std::vector<double> rhs;
+      for (size_t k = 0; k < terms_.size() && !alive.empty(); ++k) {
+        const Term& term = terms_[k];
+        column(term.lhs, term.lhsInvariant, objects, alive, lhs);
+        if (term.op != NONZERO)
+          column(term.rhs, term.rhsInvariant, objects, alive, rhs);
+        size_t nAlive = 0;
+        for (size_t i = 0; i < alive.size(); ++i) {
+          const bool ok = term.op == NONZERO ?
+            lhs[i] != 0 : compare(term.op, lhs[i], rhs[i]);
+          if (ok)
+            alive[nAlive++] = alive[i];
+          else
+            pass[alive[i]] = false;
+        }
+        alive.resize(nAlive);
+      }
+    }
+
+    // True if the cut does not use reflection
+    bool native() const { return !cut_; }
+
+  private:
+    typedef std::function<double(const T&)> Function;
+
+    enum Comparison { NONZERO, GT, GE, LT, LE, EQ, NE };
+
+    static bool compare(Comparison op, double l, double r) {
+      switch (op) {
+        case GT: return l > r;
+        case GE: return l >= r;
+        case LT: return l < r;
+        case LE: return l <= r;
+        case EQ: return l == r;
+        default: return l != r;
+      }
+    }
+
+    struct Term {
+      Function lhs;
+      Function rhs;
+      bool lhsInvariant;
+      bool rhsInvariant;
+      Comparison op;
+      bool pass(const T& t) const {
+        const double l = lhs(t);
+        if (op == NONZERO)
+          return l != 0;
+        return compare(op, l, rhs(t));
+      }
+    };
+
+    // Evaluate [f] for the [alive] objects
+    static void column(const Function& f, bool invariant,
+        const std::vector<const T*>& objects,
+        const std::vector<size_t>& alive, std::vector<double>& out) {
+      out.resize(alive.size());
+      if (invariant && !alive.empty()) {
+        out.assign(alive.size(), f(*objects[alive[0]]));
+        return;
+      }
+      for (size_t i = 0; i < alive.size(); ++i) {
+        out[i] = f(*objects[alive[i]]);
+      }
+    }
+
+    // Positions of top level (outside quotes and parentheses) characters
+    // are found by walking the string once.
+    static bool topLevel(const std::string& s, std::vector<bool>& out) {
+      out.assign(s.size(), false);
+      int depth = 0;
+      char quote = 0;
+      for (size_t i = 0; i < s.size(); ++i) {
+        char c = s[i];
+        if (quote) {
+          if (c == quote)
+            quote = 0;
+        } else if (c == '"' || c == '\'') {
+          quote = c;
+        } else if (c == '(') {
+          ++depth;
+        } else if (c == ')') {
+          if (--depth < 0)
+            return false;
+        } else if (depth == 0) {
+          out[i] = true;
+        }
+      }
+      return depth == 0 && !quote;
+    }
+
+    static std::string trim(const std::string& s) {
+      size_t first = s.find_first_not_of(" \t\n");
+      if (first == std::string::npos)
+        return "";
+      size_t last = s.find_last_not_of(" \t\n");
+      return s.substr(first, last - first + 1);
+    }
+
+    // A number, an accessor or abs(accessor)
+    static Function parseValue(const std::string& input, bool& invariant) {
+      const std::string value = trim(input);
+      invariant = false;
+      if (value.empty())
+        return Function();
+      char* end = 0;
+      const double number = std::strtod(value.c_str(), &end);
+      if (*end == '\0') {
+        invariant = true;
+        return [number](const T&) { return number; };
+      }
+      if (value.compare(0, 4, "abs(") == 0 && value[value.size()-1] == ')') {
+        const std::string innerExpr = value.substr(4, value.size() - 5);
+        Function inner = findNativeFunction<T>(innerExpr);
+        if (!inner)
+          return Function();
+        invariant = findNativeInvariant<T>(innerExpr);
+        return [inner](const T& t) { return std::abs(inner(t)); };
+      }
+      invariant = findNativeInvariant<T>(value);
+      return findNativeFunction<T>(value);
+    }
+
+    bool parseTerm(const std::string& term) {
+      std::vector<bool> top;
+      if (!topLevel(term, top))
+        return false;
+      Term output;
+      output.op = NONZERO;
+      size_t opPos = std::string::npos;
+      size_t opLength = 0;
+      for (size_t i = 0; i < term.size(); ++i) {
+        if (!top[i])
+          continue;
+        const char c = term[i];
+        const char next = i + 1 < term.size() ? term[i+1] : 0;
+        Comparison op = NONZERO;
+        size_t length = 1;
+        if (c == '>') {
+          op = next == '=' ? GE : GT;
+        } else if (c == '<') {
+          op = next == '=' ? LE : LT;
+        } else if (c == '=' && next == '=') {
+          op = EQ;
+        } else if (c == '!' && next == '=') {
+          op = NE;
+        } else if (c == '!' || c == '|' || c == '?' || c == ':' ||
+            c == '+' || c == '*' || c == '/' || c == '^' || c == '=') {
+          // Negation, or, ternary or arithmetic: leave it to the parser.
+          // ('-' can be a sign, the value parsing catches arithmetic.)
+          return false;
+        } else {
+          continue;
+        }
+        if (op == GE || op == LE || op == EQ || op == NE)
+          length = 2;
+        // Only one comparison per term
+        if (opPos != std::string::npos)
+          return false;
+        opPos = i;
+        opLength = length;
+        output.op = op;
+        i += length - 1;
+      }
+      output.rhsInvariant = false;
+      if (opPos == std::string::npos) {
+        output.lhs = parseValue(term, output.lhsInvariant);
+      } else {
+        output.lhs = parseValue(term.substr(0, opPos), output.lhsInvariant);
+        output.rhs = parseValue(term.substr(opPos + opLength),
+            output.rhsInvariant);
+        if (!output.rhs)
+          return false;
+      }
+      if (!output.lhs)
+        return false;
+      terms_.push_back(output);
+      return true;
+    }
+
+    bool parseCut(const std::string& cut) {
+      std::vector<bool> top;
+      if (trim(cut).empty() || !topLevel(cut, top))
+        return false;
+      // Split on top level & or &&
+      size_t start = 0;
+      for (size_t i = 0; i <= cut.size(); ++i) {
+        if (i < cut.size() && !(top[i] && cut[i] == '&'))
+          continue;
+        if (!parseTerm(cut.substr(start, i - start)))
+          return false;
+        if (i + 1 < cut.size() && cut[i+1] == '&')
+          ++i;
+        start = i + 1;
+      }
+      return true;
+    }
+
+    std::vector<Term> terms_;
+    boost::shared_ptr<const StringCutObjectSelector<T> > cut_;
+};
+
+}
+
+#endif /* end of include guard: FinalStateAnalysis_Utilities_FastObjectFunction_h */
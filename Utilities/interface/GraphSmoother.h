@@ -18,6 +18,14 @@
 #include "TGraph.h"
 #include "TGraphAsymmErrors.h"
 
+// Weights of the points in the local fits, as a function of
+// u = |x - x0|/width
+enum GraphSmoothingKernel {
+  kUniformKernel,     // 1
+  kTriangularKernel,  // 1 - u
+  kTricubeKernel      // (1 - u^3)^3
+};
+
 // Smooth a graph over an interval of width.  At each data point,
 // fit a 2nd order polynomial in the range x +- width.  The new x0 value is
 // the fitted poly evaluated at x0
@@ -27,6 +35,18 @@ TGraph smooth(const TGraph& graph, double width);
 TGraphAsymmErrors smoothWithErrors(const TGraphAsymmErrors& graph,
     double width);
 
+// Same as smooth(), with a polynomial of any degree and weighted points.
+// The local least squares fits are solved in closed form.  With the uniform
+// kernel the moment sums are updated as the window slides along the graph.
+// If fewer than degree+1 points are strictly inside the window, the point
+// is not changed.
+TGraph smoothLocalPoly(const TGraph& graph, double width, int degree=2,
+    GraphSmoothingKernel kernel=kUniformKernel);
+
+// The nominal values and both edges of the error band share the fits
+TGraphAsymmErrors smoothLocalPolyWithErrors(const TGraphAsymmErrors& graph,
+    double width, int degree=2, GraphSmoothingKernel kernel=kUniformKernel);
+
 // HiggsAnalysis BandUtils.cxx version
 TGraph smoothBandUtils(const TGraph& graph, int npar);
 
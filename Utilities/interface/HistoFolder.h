@@ -1,20 +1,76 @@
 #ifndef FinalStateAnalysis_Utilities_Histogrammer_h
 #define FinalStateAnalysis_Utilities_Histogrammer_h
 
-#include "CommonTools/Utils/interface/ExpressionHisto.h"
+#include "FinalStateAnalysis/Utilities/interface/BinnedExpressionHisto.h"
 #include "FinalStateAnalysis/Utilities/interface/ExpressionNtuple.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
 #include "CommonTools/Utils/interface/TFileDirectory.h"
 #include "CommonTools/Utils/interface/StringCutObjectSelector.h"
+#include "CommonTools/Utils/interface/StringObjectFunction.h"
+#include "FinalStateAnalysis/Utilities/interface/ExpressionRegistry.h"
+
+#include <boost/shared_ptr.hpp>
 
 namespace ek {
 
+// The histograms of one folder.  Each distinct expression is evaluated
+// once per object, however many histograms plot it, and the compiled
+// expressions are shared by every folder of the job (ExpressionRegistry).
+template<typename T>
+class HistoSet {
+  typedef StringObjectFunction<T> Function;
+  typedef boost::shared_ptr<const Function> FunctionPtr;
+  typedef std::vector<edm::ParameterSet> VPSet;
+  public:
+    void book(const VPSet& psets, TFileDirectory& fs) {
+      for (size_t iHisto = 0; iHisto < psets.size(); ++iHisto) {
+        BinnedExpressionHisto histo(psets[iHisto]);
+        histo.initialize(fs);
+        histoFunctions_.push_back(
+            getFunction(histo.expression(), histo.lazy()));
+        histos_.push_back(histo);
+      }
+      values_.resize(functions_.size());
+    }
+
+    void fill(const T& object, double weight) {
+      for (size_t iFunc = 0; iFunc < functions_.size(); ++iFunc) {
+        values_[iFunc] = (*functions_[iFunc])(object);
+      }
+      for (size_t iHisto = 0; iHisto < histos_.size(); ++iHisto) {
+        histos_[iHisto].fill(values_[histoFunctions_[iHisto]], weight);
+      }
+    }
+
+    void flush() {
+      for (size_t iHisto = 0; iHisto < histos_.size(); ++iHisto) {
+        histos_[iHisto].flush();
+      }
+    }
+
+  private:
+    // Index of the expression in this set, compiling it if needed
+    size_t getFunction(const std::string& expression, bool lazy) {
+      FunctionPtr function = sharedExpression<Function>(expression, lazy);
+      for (size_t iFunc = 0; iFunc < functions_.size(); ++iFunc) {
+        if (functions_[iFunc] == function)
+          return iFunc;
+      }
+      functions_.push_back(function);
+      return functions_.size() - 1;
+    }
+
+    std::vector<BinnedExpressionHisto> histos_;
+    // Which expression each histogram plots
+    std::vector<size_t> histoFunctions_;
+    std::vector<FunctionPtr> functions_;
+    std::vector<double> values_;
+};
+
 template<typename T>
 class HistoFolder {
   typedef StringCutObjectSelector<T> Selector;
-  typedef boost::shared_ptr<Selector> SelectorPtr;
-  typedef ExpressionHisto<T> Histo;
-  typedef boost::shared_ptr<Histo> HistoPtr;
+  typedef boost::shared_ptr<const Selector> SelectorPtr;
   typedef std::vector<edm::ParameterSet> VPSet;
   public:
     // Constructor with subfolders, selections, etc.
@@ -32,13 +88,18 @@ class HistoFolder {
     // object index, which will be passed to any ntuples contained in this
     // folder.
     void fill(const T& object, double weight, int idx=-1);
+
+    // Write the accumulated fills into the histograms of this folder and all
+    // subfolders.  Must be called before the output file is written (i.e. in
+    // endJob).
+    void flush();
   private:
     // Initialization methods
     void bookHistograms(const edm::ParameterSet& pset, TFileDirectory& fs);
     void bookHistograms(const VPSet& psets, TFileDirectory& fs);
     SelectorPtr selector_;
     std::vector<boost::shared_ptr<HistoFolder<T> > > subfolders_;
-    std::vector<HistoPtr> histos_;
+    HistoSet<T> histos_;
     boost::shared_ptr<ExpressionNtuple<T> > ntuple_;
 };
 
@@ -69,8 +130,8 @@ HistoFolder<T>::bookHistograms(const edm::ParameterSet& pset,
     TFileDirectory& fs) {
   // Check if this folder has a selection
   if (pset.exists("SELECT")) {
-    selector_.reset(new StringCutObjectSelector<T>(
-          pset.getParameter<std::string>("SELECT")));
+    selector_ = sharedExpression<Selector>(
+        pset.getParameter<std::string>("SELECT"));
   }
 
   // Now get all the histograms
@@ -102,14 +163,7 @@ HistoFolder<T>::bookHistograms(const edm::ParameterSet& pset,
 
 template<typename T> void
 HistoFolder<T>::bookHistograms(const VPSet& psets, TFileDirectory& fs) {
-  for (size_t iHisto = 0; iHisto < psets.size(); ++iHisto) {
-    edm::ParameterSet histoPSet = psets[iHisto];
-    // Build the histo
-    HistoPtr histo(new Histo(histoPSet));
-    // Initialize it
-    histo->initialize(fs);
-    histos_.push_back(histo);
-  }
+  histos_.book(psets, fs);
 }
 
 // Recursive filling of histograms
@@ -118,9 +172,7 @@ void HistoFolder<T>::fill(const T& object, double weight, int idx) {
   // Check if we are selecting and if it passes
   if (!selector_.get() || (*selector_)(object)) {
     // Fill this directories histos
-    for (size_t iHisto = 0; iHisto < histos_.size(); ++iHisto) {
-      histos_.at(iHisto)->fill(object, weight);
-    }
+    histos_.fill(object, weight);
     // Fill this directories ntuple, if we are using it.
     if (ntuple_.get())
       ntuple_->fill(object, idx);
@@ -131,13 +183,19 @@ void HistoFolder<T>::fill(const T& object, double weight, int idx) {
   }
 }
 
+template<typename T>
+void HistoFolder<T>::flush() {
+  histos_.flush();
+  for (size_t iFolder = 0; iFolder < subfolders_.size(); ++iFolder) {
+    subfolders_.at(iFolder)->flush();
+  }
+}
+
 // vector specialization
 template<typename T>
 class HistoFolder<std::vector<const T*> > {
   typedef StringCutObjectSelector<T> Selector;
-  typedef boost::shared_ptr<Selector> SelectorPtr;
-  typedef ExpressionHisto<T> Histo;
-  typedef boost::shared_ptr<Histo> HistoPtr;
+  typedef boost::shared_ptr<const Selector> SelectorPtr;
   typedef std::vector<edm::ParameterSet> VPSet;
   public:
     // Constructor with subfolders, selections, etc.
@@ -155,6 +213,9 @@ class HistoFolder<std::vector<const T*> > {
     // object index, which will be passed to any ntuples contained in this
     // folder.
     void fill(const std::vector<const T*>& object, double weight, int idx=-1);
+
+    // Write the accumulated fills into the histograms, see above.
+    void flush();
   private:
     // Initialization methods
     void bookHistograms(const edm::ParameterSet& pset, TFileDirectory& fs);
@@ -162,7 +223,7 @@ class HistoFolder<std::vector<const T*> > {
     SelectorPtr selector_;
     std::vector<boost::shared_ptr<HistoFolder<std::vector<const T*> > > > 
       subfolders_;
-    std::vector<HistoPtr> histos_;
+    HistoSet<T> histos_;
     boost::shared_ptr<ExpressionNtuple<std::vector<const T*> > > 
       ntuple_;
 };
@@ -199,8 +260,8 @@ HistoFolder<std::vector<const T*> >::
 		 TFileDirectory& fs) {
   // Check if this folder has a selection
   if (pset.exists("SELECT")) {
-    selector_.reset(new StringCutObjectSelector<T>(
-          pset.getParameter<std::string>("SELECT")));
+    selector_ = sharedExpression<Selector>(
+        pset.getParameter<std::string>("SELECT"));
   }
 
   // Now get all the histograms
@@ -236,14 +297,7 @@ template<typename T> void
 HistoFolder<std::vector<const T*> >
   ::bookHistograms(const VPSet& psets, 
 		   TFileDirectory& fs) {
-  for (size_t iHisto = 0; iHisto < psets.size(); ++iHisto) {
-    edm::ParameterSet histoPSet = psets[iHisto];
-    // Build the histo
-    HistoPtr histo(new Histo(histoPSet));
-    // Initialize it
-    histo->initialize(fs);
-    histos_.push_back(histo);
-  }
+  histos_.book(psets, fs);
 }
 
 // Recursive filling of histograms
@@ -257,9 +311,7 @@ void HistoFolder<std::vector<const T*> >::
     // Check if we are selecting and if it passes
     if (!selector_.get() || (*selector_)(*objects[i])) {
       // Fill this directories histos
-      for (size_t iHisto = 0; iHisto < histos_.size(); ++iHisto) {
-	histos_.at(iHisto)->fill(*objects[i], weight);
-      }      
+      histos_.fill(*objects[i], weight);
     }
   }
   // Fill this directories ntuple, if we are using it.
@@ -271,6 +323,14 @@ void HistoFolder<std::vector<const T*> >::
   }
 }
 
+template<typename T>
+void HistoFolder<std::vector<const T*> >::flush() {
+  histos_.flush();
+  for (size_t iFolder = 0; iFolder < subfolders_.size(); ++iFolder) {
+    subfolders_.at(iFolder)->flush();
+  }
+}
+
 }
 
 #endif
@@ -9,34 +9,109 @@
  * Class which implements a predicate to sort objects of a given type using
  * the StringObjectFunction.  Default order is descending.
  *
+ * More than one function can be given, in which case objects are ordered by
+ * the first, ties are broken by the second, and so on.
+ *
+ * Using the sorter as an std::sort predicate evaluates the functions twice
+ * per comparison.  sort() and order() evaluate them exactly once per object
+ * and sort the cached keys instead, and should be preferred for anything
+ * but tiny collections.
+ *
  */
 
+#include <algorithm>
 #include <cassert>
 #include <functional>
+#include <string>
+#include <vector>
 #include "CommonTools/Utils/interface/StringObjectFunction.h"
+#include "FinalStateAnalysis/Utilities/interface/ExpressionRegistry.h"
 
 template<class T>
 class StringObjectSorter : public std::binary_function<const T*, const T*, bool> {
+  typedef StringObjectFunction<T> Function;
   public:
     StringObjectSorter(const std::string& function, bool descending=true, bool lazy=true):
-      function_(function, lazy),descending_(descending) {}
+      descending_(descending) {
+      functions_.push_back(ek::sharedExpression<Function>(function, lazy));
+    }
+
+    StringObjectSorter(const std::vector<std::string>& functions,
+        bool descending=true, bool lazy=true):
+      descending_(descending) {
+      assert(functions.size());
+      for (size_t i = 0; i < functions.size(); ++i) {
+        functions_.push_back(
+            ek::sharedExpression<Function>(functions[i], lazy));
+      }
+    }
+
     bool operator()(const T* t1, const T* t2) const {
       assert(t1);
       assert(t2);
-      //if (!t1 || !t2) {
-        //std::cout << "WTF: " << t1 << " " << t2 << std::endl;
-      //}
-      //std::cout << "t1: " << t1 << " func " << function_(*t1) << std::endl;
-      //std::cout << "t2: " << t2 << " func " << function_(*t2) << std::endl;
-      bool lessThan = function_(*t1) < function_(*t2);
-      // Descending inverts lessThan via xor if true
-      if (descending_)
-        return !lessThan;
-      else
-        return lessThan;
+      for (size_t k = 0; k < functions_.size(); ++k) {
+        double v1 = (*functions_[k])(*t1);
+        double v2 = (*functions_[k])(*t2);
+        if (v1 != v2)
+          return descending_ ? v2 < v1 : v1 < v2;
+      }
+      return false;
     }
+
+    // Indices of [objects] in sorted order.  Equal objects keep their
+    // relative order.
+    std::vector<size_t> order(const std::vector<const T*>& objects) const {
+      const size_t nKeys = functions_.size();
+      std::vector<double> keys(objects.size()*nKeys);
+      for (size_t i = 0; i < objects.size(); ++i) {
+        assert(objects[i]);
+        for (size_t k = 0; k < nKeys; ++k) {
+          keys[i*nKeys + k] = (*functions_[k])(*objects[i]);
+        }
+      }
+      std::vector<size_t> indices(objects.size());
+      for (size_t i = 0; i < indices.size(); ++i) {
+        indices[i] = i;
+      }
+      std::stable_sort(indices.begin(), indices.end(),
+          KeyOrdering(keys, nKeys, descending_));
+      return indices;
+    }
+
+    // Sort [objects] in place.  Equal objects keep their relative order.
+    void sort(std::vector<const T*>& objects) const {
+      std::vector<size_t> indices = order(objects);
+      std::vector<const T*> sorted;
+      sorted.reserve(objects.size());
+      for (size_t i = 0; i < indices.size(); ++i) {
+        sorted.push_back(objects[indices[i]]);
+      }
+      objects.swap(sorted);
+    }
+
   private:
-    const StringObjectFunction<T> function_;
+    // Lexicographic ordering of object indices by their precomputed keys
+    class KeyOrdering {
+      public:
+        KeyOrdering(const std::vector<double>& keys, size_t nKeys,
+            bool descending):
+          keys_(keys),nKeys_(nKeys),descending_(descending) {}
+        bool operator()(size_t i1, size_t i2) const {
+          const double* k1 = &keys_[i1*nKeys_];
+          const double* k2 = &keys_[i2*nKeys_];
+          for (size_t k = 0; k < nKeys_; ++k) {
+            if (k1[k] != k2[k])
+              return descending_ ? k2[k] < k1[k] : k1[k] < k2[k];
+          }
+          return false;
+        }
+      private:
+        const std::vector<double>& keys_;
+        size_t nKeys_;
+        bool descending_;
+    };
+
+    std::vector<boost::shared_ptr<const Function> > functions_;
     bool descending_;
 };
 
@@ -0,0 +1,58 @@
+#ifndef FinalStateAnalysis_Utilities_TH1Accumulator_h
+#define FinalStateAnalysis_Utilities_TH1Accumulator_h
+
+/*
+ * Buffers fills of a uniformly binned 1D histogram.
+ *
+ * Fills go into flat per-bin arrays (using the uniform binning index math
+ * of TAxis::FindBin directly) and are only added to the histogram by
+ * flush().  The
+ * statistics (entries, sum of weights, mean and RMS) are buffered as well,
+ * so after flushing the histogram is the same as if TH1::Fill had been
+ * called for every entry, including NaNs (counted in the overflow).
+ *
+ * Each accumulator belongs to one module instance, so filling never touches
+ * shared ROOT objects.  The owner must flush before the histogram is written
+ * out (i.e. in endJob).
+ *
+ */
+
+#include <vector>
+
+class TH1;
+
+namespace ek {
+
+class TH1Accumulator {
+  public:
+    TH1Accumulator();
+    // Buffer fills for [histo], which must have uniform binning
+    explicit TH1Accumulator(TH1* histo);
+
+    void fill(double x, double weight=1.0);
+
+    // Weight waiting to be added to the given bin (0 = underflow)
+    double pending(int bin) const { return sumw_[bin]; }
+
+    // Add the buffered fills to the histogram
+    void flush();
+
+  private:
+    void clear();
+
+    TH1* histo_;
+    int nbins_;
+    double min_;
+    double max_;
+
+    // Pending fills, including under/overflow
+    std::vector<double> sumw_;
+    std::vector<double> sumw2_;
+    double stats_[4];
+    double entries_;
+    bool weighted_;
+};
+
+}
+
+#endif
@@ -0,0 +1,42 @@
+'''
+
+Read the columnar ntuple output (writePolicy.columnarDirectory, see
+Utilities/interface/ColumnarNtupleWriter.h) into numpy arrays, without
+ROOT.  The columns are memory mapped, nothing is read until it's used.
+
+>>> columns = load('columns/mmt/final')
+>>> columns['m1Pt'].mean()
+
+Variable length columns (event view ntuples) hold the values of all rows
+back to back, split them with their counter column:
+
+>>> rows(columns['pt'], columns['N_LeafCandidate'])
+
+'''
+
+import glob
+import os
+
+import numpy
+
+
+def load(directory, columns=None):
+    ''' Map the .npy columns in [directory], optionally only [columns]
+
+    Returns a dictionary of column name to array.
+
+    '''
+    if columns is None:
+        columns = [os.path.basename(path)[:-len('.npy')] for path in
+                   sorted(glob.glob(os.path.join(directory, '*.npy')))]
+    output = {}
+    for column in columns:
+        output[column] = numpy.load(
+            os.path.join(directory, column + '.npy'), mmap_mode='r')
+    return output
+
+
+def rows(values, counts):
+    ''' Split the [values] of a variable length column into one array per row
+    '''
+    return numpy.split(values, numpy.cumsum(counts)[:-1])
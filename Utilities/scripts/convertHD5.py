@@ -3,6 +3,9 @@
 
 Convert ROOT trees into an HDF5 File
 
+Ntuples written with a columnarDirectory (see
+FinalStateAnalysis.Utilities.columnar) don't need this conversion.
+
 '''
 
 from RecoLuminosity.LumiDB import argparse
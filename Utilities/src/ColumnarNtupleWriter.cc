@@ -0,0 +1,140 @@
+#include "FinalStateAnalysis/Utilities/interface/ColumnarNtupleWriter.h"
+
+#include "FWCore/Utilities/interface/Exception.h"
+#include "TBranch.h"
+#include "TLeaf.h"
+#include "TObjArray.h"
+#include "TTree.h"
+
+#include <boost/filesystem.hpp>
+#include <iostream>
+#include <sstream>
+
+namespace ek {
+
+namespace {
+
+// Fixed size of the .npy header, so that the final shape can be written in
+// place once the number of values is known
+const size_t headerSize = 128;
+
+// NumPy type of a ROOT leaf type
+std::string numpyType(const std::string& type, size_t& width) {
+  if (type == "Float_t") { width = 4; return "<f4"; }
+  if (type == "Double_t") { width = 8; return "<f8"; }
+  if (type == "Int_t") { width = 4; return "<i4"; }
+  if (type == "UInt_t") { width = 4; return "<u4"; }
+  if (type == "Long64_t") { width = 8; return "<i8"; }
+  if (type == "ULong64_t") { width = 8; return "<u8"; }
+  throw cms::Exception("ColumnarWrite")
+    << "Leaves of type " << type << " can't be written as columns"
+    << std::endl;
+}
+
+}
+
+ColumnarNtupleWriter::ColumnarNtupleWriter(TTree* tree,
+    const std::string& directory, size_t chunkRows):
+  chunkRows_(chunkRows > 0 ? chunkRows : 1), rows_(0), closed_(false) {
+  boost::filesystem::create_directories(directory);
+  TObjArray* branches = tree->GetListOfBranches();
+  for (int i = 0; i < branches->GetEntries(); ++i) {
+    TBranch* branch = static_cast<TBranch*>(branches->At(i));
+    Column column;
+    column.leaf = static_cast<TLeaf*>(branch->GetListOfLeaves()->At(0));
+    column.descr = numpyType(column.leaf->GetTypeName(), column.width);
+    column.path = directory + "/" + branch->GetName() + ".npy";
+    column.file = 0;
+    column.values = 0;
+    columns_.push_back(column);
+  }
+  for (size_t i = 0; i < columns_.size(); ++i) {
+    Column& column = columns_[i];
+    column.file = std::fopen(column.path.c_str(), "wb");
+    if (!column.file) {
+      throw cms::Exception("ColumnarWrite")
+        << "Can't open " << column.path << " for writing" << std::endl;
+    }
+    column.buffer.reserve(chunkRows_*column.width);
+    writeHeader(column);
+  }
+}
+
+ColumnarNtupleWriter::~ColumnarNtupleWriter() {
+  try {
+    close();
+  } catch (cms::Exception& e) {
+    std::cerr << "ColumnarNtupleWriter: " << e.what() << std::endl;
+  }
+}
+
+void ColumnarNtupleWriter::fill() {
+  for (size_t i = 0; i < columns_.size(); ++i) {
+    Column& column = columns_[i];
+    // Number of values in this row (1 unless the leaf has a counter)
+    const size_t length = column.leaf->GetLen();
+    const char* values =
+      static_cast<const char*>(column.leaf->GetValuePointer());
+    if (length && values) {
+      column.buffer.insert(column.buffer.end(), values,
+          values + length*column.width);
+    }
+    column.values += length;
+  }
+  if (++rows_ % chunkRows_ == 0)
+    flush();
+}
+
+void ColumnarNtupleWriter::flush() {
+  for (size_t i = 0; i < columns_.size(); ++i) {
+    Column& column = columns_[i];
+    if (column.buffer.empty())
+      continue;
+    if (std::fwrite(&column.buffer[0], 1, column.buffer.size(), column.file)
+        != column.buffer.size()) {
+      throw cms::Exception("ColumnarWrite")
+        << "Failed writing " << column.path << std::endl;
+    }
+    column.buffer.clear();
+  }
+}
+
+void ColumnarNtupleWriter::writeHeader(Column& column) {
+  std::ostringstream dict;
+  dict << "{'descr': '" << column.descr << "', 'fortran_order': False, "
+    << "'shape': (" << column.values << ",), }";
+  // magic, version 1.0, header length, dict padded with spaces and '\n'
+  std::string header("\x93NUMPY\x01\x00", 8);
+  const size_t dictSize = headerSize - 10;
+  header += char(dictSize & 0xff);
+  header += char(dictSize >> 8);
+  std::string text = dict.str();
+  text.resize(dictSize - 1, ' ');
+  header += text + '\n';
+  if (std::fseek(column.file, 0, SEEK_SET) != 0 ||
+      std::fwrite(header.data(), 1, header.size(), column.file)
+        != header.size() ||
+      std::fseek(column.file, 0, SEEK_END) != 0) {
+    throw cms::Exception("ColumnarWrite")
+      << "Failed writing the header of " << column.path << std::endl;
+  }
+}
+
+void ColumnarNtupleWriter::close() {
+  if (closed_)
+    return;
+  closed_ = true;
+  flush();
+  for (size_t i = 0; i < columns_.size(); ++i) {
+    Column& column = columns_[i];
+    writeHeader(column);
+    const bool closed = std::fclose(column.file) == 0;
+    column.file = 0;
+    if (!closed) {
+      throw cms::Exception("ColumnarWrite")
+        << "Failed closing " << column.path << std::endl;
+    }
+  }
+}
+
+}
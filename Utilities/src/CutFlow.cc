@@ -38,6 +38,7 @@ void CutFlow::initialize(const std::vector<std::string>& cutNames,
   for (size_t i = 0; i < cutNames.size(); ++i) {
     cutFlow_->GetXaxis()->SetBinLabel(i+1, cutNames[i].c_str());
   }
+  pending_ = TH1Accumulator(cutFlow_);
 }
 
 // Constructor from an existing TH1F*
@@ -45,6 +46,7 @@ CutFlow::CutFlow(const TH1F& histo) {
   cutFlow_ = new TH1F(histo); // make a copy
   // cleanup on destruction
   mustCleanupHistogram_ = true;
+  pending_ = TH1Accumulator(cutFlow_);
 }
 
 CutFlow::~CutFlow() {
@@ -70,13 +72,17 @@ void CutFlow::fillImpl(const CutSet& cuts, double w, size_t idx) {
   const std::vector<bool>& bits = cuts.bits();
   for (size_t i = 0; i < bits.size(); ++i) {
     if (bits[i]) {
-      cutFlow_->Fill(idx + i, w);
+      pending_.fill(idx + i, w);
     }
   }
 }
 
+void CutFlow::flush() {
+  pending_.flush();
+}
+
 double CutFlow::passed(size_t n) const {
-  return cutFlow_->GetBinContent(n+1);
+  return cutFlow_->GetBinContent(n+1) + pending_.pending(n+1);
 }
 
 double CutFlow::efficiency(size_t n) const {
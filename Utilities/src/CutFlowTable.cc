@@ -11,10 +11,13 @@ void CutFlowTable::addSample(const std::string& sample, const CutFlow* cuts) {
 }
 
 void CutFlowTable::print(std::ostream& out) const {
+  if (samples_.empty())
+    return;
+  out.setf(std::ios::fixed, std::ios::floatfield);
   // Write header
   out << std::setw(20) << std::left << "Cut" << "|";
   std::string underline = "---------------------";
-  for (size_t i = 0; i << samples_.size(); ++i) {
+  for (size_t i = 0; i < samples_.size(); ++i) {
     out << std::setw(15) << std::right << samples_[i].first;
     underline += "---------------";
   }
@@ -24,14 +27,15 @@ void CutFlowTable::print(std::ostream& out) const {
   for (size_t iCut = 0; iCut < cuts->nCuts(); ++iCut) {
     const char* name = cuts->name(iCut);
     out << std::setw(20) << std::left << name;
-    for (size_t iSample = 0; iSample < samples_.size(); ++iCut) {
+    for (size_t iSample = 0; iSample < samples_.size(); ++iSample) {
       const CutFlow* thisSamplesCuts = samples_[iSample].second;
       const char* thisSamplesName = thisSamplesCuts->name(iCut);
       // Make sure all the samples are using the same cuts
       assert(strncmp(name, thisSamplesName, 500) == 0);
       out << std::setw(15) << std::right << std::setprecision(1) <<
-        cuts->passed(iCut);
+        thisSamplesCuts->passed(iCut);
     }
+    out << std::endl;
   }
 }
 
@@ -0,0 +1,164 @@
+#include "FinalStateAnalysis/Utilities/interface/ExpressionNtuplePolicy.h"
+
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/Utilities/interface/Exception.h"
+#include "TBranch.h"
+#include "TObjArray.h"
+#include "TTree.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fnmatch.h>
+
+namespace ek {
+
+namespace {
+
+int compressionAlgorithm(const std::string& name) {
+  // Same numbering as ROOT::RCompressionSetting::EAlgorithm
+  if (name == "ZLIB") return 1;
+  if (name == "LZMA") return 2;
+  if (name == "LZ4") return 4;
+  if (name == "ZSTD") return 5;
+  throw cms::Exception("BadWritePolicy")
+    << "Unknown compressionAlgorithm " << name
+    << ".  Allowed: ZLIB, LZMA, LZ4 and ZSTD" << std::endl;
+}
+
+template<typename T>
+T get(const edm::ParameterSet& pset, const std::string& name, T fallback) {
+  return pset.exists(name) ? pset.getParameter<T>(name) : fallback;
+}
+
+void applySettings(TBranch* branch, int basketSize, int algorithm,
+    int level) {
+  if (basketSize > 0)
+    branch->SetBasketSize(basketSize);
+  if (algorithm > 0)
+    branch->SetCompressionAlgorithm(algorithm);
+  if (level >= 0)
+    branch->SetCompressionLevel(level);
+}
+
+}
+
+ExpressionNtuplePolicy::Settings::Settings():
+  basketSize(0), compressionAlgorithm(0), compressionLevel(-1),
+  mantissaBits(0) {}
+
+void ExpressionNtuplePolicy::Settings::read(const edm::ParameterSet& pset) {
+  basketSize = get<int>(pset, "basketSize", 0);
+  if (pset.exists("compressionAlgorithm"))
+    compressionAlgorithm = ek::compressionAlgorithm(
+        pset.getParameter<std::string>("compressionAlgorithm"));
+  compressionLevel = get<int>(pset, "compressionLevel", -1);
+  mantissaBits = get<int>(pset, "mantissaBits", 0);
+  if (mantissaBits < 0 || mantissaBits > 23) {
+    throw cms::Exception("BadWritePolicy")
+      << "mantissaBits must be between 1 and 23 (0 for full precision), not "
+      << mantissaBits << std::endl;
+  }
+}
+
+ExpressionNtuplePolicy::ExpressionNtuplePolicy():
+  hasAutoFlush_(false), autoFlush_(0), basketBytes_(0),
+  minBasketSize_(1024), maxBasketSize_(32000), columnarChunkRows_(10000),
+  columnarOnly_(false) {}
+
+ExpressionNtuplePolicy::ExpressionNtuplePolicy(
+    const edm::ParameterSet& ntuple):
+  hasAutoFlush_(false), autoFlush_(0), basketBytes_(0),
+  minBasketSize_(1024), maxBasketSize_(32000), columnarChunkRows_(10000),
+  columnarOnly_(false) {
+  if (!ntuple.existsAs<edm::ParameterSet>(parameterName()))
+    return;
+  const edm::ParameterSet pset =
+    ntuple.getParameterSet(parameterName());
+  hasAutoFlush_ = pset.exists("autoFlush");
+  autoFlush_ = get<int>(pset, "autoFlush", 0);
+  basketBytes_ = get<int>(pset, "basketBytes", 0);
+  minBasketSize_ = get<int>(pset, "minBasketSize", minBasketSize_);
+  maxBasketSize_ = get<int>(pset, "maxBasketSize", maxBasketSize_);
+  tree_.read(pset);
+  if (tree_.mantissaBits || tree_.basketSize) {
+    throw cms::Exception("BadWritePolicy")
+      << "mantissaBits and basketSize are set per column, in the "
+      << "writePolicy.columns PSets" << std::endl;
+  }
+  typedef std::vector<edm::ParameterSet> VPSet;
+  VPSet columns = get<VPSet>(pset, "columns", VPSet());
+  for (size_t i = 0; i < columns.size(); ++i) {
+    ColumnRule column;
+    column.names = columns[i].getParameter<std::vector<std::string> >("names");
+    column.settings.read(columns[i]);
+    columns_.push_back(column);
+  }
+  columnarDirectory_ = get<std::string>(pset, "columnarDirectory", "");
+  columnarChunkRows_ = std::max(1, get<int>(pset, "columnarChunkRows", 10000));
+  columnarOnly_ = get<bool>(pset, "columnarOnly", false);
+  if (columnarOnly_ && columnarDirectory_.empty()) {
+    throw cms::Exception("BadWritePolicy")
+      << "columnarOnly needs a columnarDirectory" << std::endl;
+  }
+}
+
+const ExpressionNtuplePolicy::Settings* ExpressionNtuplePolicy::rule(
+    const std::string& column) const {
+  for (size_t i = 0; i < columns_.size(); ++i) {
+    const std::vector<std::string>& names = columns_[i].names;
+    for (size_t j = 0; j < names.size(); ++j) {
+      if (fnmatch(names[j].c_str(), column.c_str(), 0) == 0)
+        return &columns_[i].settings;
+    }
+  }
+  return 0;
+}
+
+int ExpressionNtuplePolicy::mantissaBits(const std::string& column) const {
+  const Settings* settings = rule(column);
+  return settings ? settings->mantissaBits : 0;
+}
+
+void ExpressionNtuplePolicy::apply(TTree* tree) const {
+  if (hasAutoFlush_)
+    tree->SetAutoFlush(autoFlush_);
+  TObjArray* branches = tree->GetListOfBranches();
+  const int nBranches = branches->GetEntries();
+  int basketSize = 0;
+  if (basketBytes_ > 0 && nBranches > 0) {
+    basketSize = std::min(maxBasketSize_,
+        std::max(minBasketSize_, basketBytes_/nBranches));
+  }
+  for (int i = 0; i < nBranches; ++i) {
+    TBranch* branch = static_cast<TBranch*>(branches->At(i));
+    applySettings(branch, basketSize, tree_.compressionAlgorithm,
+        tree_.compressionLevel);
+    const Settings* column = rule(branch->GetName());
+    if (column) {
+      applySettings(branch, column->basketSize,
+          column->compressionAlgorithm, column->compressionLevel);
+    }
+  }
+}
+
+float reduceMantissa(float x, int bits) {
+  if (bits <= 0 || bits >= 23)
+    return x;
+  uint32_t word;
+  std::memcpy(&word, &x, sizeof(word));
+  // Leave inf and nan alone
+  if ((word & 0x7f800000) == 0x7f800000)
+    return x;
+  const int dropped = 23 - bits;
+  // Round half up; a carry out of the mantissa correctly bumps the exponent
+  uint32_t rounded = word + (uint32_t(1) << (dropped - 1));
+  rounded &= ~((uint32_t(1) << dropped) - 1);
+  if ((rounded & 0x7f800000) == 0x7f800000)
+    rounded = word & ~((uint32_t(1) << dropped) - 1);
+  float output;
+  std::memcpy(&output, &rounded, sizeof(output));
+  return output;
+}
+
+}
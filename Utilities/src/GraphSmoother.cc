@@ -1,8 +1,8 @@
 #include "FinalStateAnalysis/Utilities/interface/GraphSmoother.h"
 #include "TGraphSmooth.h"
-#include "TF1.h"
 #include "TVectorD.h"
 #include "TDecompBK.h"
+#include <algorithm>
 #include <cmath>
 
 namespace {
@@ -38,23 +38,177 @@ void mergeTGraphAsymmErrors(TGraphAsymmErrors& graph,
   }
 }
 
-// Evans version
-double smoothWithPolyFitEK(TGraph& graph, double x0, double width,
-    const std::string& formula) {
-  size_t pointsInFit = 0;
-  double min = x0 - width;
-  double max = x0 + width;
-  for (int i = 0; i < graph.GetN(); ++i) {
-    if (graph.GetX()[i] > min && graph.GetX()[i] < max) {
-      pointsInFit++;
+// Weight of a point at distance dx from the center of the window
+double kernelWeight(GraphSmoothingKernel kernel, double dx, double width) {
+  double u = std::min(std::abs(dx)/width, 1.0);
+  switch (kernel) {
+    case kTriangularKernel:
+      return 1 - u;
+    case kTricubeKernel: {
+      double t = 1 - u*u*u;
+      return t*t*t;
+    }
+    default:
+      return 1;
+  }
+}
+
+// Weighted moments of the points in a window, in units of the window width:
+//   sumW[k] = sum w u^k          k = 0 .. 2*degree
+//   sumWY[c][k] = sum w y_c u^k  k = 0 .. degree
+struct LocalMoments {
+  LocalMoments(int degree, size_t nColumns):
+    sumW(2*degree + 1, 0.),
+    sumWY(nColumns, std::vector<double>(degree + 1, 0.)) {}
+
+  void add(double u, double w, const std::vector<std::vector<double> >& ys,
+      size_t point) {
+    double uk = w;
+    for (size_t k = 0; k < sumW.size(); ++k) {
+      sumW[k] += uk;
+      if (k < sumWY[0].size()) {
+        for (size_t c = 0; c < sumWY.size(); ++c) {
+          sumWY[c][k] += uk*ys[c][point];
+        }
+      }
+      uk *= u;
+    }
+  }
+
+  // The same moments about u = u0
+  LocalMoments shifted(double u0) const {
+    LocalMoments output(*this);
+    for (size_t k = 0; k < sumW.size(); ++k) {
+      output.sumW[k] = shift(sumW, k, u0);
+      for (size_t c = 0; c < sumWY.size(); ++c) {
+        if (k < sumWY[c].size())
+          output.sumWY[c][k] = shift(sumWY[c], k, u0);
+      }
+    }
+    return output;
+  }
+
+  // sum_j C(k, j) m_j (-u0)^(k-j)
+  static double shift(const std::vector<double>& m, size_t k, double u0) {
+    double output = 0;
+    double binomial = 1;
+    for (size_t j = k + 1; j-- > 0;) {
+      output += binomial*m[j]*std::pow(-u0, int(k - j));
+      binomial = binomial*j/(k - j + 1);
     }
+    return output;
   }
-  if (pointsInFit > 2) {
-    graph.Fit(formula.c_str(), "Q", "", x0 - width, x0 + width);
-    return graph.GetFunction(formula.c_str())->Eval(x0);
+
+  std::vector<double> sumW;
+  std::vector<std::vector<double> > sumWY;
+};
+
+// Solve the normal equations for each column and put the value of the
+// fitted polynomial at u = 0 in [output].  Returns false if they can't be
+// solved.
+bool solveAtOrigin(const LocalMoments& moments, std::vector<double>& output) {
+  const int npar = moments.sumWY[0].size();
+  TMatrixDSym mat(npar);
+  for (int j = 0; j < npar; ++j) {
+    for (int j2 = 0; j2 < npar; ++j2) {
+      mat(j,j2) = moments.sumW[j+j2];
+    }
+  }
+  TDecompBK bk(mat);
+  if (!bk.Decompose())
+    return false;
+  output.resize(moments.sumWY.size());
+  for (size_t c = 0; c < moments.sumWY.size(); ++c) {
+    TVectorD vec(npar, &moments.sumWY[c][0]);
+    if (!bk.Solve(vec))
+      return false;
+    output[c] = vec(0);
+  }
+  return true;
+}
+
+// Local polynomial smoothing of the columns [ys], which share the x values
+// [xs].  The window of each point is x0 +- width, edges included, as in
+// TGraph::Fit.
+std::vector<std::vector<double> > smoothColumns(const std::vector<double>& xs,
+    const std::vector<std::vector<double> >& ys, double width, int degree,
+    GraphSmoothingKernel kernel) {
+  const size_t n = xs.size();
+  std::vector<std::vector<double> > output(ys);
+  if (!n || degree < 0)
+    return output;
+
+  // Walk the points in x order
+  std::vector<size_t> order(n);
+  for (size_t i = 0; i < n; ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(),
+      [&xs](size_t a, size_t b) { return xs[a] < xs[b]; });
+  std::vector<double> x(n);
+  std::vector<std::vector<double> > y(ys.size(), std::vector<double>(n));
+  for (size_t i = 0; i < n; ++i) {
+    x[i] = xs[order[i]];
+    for (size_t c = 0; c < ys.size(); ++c) {
+      y[c][i] = ys[c][order[i]];
+    }
+  }
+
+  // With the uniform kernel the moments about a reference point are kept up
+  // to date as the window slides, and shifted to each x0.  The reference
+  // follows the window (so the sums stay well conditioned): once it is more
+  // than a width behind, the sums are rebuilt about x0.
+  const bool running = (kernel == kUniformKernel);
+  LocalMoments window(degree, ys.size());
+  double ref = x[0];
+  size_t lo = 0, hi = 0;             // points in [x0 - width, x0 + width]
+  size_t strictLo = 0, strictHi = 0; // points in (x0 - width, x0 + width)
+  std::vector<double> values;
+  for (size_t i = 0; i < n; ++i) {
+    const double x0 = x[i];
+    const double min = x0 - width;
+    const double max = x0 + width;
+    while (hi < n && x[hi] <= max) {
+      if (running)
+        window.add((x[hi] - ref)/width, 1, y, hi);
+      ++hi;
+    }
+    while (lo < hi && x[lo] < min) {
+      if (running)
+        window.add((x[lo] - ref)/width, -1, y, lo);
+      ++lo;
+    }
+    if (running && x0 - ref > width) {
+      ref = x0;
+      window = LocalMoments(degree, ys.size());
+      for (size_t j = lo; j < hi; ++j) {
+        window.add((x[j] - ref)/width, 1, y, j);
+      }
+    }
+    while (strictHi < n && x[strictHi] < max)
+      ++strictHi;
+    while (strictLo < n && x[strictLo] <= min)
+      ++strictLo;
+    // Not enough points to fit, keep y
+    if (strictHi - strictLo <= size_t(degree))
+      continue;
+
+    LocalMoments moments(degree, ys.size());
+    if (running) {
+      moments = window.shifted((x0 - ref)/width);
+    } else {
+      for (size_t j = lo; j < hi; ++j) {
+        moments.add((x[j] - x0)/width,
+            kernelWeight(kernel, x[j] - x0, width), y, j);
+      }
+    }
+    if (!solveAtOrigin(moments, values))
+      continue;
+    for (size_t c = 0; c < ys.size(); ++c) {
+      output[c][order[i]] = values[c];
+    }
   }
-  // if we don't have enough points to fit, just return y
-  return graph.Eval(x0);
+  return output;
 }
 
 // BandUtils version
@@ -90,30 +244,48 @@ double smoothWithPolyFit(double x, int npar, int n, double *xi, double *yi) {
 
 
 TGraph smooth(const TGraph& graph, double width) {
-  TGraphSmooth smoother;
-  TGraph temp(graph); // not const
-  TGraph output(graph); // don't leak memory
+  return smoothLocalPoly(graph, width, 2, kUniformKernel);
+}
 
+TGraphAsymmErrors smoothWithErrors(const TGraphAsymmErrors& graph, double width) {
+  return smoothLocalPolyWithErrors(graph, width, 2, kUniformKernel);
+}
+
+TGraph smoothLocalPoly(const TGraph& graph, double width, int degree,
+    GraphSmoothingKernel kernel) {
+  std::vector<double> xs(graph.GetX(), graph.GetX() + graph.GetN());
+  std::vector<std::vector<double> > ys(1,
+      std::vector<double>(graph.GetY(), graph.GetY() + graph.GetN()));
+  std::vector<std::vector<double> > smoothed = smoothColumns(
+      xs, ys, width, degree, kernel);
+
+  TGraph output(graph);
   for (int i = 0; i < graph.GetN(); ++i) {
-    double y = smoothWithPolyFitEK(temp, temp.GetX()[i], width, "pol2");
-    double x = temp.GetX()[i];
-    output.SetPoint(i, x, y);
+    output.SetPoint(i, xs[i], smoothed[0][i]);
   }
-
-  //delete smoothed;
   return output;
 }
 
-TGraphAsymmErrors smoothWithErrors(const TGraphAsymmErrors& graph, double width) {
+TGraphAsymmErrors smoothLocalPolyWithErrors(const TGraphAsymmErrors& graph,
+    double width, int degree, GraphSmoothingKernel kernel) {
+  // Columns: error up, nominal, error down
   std::vector<TGraph> input = splitTGraphAsymmErrors(graph);
-  std::vector<TGraph> smoothed;
+  std::vector<double> xs(graph.GetX(), graph.GetX() + graph.GetN());
+  std::vector<std::vector<double> > ys;
   for (size_t i = 0; i < input.size(); ++i) {
-    TGraph smoothy = smooth(input[i], width);
-    smoothed.push_back(smoothy);
+    ys.push_back(std::vector<double>(
+          input[i].GetY(), input[i].GetY() + input[i].GetN()));
+  }
+  std::vector<std::vector<double> > smoothed = smoothColumns(
+      xs, ys, width, degree, kernel);
+  for (size_t c = 0; c < input.size(); ++c) {
+    for (int i = 0; i < graph.GetN(); ++i) {
+      input[c].SetPoint(i, xs[i], smoothed[c][i]);
+    }
   }
   TGraphAsymmErrors output(graph);
 
-  mergeTGraphAsymmErrors(output, smoothed[0], smoothed[1], smoothed[2]);
+  mergeTGraphAsymmErrors(output, input[0], input[1], input[2]);
   return output;
 }
 
@@ -0,0 +1,78 @@
+#include "FinalStateAnalysis/Utilities/interface/TH1Accumulator.h"
+
+#include "TH1.h"
+
+namespace ek {
+
+TH1Accumulator::TH1Accumulator():
+  histo_(0),nbins_(0),min_(0),max_(0) {
+  clear();
+}
+
+TH1Accumulator::TH1Accumulator(TH1* histo):
+  histo_(histo),
+  nbins_(histo->GetNbinsX()),
+  min_(histo->GetXaxis()->GetXmin()),
+  max_(histo->GetXaxis()->GetXmax()) {
+  clear();
+}
+
+void TH1Accumulator::clear() {
+  sumw_.assign(nbins_ + 2, 0.);
+  sumw2_.assign(nbins_ + 2, 0.);
+  for (int i = 0; i < 4; ++i)
+    stats_[i] = 0.;
+  entries_ = 0;
+  weighted_ = false;
+}
+
+void TH1Accumulator::fill(double x, double weight) {
+  ++entries_;
+  if (weight != 1.)
+    weighted_ = true;
+  // Same bin as TAxis::FindBin, NaN goes to the overflow
+  int bin;
+  if (x < min_) {
+    bin = 0;
+  } else if (!(x < max_)) {
+    bin = nbins_ + 1;
+  } else {
+    bin = 1 + int(nbins_*(x - min_)/(max_ - min_));
+    // Under/overflows do not enter the statistics, as in TH1::Fill
+    stats_[0] += weight;
+    stats_[1] += weight*weight;
+    stats_[2] += weight*x;
+    stats_[3] += weight*x*x;
+  }
+  sumw_[bin] += weight;
+  sumw2_[bin] += weight*weight;
+}
+
+void TH1Accumulator::flush() {
+  if (!histo_ || !entries_)
+    return;
+  // TH1::Fill switches to weighted errors at the first weight != 1
+  if (weighted_ && histo_->GetSumw2N() == 0 &&
+      !histo_->TestBit(TH1::kIsNotW))
+    histo_->Sumw2();
+  // Take the statistics before touching the bins, so they are not
+  // recomputed from the bin contents
+  double stats[4];
+  histo_->GetStats(stats);
+  for (int i = 0; i < 4; ++i)
+    stats[i] += stats_[i];
+  const double entries = histo_->GetEntries() + entries_;
+  const bool hasSumw2 = histo_->GetSumw2N() > 0;
+  for (int bin = 0; bin < nbins_ + 2; ++bin) {
+    if (!sumw_[bin] && !sumw2_[bin])
+      continue;
+    histo_->AddBinContent(bin, sumw_[bin]);
+    if (hasSumw2)
+      (*histo_->GetSumw2())[bin] += sumw2_[bin];
+  }
+  histo_->PutStats(stats);
+  histo_->SetEntries(entries);
+  clear();
+}
+
+}
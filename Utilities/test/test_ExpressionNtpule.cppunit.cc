@@ -1,6 +1,10 @@
 #include "FinalStateAnalysis/Utilities/interface/ExpressionNtuple.h"
 #include "TRandom.h"
 
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <iterator>
+
 #include "DataFormats/Candidate/interface/LeafCandidate.h"
 #include "PhysicsTools/FWLite/interface/TFileService.h"
 
@@ -12,12 +16,16 @@ class testExpressionNtuple: public CppUnit::TestFixture {
   CPPUNIT_TEST_SUITE(testExpressionNtuple);
   CPPUNIT_TEST(testBooking);
   CPPUNIT_TEST(testFilling);
+  CPPUNIT_TEST(testWritePolicy);
+  CPPUNIT_TEST(testColumnar);
   CPPUNIT_TEST_SUITE_END();
   public:
     void setUp();
     void tearDown(){ delete fileService;}
     void testBooking();
     void testFilling();
+    void testWritePolicy();
+    void testColumnar();
   private:
     ExpressionNtuple<reco::LeafCandidate> * ntuple_;
     ExpressionNtuple<vLeafCandidate> * nfntuple_;
@@ -96,4 +104,98 @@ void testExpressionNtuple::testFilling() {
 
 }
 
+void testExpressionNtuple::testWritePolicy() {
+  edm::ParameterSet kinematics;
+  kinematics.addParameter<std::vector<std::string> >("names",
+      std::vector<std::string>(1, "*pt"));
+  kinematics.addParameter<int>("mantissaBits", 8);
+  kinematics.addParameter<int>("compressionLevel", 9);
+  edm::ParameterSet uncompressed;
+  uncompressed.addParameter<std::vector<std::string> >("names",
+      std::vector<std::string>(1, "phi"));
+  uncompressed.addParameter<int>("compressionLevel", 0);
+  std::vector<edm::ParameterSet> columns;
+  columns.push_back(kinematics);
+  columns.push_back(uncompressed);
+
+  edm::ParameterSet policy;
+  policy.addParameter<int>("autoFlush", 1000);
+  policy.addParameter<int>("basketBytes", 4*4096);
+  policy.addParameter<std::string>("compressionAlgorithm", "LZMA");
+  policy.addParameter<int>("compressionLevel", 4);
+  policy.addParameter<std::vector<edm::ParameterSet> >("columns", columns);
+
+  edm::ParameterSet pset;
+  pset.addParameter<std::string>("pt", "pt");
+  pset.addParameter<std::string>("eta", "eta");
+  pset.addParameter<std::string>("phi", "phi");
+  pset.addParameter<edm::ParameterSet>("writePolicy", policy);
+  ExpressionNtuple<reco::LeafCandidate> ntuple(pset);
+  ntuple.initialize(*fileService);
+
+  // The policy is not a column
+  CPPUNIT_ASSERT(ntuple.tree()->GetListOfBranches()->GetEntries() == 4);
+  CPPUNIT_ASSERT(ntuple.tree()->GetAutoFlush() == 1000);
+  CPPUNIT_ASSERT(ntuple.tree()->GetBranch("eta")->GetBasketSize() == 4096);
+  CPPUNIT_ASSERT(ntuple.tree()->GetBranch("eta")->GetCompressionAlgorithm() == 2);
+  CPPUNIT_ASSERT(ntuple.tree()->GetBranch("eta")->GetCompressionLevel() == 4);
+  CPPUNIT_ASSERT(ntuple.tree()->GetBranch("pt")->GetCompressionLevel() == 9);
+  CPPUNIT_ASSERT(ntuple.tree()->GetBranch("phi")->GetCompressionLevel() == 0);
+
+  reco::LeafCandidate cand(0, math::PtEtaPhiMLorentzVector(1.2345678, 1.2345678, 0, 0));
+  ntuple.fill(cand);
+  ntuple.tree()->GetEntry(0);
+  float pt = ntuple.tree()->GetLeaf("pt")->GetValue();
+  float eta = ntuple.tree()->GetLeaf("eta")->GetValue();
+  CPPUNIT_ASSERT(pt == ek::reduceMantissa(1.2345678, 8));
+  CPPUNIT_ASSERT(pt != float(1.2345678));
+  CPPUNIT_ASSERT(std::abs(pt - 1.2345678) < 1.2345678/512);
+  CPPUNIT_ASSERT(eta == float(1.2345678));
+}
+
+void testExpressionNtuple::testColumnar() {
+  boost::filesystem::remove_all("test_columnar");
+  edm::ParameterSet policy;
+  policy.addParameter<std::string>("columnarDirectory", "test_columnar");
+  policy.addParameter<int>("columnarChunkRows", 7);
+  policy.addParameter<bool>("columnarOnly", true);
+
+  edm::ParameterSet pset;
+  pset.addParameter<std::string>("pt", "pt");
+  pset.addParameter<std::string>("charge", "charge");
+  pset.addParameter<edm::ParameterSet>("writePolicy", policy);
+  {
+    ExpressionNtuple<reco::LeafCandidate> ntuple(pset);
+    ntuple.initialize(*fileService);
+    for (int i = 0; i < 20; ++i) {
+      reco::LeafCandidate cand(1, math::PtEtaPhiMLorentzVector(i, 0, 0, 0));
+      ntuple.fill(cand, i);
+    }
+    // Only the columns are filled
+    CPPUNIT_ASSERT(ntuple.tree()->GetEntries() == 0);
+  }
+
+  const std::string directory = "test_columnar/" + fileService->fullPath();
+  std::ifstream ptFile((directory + "/pt.npy").c_str(), std::ios::binary);
+  std::string pt((std::istreambuf_iterator<char>(ptFile)),
+      std::istreambuf_iterator<char>());
+  // 128 byte header, then the 20 rows, including the unfinished chunk
+  CPPUNIT_ASSERT(pt.size() == 128 + 20*sizeof(float));
+  CPPUNIT_ASSERT(pt.compare(0, 6, "\x93NUMPY") == 0);
+  CPPUNIT_ASSERT(pt.find("'descr': '<f4'") != std::string::npos);
+  CPPUNIT_ASSERT(pt.find("'shape': (20,)") != std::string::npos);
+  const float* values = reinterpret_cast<const float*>(pt.data() + 128);
+  CPPUNIT_ASSERT(values[0] == 0);
+  CPPUNIT_ASSERT(values[13] == 13);
+  CPPUNIT_ASSERT(values[19] == 19);
+
+  std::ifstream idxFile((directory + "/idx.npy").c_str(), std::ios::binary);
+  std::string idx((std::istreambuf_iterator<char>(idxFile)),
+      std::istreambuf_iterator<char>());
+  CPPUNIT_ASSERT(idx.find("'descr': '<i4'") != std::string::npos);
+  CPPUNIT_ASSERT(reinterpret_cast<const int*>(idx.data() + 128)[7] == 7);
+
+  boost::filesystem::remove_all("test_columnar");
+}
+
 CPPUNIT_TEST_SUITE_REGISTRATION(testExpressionNtuple);
@@ -7,19 +7,53 @@
 #include <vector>
 
 #include "FinalStateAnalysis/Utilities/interface/StringObjectSorter.h"
+#include "FinalStateAnalysis/Utilities/interface/TH1Accumulator.h"
+#include "FinalStateAnalysis/Utilities/interface/BinnedExpressionHisto.h"
+#include "FinalStateAnalysis/Utilities/interface/FastObjectFunction.h"
+#include "FinalStateAnalysis/Utilities/interface/ExpressionRegistry.h"
+#include "FinalStateAnalysis/Utilities/interface/GraphSmoother.h"
 #include "DataFormats/Candidate/interface/LeafCandidate.h"
 #include "DataFormats/RecoCandidate/interface/RecoChargedCandidate.h"
 #include "DataFormats/TrackReco/interface/Track.h"
 
+#include "TH1F.h"
+#include "TF1.h"
+#include "TGraph.h"
+
 #include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
 
 using namespace edm;
 
+// Compiled accessors for LeafCandidates, for the batch selector test.  "one"
+// is invariant and counts how often it is evaluated.
+namespace reco {
+  static int nOneCalls = 0;
+  std::function<double(const LeafCandidate&)> nativeFunction(
+      const std::string& expression, const LeafCandidate*) {
+    if (expression == "pt")
+      return [](const LeafCandidate& c) { return c.pt(); };
+    if (expression == "one")
+      return [](const LeafCandidate&) { ++nOneCalls; return 1.0; };
+    return std::function<double(const LeafCandidate&)>();
+  }
+  bool nativeInvariant(const std::string& expression, const LeafCandidate*) {
+    return expression == "one";
+  }
+}
+
 class testUtilities: public CppUnit::TestFixture {
   CPPUNIT_TEST_SUITE(testUtilities);
   CPPUNIT_TEST(testSorter);
   CPPUNIT_TEST(testLazySorter);
   CPPUNIT_TEST(testRepeat);
+  CPPUNIT_TEST(testCachedSorter);
+  CPPUNIT_TEST(testAccumulator);
+  CPPUNIT_TEST(testBatchSelector);
+  CPPUNIT_TEST(testExpressionRegistry);
+  CPPUNIT_TEST(testGraphSmoother);
   CPPUNIT_TEST_SUITE_END();
   public:
     void setUp() {};
@@ -27,6 +61,11 @@ class testUtilities: public CppUnit::TestFixture {
     void testSorter();
     void testLazySorter();
     void testRepeat();
+    void testCachedSorter();
+    void testAccumulator();
+    void testBatchSelector();
+    void testExpressionRegistry();
+    void testGraphSmoother();
 };
 
 
@@ -165,4 +204,202 @@ void testUtilities::testRepeat() {
 
 }
 
+void testUtilities::testCachedSorter() {
+  // Sort by charge, then by pt
+  std::vector<std::string> keys;
+  keys.push_back("charge");
+  keys.push_back("pt");
+  StringObjectSorter<reco::LeafCandidate> sorter(keys);
+
+  size_t nCands = 100;
+  std::vector<const reco::LeafCandidate*> cands;
+  // Ascending, with alternating charge
+  for (size_t i = 0; i < nCands; ++i) {
+    reco::Candidate::LorentzVector p4(i, 0, 0, i);
+    cands.push_back(new reco::LeafCandidate(i % 2 ? 1 : -1, p4));
+  }
+  std::vector<const reco::LeafCandidate*> sorted(cands);
+  sorter.sort(sorted);
+  CPPUNIT_ASSERT_EQUAL(nCands, sorted.size());
+  // Positive first, each half by descending pt
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(nCands-1, sorted[0]->pt(), 1e-6);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(nCands-2, sorted[nCands/2]->pt(), 1e-6);
+  for (size_t i = 1; i < nCands; ++i) {
+    CPPUNIT_ASSERT(!sorter(sorted[i], sorted[i-1]));
+  }
+
+  // The predicate gives the same order
+  std::vector<const reco::LeafCandidate*> predSorted(cands);
+  std::sort(predSorted.begin(), predSorted.end(), sorter);
+  for (size_t i = 0; i < nCands; ++i) {
+    CPPUNIT_ASSERT(sorted[i] == predSorted[i]);
+  }
+
+  // Equal keys keep their order
+  StringObjectSorter<reco::LeafCandidate> chargeSorter("charge");
+  std::vector<size_t> order = chargeSorter.order(cands);
+  for (size_t i = 1; i < nCands/2; ++i) {
+    CPPUNIT_ASSERT(order[i] > order[i-1]);
+  }
+
+  for (size_t i = 0; i < nCands; ++i) {
+    delete cands[i];
+  }
+}
+
+void testUtilities::testAccumulator() {
+  TH1F direct("direct", "direct", 10, -1, 4);
+  TH1F buffered("buffered", "buffered", 10, -1, 4);
+  direct.SetDirectory(0);
+  buffered.SetDirectory(0);
+  ek::TH1Accumulator accumulator(&buffered);
+  // Includes under/overflows and the bin edges
+  for (size_t i = 0; i < 50; ++i) {
+    double x = -1.5 + 0.125*i;
+    double w = (i % 3) ? 1.0 : 0.5;
+    direct.Fill(x, w);
+    accumulator.fill(x, w);
+  }
+  // NaN is an entry in the overflow, outside the statistics
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  direct.Fill(nan, 2.);
+  accumulator.fill(nan, 2.);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(
+      direct.GetBinContent(11), accumulator.pending(11), 1e-6);
+  // Nothing is written until the flush
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(0, buffered.GetEntries(), 1e-6);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(
+      direct.GetBinContent(3), accumulator.pending(3), 1e-6);
+  accumulator.flush();
+  for (int bin = 0; bin < 12; ++bin) {
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(
+        direct.GetBinContent(bin), buffered.GetBinContent(bin), 1e-6);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(
+        direct.GetBinError(bin), buffered.GetBinError(bin), 1e-6);
+  }
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(direct.GetEntries(), buffered.GetEntries(), 1e-6);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(direct.GetMean(), buffered.GetMean(), 1e-6);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(direct.GetRMS(), buffered.GetRMS(), 1e-6);
+
+  // Per-item histograms are refused, not silently dropped
+  edm::ParameterSet pset;
+  pset.addUntrackedParameter<double>("min", 0);
+  pset.addUntrackedParameter<double>("max", 1);
+  pset.addUntrackedParameter<int>("nbins", 10);
+  pset.addUntrackedParameter<std::string>("name", "pt");
+  pset.addUntrackedParameter<std::string>("description", "pt");
+  pset.addUntrackedParameter<std::string>("plotquantity", "pt");
+  ek::BinnedExpressionHisto histo(pset);
+  CPPUNIT_ASSERT_EQUAL(std::string("pt"), histo.expression());
+  pset.addUntrackedParameter<int>("itemsToPlot", 2);
+  CPPUNIT_ASSERT_THROW(ek::BinnedExpressionHisto items(pset), cms::Exception);
+}
+
+void testUtilities::testBatchSelector() {
+  size_t nCands = 20;
+  std::vector<const reco::LeafCandidate*> cands;
+  for (size_t i = 0; i < nCands; ++i) {
+    reco::Candidate::LorentzVector p4(i, 0, 0, i);
+    cands.push_back(new reco::LeafCandidate(i % 2 ? 1 : -1, p4));
+  }
+
+  ek::FastCutObjectSelector<reco::LeafCandidate> cut(
+      "pt > 4.5 & one == 1 && abs(pt) <= 15");
+  CPPUNIT_ASSERT(cut.native());
+  std::vector<bool> pass;
+  reco::nOneCalls = 0;
+  cut.select(cands, pass);
+  // The invariant term is evaluated once for the whole batch
+  CPPUNIT_ASSERT_EQUAL(1, reco::nOneCalls);
+  CPPUNIT_ASSERT_EQUAL(nCands, pass.size());
+  for (size_t i = 0; i < nCands; ++i) {
+    CPPUNIT_ASSERT_EQUAL(cut(*cands[i]), bool(pass[i]));
+    CPPUNIT_ASSERT_EQUAL(i >= 5 && i <= 15, bool(pass[i]));
+  }
+
+  // Cuts which go through reflection give the same answer
+  ek::FastCutObjectSelector<reco::LeafCandidate> reflexCut(
+      "pt > 4.5 && charge > 0");
+  CPPUNIT_ASSERT(!reflexCut.native());
+  reflexCut.select(cands, pass);
+  for (size_t i = 0; i < nCands; ++i) {
+    CPPUNIT_ASSERT_EQUAL(i >= 5 && i % 2 == 1, bool(pass[i]));
+  }
+
+  for (size_t i = 0; i < nCands; ++i) {
+    delete cands[i];
+  }
+}
+
+void testUtilities::testExpressionRegistry() {
+  typedef StringObjectFunction<reco::LeafCandidate> Function;
+  typedef ek::FastCutObjectSelector<reco::LeafCandidate> Cut;
+  // The same expression is compiled once and shared
+  boost::shared_ptr<const Function> eta =
+    ek::sharedExpression<Function>("eta", true);
+  CPPUNIT_ASSERT(eta == ek::sharedExpression<Function>("eta", true));
+  CPPUNIT_ASSERT(eta != ek::sharedExpression<Function>("eta", false));
+  CPPUNIT_ASSERT(eta != ek::sharedExpression<Function>("phi", true));
+  boost::shared_ptr<const Cut> cut = ek::sharedExpression<Cut>("pt > 4.5");
+  CPPUNIT_ASSERT(cut == ek::sharedExpression<Cut>("pt > 4.5"));
+  CPPUNIT_ASSERT(cut->native());
+
+  reco::LeafCandidate cand(1, reco::Candidate::LorentzVector(5, 0, 0, 5));
+  CPPUNIT_ASSERT((*cut)(cand));
+  CPPUNIT_ASSERT_EQUAL(cand.eta(), (*eta)(cand));
+
+  // The per-thread lookup gives the registry's object, from any thread
+  CPPUNIT_ASSERT(&ek::cachedExpression<Function>("eta", true) == eta.get());
+  CPPUNIT_ASSERT(&ek::cachedExpression<Function>("eta", true) == eta.get());
+  const Function* fromThread = 0;
+  std::thread other([&fromThread]() {
+      fromThread = &ek::cachedExpression<Function>("eta", true); });
+  other.join();
+  CPPUNIT_ASSERT(fromThread == eta.get());
+
+  // A bad expression throws every time it is requested
+  CPPUNIT_ASSERT_THROW(ek::sharedExpression<Function>("notAMethod"),
+      cms::Exception);
+  CPPUNIT_ASSERT_THROW(ek::sharedExpression<Function>("notAMethod"),
+      cms::Exception);
+}
+
+void testUtilities::testGraphSmoother() {
+  // Linear with an outlier at x = 3 (see graphsmoother.py)
+  TGraph line(5);
+  double ys[5] = {1, 2, 6, 4, 5};
+  for (int i = 0; i < 5; ++i) {
+    line.SetPoint(i, i + 1, ys[i]);
+  }
+  TGraph smoothedLine = smooth(line, 3);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(4.457, smoothedLine.GetY()[2], 1e-3);
+
+  // Same as fitting a pol2 around each point
+  TGraph graph(40);
+  for (int i = 0; i < graph.GetN(); ++i) {
+    double x = 10 + 2.5*i;
+    graph.SetPoint(i, x, std::exp(-x/30.) + 0.02*((i*7) % 5 - 2));
+  }
+  double width = 6;
+  TGraph smoothed = smooth(graph, width);
+  for (int i = 0; i < graph.GetN(); ++i) {
+    double x0 = graph.GetX()[i];
+    graph.Fit("pol2", "Q", "", x0 - width, x0 + width);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(graph.GetFunction("pol2")->Eval(x0),
+        smoothed.GetY()[i], 1e-6);
+  }
+
+  // Local fits reproduce polynomials of their degree, whatever the kernel
+  TGraph cubic(30);
+  for (int i = 0; i < cubic.GetN(); ++i) {
+    double x = 0.3*i;
+    cubic.SetPoint(i, x, 1 - x + 0.5*x*x*x);
+  }
+  TGraph smoothedCubic = smoothLocalPoly(cubic, 1, 3, kTricubeKernel);
+  for (int i = 0; i < cubic.GetN(); ++i) {
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(cubic.GetY()[i], smoothedCubic.GetY()[i],
+        1e-6);
+  }
+}
+
 CPPUNIT_TEST_SUITE_REGISTRATION(testUtilities);